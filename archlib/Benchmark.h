@@ -0,0 +1,82 @@
+// Benchmark.h
+//
+// Named performance measurements, saved as JSON and checked against an
+// earlier run.
+//
+//    A benchmark program times whatever it likes (now() is a monotonic
+//    clock, in seconds) and record()s each result under a name, with its
+//    unit and whether bigger is better.  The results can be printed,
+//    written out as JSON, and compared with the JSON of an earlier run
+//    (the baseline):  a result worse than its baseline value by more than
+//    the tolerance is a regression.  Results the baseline doesn't have
+//    are reported but are not regressions.
+//
+//    So that a baseline saved on one machine can be checked on another,
+//    the constructor times a fixed calibration loop, and the JSON holds
+//    each result relative to it:  a time divided by the loop's time, or
+//    a rate multiplied by it.  Only those ratios are saved and compared;
+//    the absolute figures are only printed.  A ratio still moves a little
+//    between processors that favour different work, so a tight tolerance
+//    only means much on the machine the baseline came from.
+//
+//    The JSON written is
+//
+//	{ "suite": "<suite>", "results": [
+//	  { "name": "<name>", "relative": <ratio>, "unit": "<unit>",
+//	    "better": "lower" | "higher" },
+//	  ... ] }
+//
+//    and compare() only reads back what write() writes.
+//
+
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <ArchLibError.h>
+
+using namespace std;
+
+class Benchmark {
+
+public:
+	Benchmark( const char *suite );
+		// times the calibration loop
+	~Benchmark();
+
+	static double now();
+		// seconds since some arbitrary moment; never goes back
+
+	void record( const char *name, double value, const char *unit,
+		     bool higherIsBetter = false );
+	void print( ostream &o ) const;
+		// the calibration, then one result per line
+
+	void write( const char *fileName ) const;
+		// save the results as JSON
+	int compare( const char *baselineFile, double tolerance,
+		     ostream &o ) const;
+		// print each result against the baseline's, flagging any
+		// more than tolerance (e.g. 0.1 for 10%) worse, and
+		// return the number so flagged
+
+private:
+	struct Result {
+		string name;
+		double value;
+		string unit;
+		bool higherIsBetter;
+	};
+
+	double relative( const Result &r ) const;
+	double absolute( const Result &r, double ratio ) const;
+
+	string suite;
+	double calibration;	// seconds per calibration loop
+	vector<Result> results;
+};
+
+#endif
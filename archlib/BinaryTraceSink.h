@@ -0,0 +1,61 @@
+// BinaryTraceSink.h
+//
+// A TraceSink that writes TraceRecords to a file.
+//
+// Records are put in a ring buffer by the simulation and written to the
+// file, in large pieces, by a background thread, so that the simulation
+// only waits when the writer falls a whole buffer behind.  There is
+// exactly one producer (the simulation) and one consumer (the writer),
+// so the buffer needs no locks.
+//
+// The file starts with a header ("ATRC", version, record size, all 32
+// bits), followed by the records in host byte order.  Use the tracedump
+// tool to print it.
+//
+
+#ifndef _BINARYTRACESINK_H_
+#define _BINARYTRACESINK_H_
+
+#include <cstdio>
+
+#include <pthread.h>
+
+#include <ArchLibError.h>
+#include <Trace.h>
+
+using namespace std;
+
+class BinaryTraceSink: public TraceSink {
+
+public:
+	BinaryTraceSink( const char *fileName, int bufferBits = 16 );
+		// buffer holds 2**bufferBits records
+	~BinaryTraceSink();
+		// writes out whatever is still buffered
+
+	void define( unsigned int obj, int bits, const char *name );
+	void record( const TraceRecord &r );
+
+	enum { Version = 1 };
+
+private:
+	BinaryTraceSink( const BinaryTraceSink & );	// not copyable
+	BinaryTraceSink &operator=( const BinaryTraceSink & );
+
+	static void *writer( void *self );
+	void drain();
+
+	FILE *out;
+	TraceRecord *ring;
+	unsigned long mask;		// ring size - 1
+
+	unsigned long head;		// next slot to fill; producer only
+	unsigned long tail;		// next slot to write; writer only
+	unsigned long knownTail;	// producer's last look at tail
+
+	int stopping;
+	int failed;
+	pthread_t thread;
+};
+
+#endif
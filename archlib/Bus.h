@@ -35,6 +35,7 @@ public:
 	OutFlow &OUT() { return output; }
 
 private:
+	friend class Schedule;
 	InFlow input;
 	OutFlow output;
 
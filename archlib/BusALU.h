@@ -34,6 +34,9 @@
 //	the output will be needed, even if the operation
 //	is the same as the previous cycle.  Also, it must be
 //	done after the inputs for OP1 and OP2 have been set.
+//
+//	The operation is done at most once per clock cycle, however
+//	many of OUT, CARRY and OFLOW are latched from.
 //  
 //InFlow &OP1()
 //InFlow &OP2()	references to the two incoming paths associated with the
@@ -142,6 +145,9 @@ private:
 	InFlow op1;
 	InFlow op2;
 	OutFlow result;
+	long computedAt;	// time of the last compute(), or -1
+	long op1Copy;		// operands fetched by the last compute()
+	long op2Copy;
 	friend class CarryConnector;
 	CarryConnector carryConnector;
 	friend class OverflowConnector;
@@ -7,6 +7,10 @@
 //
 // updated by:		Warren Carithers
 //			November 2002
+//
+// Members are kept in a contiguous array, in the order added, and
+// membership is tracked by serial number so contains() (and thus add())
+// takes constant time.
 
 //
 // Internal implementation class -- not for client simulators
@@ -15,24 +19,15 @@
 #ifndef _CLOCKEDOBJECTSET_H_
 #define _CLOCKEDOBJECTSET_H_
 
+#include <vector>
+
 #include <ClockedObject.h>
+#include <SerialBits.h>
 
 using namespace std;
 
 class ClockedObject;
 
-class ClockedObjectNode {
-
-private:
-	friend class ClockedObjectSet;
-
-	ClockedObject* thing;
-	ClockedObjectNode* next;
-	ClockedObjectNode ( ClockedObject* obj, ClockedObjectNode* link=0 );
-	~ClockedObjectNode();
-
-};
-
 class ClockedObjectSet {
 
 public:
@@ -44,10 +39,14 @@ public:
 	ClockedObject* next();
 	void *contains ( ClockedObject *obj );
 
+	unsigned int size() const { return items.size(); }
+	ClockedObject *operator[]( unsigned int i ) const { return items[i]; }
+		// indexed access, for iterating without the cursor
+
 private:
-	ClockedObjectNode* head;
-	ClockedObjectNode* rear;
-	ClockedObjectNode* current;
+	vector<ClockedObject *> items;
+	SerialBits members;
+	unsigned int current;
 
 };
 
@@ -22,6 +22,7 @@
 #include <iostream>
 
 #include <ArchLibError.h>
+#include <SimulationContext.h>
 
 using namespace std;
 
@@ -38,6 +39,8 @@ class CPUObject {
 	friend class Memory;
 		// Incredibly gross hack to allow Memory to change
 		// the names of some of its components.
+	friend class Cache;
+		// ...as does Cache, for the same reason.
 	friend class BusALU;
 		// Suggested by Benjamin Mayes (bdm8233), needed
 		// to allow BusALU to compile under gcc 4
@@ -57,11 +60,18 @@ public:
 
 	const char *name() const;
 	unsigned int size(); // how many bits (2nd ctor arg)
+	unsigned int serialNumber() const;
+		// small, dense number unique to this object within its
+		// context, handed out in order of creation; used to index
+		// per-object tables
+	SimulationContext &context() const;
+		// the context I was created in
 
 	enum DebugMode { create = 1, trace = 2, memload = 4, stats = 8,
 			 trace_ticks = 16 };
 
-	static int debug;
+	static __thread int debug;
+		// the current SimulationContext's flags
 
 protected:
 	int get_bits() const;
@@ -74,14 +84,17 @@ private:
 
 	int bits;
 	unsigned long mask; // mask representing above data (right-justified)
+	SimulationContext *ctx;
+	unsigned int serial;
 
 private:
 	virtual void printOn( ostream &o ) const;
 		// used by operator<< above; don't call directly,
 		// except possibly from a subclass.
-	static void birth();	// called when first CPUObject created
-	static void death();	// called when last CPUObject destroyed
-	static unsigned int objCount;
+	static void birth( SimulationContext &c );
+		// called when the context's first CPUObject is created
+	static void death( SimulationContext &c );
+		// called when the context's last CPUObject is destroyed
 
 };
 
@@ -97,4 +110,12 @@ inline void CPUObject::set_mask( unsigned long m ) {
 	mask = m;
 }
 
+inline unsigned int CPUObject::serialNumber() const {
+	return serial;
+}
+
+inline SimulationContext &CPUObject::context() const {
+	return *ctx;
+}
+
 #endif
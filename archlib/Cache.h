@@ -0,0 +1,201 @@
+// Cache.h
+//
+// A set-associative cache in front of a Memory.
+//
+// A Cache has a MAR, a WRITE InFlow and a READ OutFlow just like a
+// Memory's, and the same read() and write() operations, so a simulator
+// puts one between its datapath and a Memory by making its connections
+// and transfers to the Cache instead:
+//
+//	Memory mem( "Memory", 32, 8, -1, 4 );
+//	Cache dcache( "DCache", mem, 8192, 32, 2 );
+//		// 8K units in 32-unit lines, 2-way set-associative
+//	...
+//	dcache.MAR().latchFrom( addrBus.OUT() );
+//	...
+//	dcache.read();
+//	mdr.latchFrom( dcache.READ() );
+//
+// The data itself stays in the Memory:  reads come from it, and writes
+// go on to it in the same tick, so the Memory can still be loaded,
+// dumped, peeked at and checkpointed as before.  What the Cache keeps is
+// which lines it holds, which of those are dirty, and the order to
+// replace them in; that is enough to know whether an access hits and
+// what a miss costs, which is all the cache changes about a run.
+//
+// An access through the Cache still takes one tick.  A simulator that
+// wants misses to take longer asks missCost() first and stalls for as
+// many ticks as it says before setting up the access:  nothing is loaded
+// until the access itself, so missCost() keeps giving the same answer
+// until then.  A line costs the miss penalty plus the Memory's latency
+// for it (see Memory::setLatency() and Memory::setDram()) to load, and
+// the Cache tells the Memory when it loads one (Memory::timeAccess()),
+// so that a DRAM's rows are opened and closed in the same order.
+// Write-through writes are not timed.
+//
+// A write-back cache allocates a line on a write miss, and writes a
+// dirty line back when it is replaced, which costs as much again as
+// loading it.  A write-through cache writes every store
+// through to the Memory (a write buffer is assumed to hide the cost)
+// and does not allocate on a write miss.
+//
+// prefetch() loads a line ahead of its use, as a hardware prefetcher in
+// front of the cache would, without counting it as an access.  The line
+// is marked as prefetched until an access first uses it, so that the
+// prefetches that were used and those evicted unused can be counted.  A
+// simulator that wants to know when a prefetched line arrives asks
+// missCost() just before prefetch(), as for a miss.
+//
+// Lines are replaced least recently used first, in tree pseudo-LRU
+// order, or at random (from a generator of the Cache's own, so that runs
+// repeat); an empty way is always used before any line is replaced.
+//
+// Sizes are in the Memory's units, and the number of sets and the line
+// size must be powers of two, as must the associativity for pseudo-LRU.
+//
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <iostream>
+#include <vector>
+
+#include <ArchLibError.h>
+#include <Connector.h>
+#include <ClockedObject.h>
+#include <StorageObject.h>
+#include <InFlow.h>
+#include <OutFlow.h>
+#include <Memory.h>
+
+using namespace std;
+
+class Cache : public Connector, public ClockedObject {
+
+public:
+	enum Replacement { lru, plru, random };
+	enum WritePolicy { writeBack, writeThrough };
+
+	Cache (
+		const char *id,		// name of module
+		Memory &backing,	// the memory it caches
+		unsigned long sizeInUnits, // capacity, in the memory's units
+		int unitsPerLine,	// line size
+		int ways,		// associativity (1 => direct-mapped)
+		Replacement r = lru,
+		WritePolicy w = writeBack,
+		int missPenalty = 10	// ticks to load a line, beyond the
+					// memory's latency
+	);
+	~Cache();
+
+	StorageObject& MAR() { return mar; }
+	// a reference to the cache's address register
+	InFlow & WRITE() { return writeFlow; }
+	// a reference to the cache's ingoing data path for writing
+	OutFlow & READ() { return readFlow; }
+	// a reference to the cache's outgoing data path for reading
+
+	enum Operation { none, readOp, writeOp };
+	void perform( Operation o );	// to be performed on the next clock
+	void read() { perform( readOp ); } // shorthand for perform(readOp)
+	void write() { perform( writeOp ); } // shorthand for perform(writeOp)
+
+	int badAddress();
+		// as Memory::badAddress(), for the access just completed
+
+	int missCost( unsigned long addr, bool write ) const;
+		// the ticks a read or write at addr would wait before it
+		// could go ahead:  0 if it hits (or is a write-through write
+		// miss), else the miss penalty and memory latency for each
+		// line it misses in, and for each dirty line that would be
+		// written back to make room
+	bool holds( unsigned long addr ) const;
+		// whether the line holding addr is in the cache
+	bool prefetch( unsigned long addr );
+		// load the line holding addr, if it is not held, as a miss
+		// would but without counting an access; true if it was
+		// loaded
+	int unitsPerLine() const { return 1 << lineBits; }
+
+	unsigned long reads() const { return nreads; }
+	unsigned long writes() const { return nwrites; }
+	unsigned long readMisses() const { return nreadMisses; }
+	unsigned long writeMisses() const { return nwriteMisses; }
+	unsigned long evictions() const { return nevictions; }
+	unsigned long writebacks() const { return nwritebacks; }
+		// accesses, and those that missed in at least one line;
+		// valid lines replaced, and dirty ones among them
+	unsigned long prefetches() const { return nprefetches; }
+	unsigned long usefulPrefetches() const { return nprefetchHits; }
+	unsigned long unusedPrefetches() const { return nprefetchesUnused; }
+		// lines prefetched, those an access went on to use, and
+		// those replaced before any did
+	void printStats( ostream &o = cout ) const;
+		// the configuration, and the counts above with the miss rate
+
+protected:
+	void phase1();
+	void phase2();
+
+	void saveState( ostream &o, bool incremental );
+	void restoreState( istream &i );
+		// the lines held and their replacement order (not the counts)
+
+private:
+	long computeValue();
+
+	int find( unsigned long line ) const;
+		// the way holding line in its set, or -1
+	int victim( unsigned long set ) const;
+		// the way the next line loaded into set would replace
+	void touch( unsigned long set, int way );
+		// note a use of way, for replacement
+	int fill( unsigned long line );
+		// load line into its set, replacing the victim, and give
+		// the way it went into
+	bool reference( unsigned long line, bool write );
+		// do the bookkeeping for an access to line, loading it if
+		// need be; true if it hit
+	void access( unsigned long addr, bool write );
+		// ...for every line an access at addr touches, and count it
+
+	enum { valid = 1, dirty = 2, prefetched = 4 };	// line flags
+
+	Memory &memory;
+	Operation op;
+	StorageObject mar;
+	InFlow writeFlow;
+	OutFlow readFlow;
+
+	unsigned long currentAddr;
+	long newValue;
+	int rangeError;
+
+	int dataPathWidth;	// units per access, as the memory's
+	int lineBits;		// log2 of units per line
+	int setBits;		// log2 of sets
+	int numWays;
+	Replacement replacement;
+	WritePolicy writePolicy;
+	int penalty;
+
+	vector<unsigned long> tags;	// [set * numWays + way]: line number
+	vector<unsigned char> flags;	// ...valid, dirty
+	vector<unsigned long> lastUse;	// ...use count at last use (LRU)
+	vector<unsigned long> treeBits;	// [set]: pseudo-LRU tree
+	unsigned long uses;		// accesses so far, for lastUse
+	unsigned long seed;		// random replacement's generator
+
+	unsigned long nreads;
+	unsigned long nwrites;
+	unsigned long nreadMisses;
+	unsigned long nwriteMisses;
+	unsigned long nevictions;
+	unsigned long nwritebacks;
+	unsigned long nprefetches;
+	unsigned long nprefetchHits;
+	unsigned long nprefetchesUnused;
+};
+
+#endif
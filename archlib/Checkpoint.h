@@ -0,0 +1,50 @@
+// Checkpoint.h
+//
+// Saving and restoring the state of an entire simulation.
+//
+//    Do not declare any instances of Checkpoint.  All functions are
+//    static.
+//
+//    save() writes the simulated time and the state of every
+//    ClockedObject (registers, pending operations, memory contents) to
+//    a file; restore() puts them back.  The simulator doing the restore
+//    must have created the same objects, with the same names, in the
+//    same order as the one that saved; in practice that means the same
+//    program, before its first tick.  Take checkpoints between ticks,
+//    before any latchFrom() has been set up for the next one.
+//
+//    A checkpoint saved with a base file name is incremental:  memory
+//    pages that have not been written since the previous save are left
+//    out, and restoring it first restores the base.  The base must be
+//    the checkpoint saved immediately before it.
+//
+//    Checkpoint files are in host byte order and are not portable.
+//
+//    put(), get(), putBytes() and getBytes() are for the saveState()
+//    and restoreState() functions of ClockedObject subclasses.
+//
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <iostream>
+
+#include <ArchLibError.h>
+
+using namespace std;
+
+class Checkpoint {
+
+public:
+	static void save( const char *fileName, const char *baseName = 0 );
+	static void restore( const char *fileName );
+
+	static void put( ostream &o, unsigned long v );
+	static unsigned long get( istream &i );
+	static void putBytes( ostream &o, const void *p, unsigned long n );
+	static void getBytes( istream &i, void *p, unsigned long n );
+
+	enum { Version = 1 };
+};
+
+#endif
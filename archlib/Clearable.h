@@ -38,6 +38,9 @@ protected:
 	void phase1();
 	// void phase2();
 
+	void saveState( ostream &o, bool incremental );
+	void restoreState( istream &i );
+
 private:
 	Operation change;
 
@@ -18,6 +18,14 @@
 //    StorageObjects and Memory.  It sends them all the phase1() and
 //    phase2() messages when Clock::tick() is invoked.
 //
+//    Clock acts on the current SimulationContext, which holds the time
+//    and the objects; each context has a clock of its own.
+//
+//    In activeObjects scheduling mode, only the ClockedObjects that
+//    were given something to do since the previous tick (a latchFrom(),
+//    a perform(), a new value) receive phase1() and phase2(); idle
+//    objects such as constant registers are skipped entirely.
+//
 
 #ifndef _CLOCK_H_
 #define _CLOCK_H_
@@ -26,6 +34,8 @@
 #include <ClockedObject.h>
 #include <COSet.h>
 
+#include <vector>
+
 using namespace std;
 
 class Clock {
@@ -41,14 +51,20 @@ public:
 
 	static long getTime();
 
+	enum Scheduling { allObjects, activeObjects };
+	static void setScheduling( Scheduling s );
+		// allObjects (the default) visits every ClockedObject on
+		// every tick; activeObjects visits only those that were
+		// activated since the last tick.  May be changed at any time.
+	static Scheduling getScheduling();
+
 private:
-	static void birth(); // sets up everything
-	static void death(); // tears down everything; prints post-mortem
+	static void birth( SimulationContext &c ); // sets up everything
+	static void death( SimulationContext &c );
+		// tears down everything; prints post-mortem
 	static void announce( ClockedObject *obj );
-
-	static int howMany; // should go from 0 to 1, then stay there
-	static long time;
-	static ClockedObjectSet *objList;
+	static void activate( ClockedObject *obj );
+	static void deactivate( ClockedObject *obj );
 
 };
 
@@ -22,10 +22,21 @@
 // The major subclass of ClockedObject is StorageObject, a register.
 // There is also Memory.
 //
+// Whenever a subclass is given work for the next clock (a latchFrom(),
+// a perform(), a new value), it must call activate() so that the Clock
+// visits it even when only active objects are being scheduled.
+//
+// Subclasses with state of their own should augment saveState() and
+// restoreState() so that Checkpoint can save and restore it.  A class
+// that combines several StorageObject subclasses must override them
+// itself, since each subclass also saves the StorageObject.
+//
 
 #ifndef _CLOCKEDOBJECT_H_
 #define _CLOCKEDOBJECT_H_
 
+#include <iostream>
+
 #include <CPUObject.h>
 
 using namespace std;
@@ -41,9 +52,28 @@ public:
 
 protected:
 	friend class Clock;
+	friend class Checkpoint;
 	virtual void phase1() = 0;
 	virtual void phase2() = 0;
 
+	virtual void saveState( ostream &o, bool incremental );
+	virtual void restoreState( istream &i );
+		// write or read back everything that changes as we run;
+		// incremental means "only what changed since the last save"
+
+	void activate();
+		// ask for phase1() and phase2() on the next tick
+
+private:
+	void enqueue();
+	bool scheduled;	// already on the Clock's active list?
+
 };
 
+inline void ClockedObject::activate() {
+	if( !scheduled ) {
+		enqueue();
+	}
+}
+
 #endif
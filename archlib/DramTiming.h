@@ -0,0 +1,95 @@
+// DramTiming.h
+//
+// The timing of a banked DRAM, for a Memory's latency.
+//
+// A Memory given a DramTiming (see Memory::setDram()) adds what the DRAM
+// says each access costs to its latency.  The DRAM is divided into banks,
+// each of which has a row buffer holding at most one open row; rows are
+// interleaved across the banks, so that consecutive rows fall in
+// consecutive banks:
+//
+//	bank = (addr / rowSize) % banks
+//	row  =  addr / (rowSize * banks)
+//
+// Under the open-page policy a row is left open after an access.  The
+// next access to the bank then either hits in the open row (tCAS), finds
+// the bank closed (tRCD + tCAS, only before its first access), or
+// conflicts with the open row, which must be closed first (tRP + tRCD +
+// tCAS).  Under the closed-page policy every row is closed again as soon
+// as it has been accessed, with the precharge hidden, so every access
+// costs tRCD + tCAS and counts as a row miss.
+//
+// Sizes are in the Memory's units and times in ticks.  Only the order of
+// the accesses matters, not how far apart they are:  a bank is taken to
+// be ready for the next access as soon as the last one completes.
+//
+// Do not call access() on a DramTiming given to a Memory; the Memory
+// keeps its own copy, and calls it for every access it times.
+//
+
+#ifndef _DRAMTIMING_H_
+#define _DRAMTIMING_H_
+
+#include <iostream>
+#include <vector>
+
+#include <ArchLibError.h>
+
+using namespace std;
+
+class DramTiming {
+
+	friend class Memory;
+
+public:
+	enum PagePolicy { openPage, closedPage };
+
+	DramTiming (
+		int numBanks,		// banks, each with its own row buffer
+		unsigned long unitsPerRow, // row size, in the memory's units
+		int tRCD,		// ticks to open a row (activate)
+		int tCAS,		// ticks to access an open row
+		int tRP,		// ticks to close a row (precharge)
+		PagePolicy p = openPage
+	);
+
+	int cost( unsigned long addr ) const;
+		// ticks an access at addr would take now
+	int cost( unsigned long addr, unsigned long after ) const;
+		// ...or just after an access at after
+	int access( unsigned long addr );
+		// make an access at addr, opening or closing rows as the
+		// policy says, count it, and give its cost
+
+	unsigned long rowHits() const { return nhits; }
+	unsigned long rowMisses() const { return nmisses; }
+	unsigned long rowConflicts() const { return nconflicts; }
+		// accesses that found their row open, found their bank
+		// closed, and found another row open
+	void printStats( ostream &o = cout ) const;
+		// the configuration, and the counts above with the row-hit
+		// rate
+
+private:
+	int bankOf( unsigned long addr ) const;
+	long rowOf( unsigned long addr ) const;
+	int costWith( unsigned long addr, long openRow ) const;
+		// as cost(addr), if the bank's open row were openRow
+
+	enum { closed = -1 };	// a bank's open row, when it has none
+
+	int banks;
+	unsigned long rowSize;
+	int activate;		// tRCD
+	int columnAccess;	// tCAS
+	int precharge;		// tRP
+	PagePolicy policy;
+
+	vector<long> openRows;	// [bank]: the row open in it, or closed
+
+	unsigned long nhits;
+	unsigned long nmisses;
+	unsigned long nconflicts;
+};
+
+#endif
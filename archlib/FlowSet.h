@@ -7,6 +7,19 @@
 //
 // updated by:		Warren Carithers
 //			November 2002
+//
+// Members are kept in a contiguous array, in the order added, and
+// membership is tracked by serial number so that contains(), which
+// every pullFrom() and latchFrom() validation goes through, takes
+// constant time regardless of fan-in.
+//
+// add() of a flow already in the set does nothing, so a flow connected
+// twice is kept (and handed out by first()/next()) only once; the old
+// linked list kept both copies, though only contains() ever looked.
+// remove() takes the oldest member off the front of the array, which
+// moves every other member down one, so it takes time linear in the
+// size of the set.  Nothing in the library removes members while
+// simulating; only add() and contains() are on the connection paths.
 
 //
 // Internal implementation class -- not for client simulators
@@ -15,25 +28,20 @@
 #ifndef _FLOWSET_H_
 #define _FLOWSET_H_
 
-using namespace std;
+#include <vector>
 
-class Flow;
+#include <SerialBits.h>
 
-class FlowNode {
+using namespace std;
 
-public:
-	const Flow* thing;
-	FlowNode* next;
-	FlowNode ( const Flow* flow, FlowNode* link=0 );
-	~FlowNode();
-};
+class Flow;
 
 class FlowSet {
 
 private:
-	FlowNode* head;
-	FlowNode* rear;
-	FlowNode* current;
+	vector<const Flow *> items;
+	SerialBits members;
+	unsigned int current;
 
 public:
 	FlowSet();
@@ -43,6 +43,7 @@ public:
 		// For tracing only; do not call.
 
 private:
+	friend class Schedule;
 	const StorageObject *source;
 
 };
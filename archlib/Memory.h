@@ -15,13 +15,60 @@
 // OutFlow.  Multi-unit transfer and detection of improper addresses
 // are supported.
 // 
-// Do not use LongArray.  It is part of Memory's implementation.
+// Do not use UnitArray.  It is part of Memory's implementation.
+// It stores each addressable unit in the narrowest of 8, 16, 32 or
+// 64 bits that holds bitsPerUnit, so a byte-addressed memory takes
+// one host byte per unit.
+//
+// Small memories are one flat array.  Memories too large for that
+// (e.g. a full 32-bit address space) are kept as 4K-unit pages that
+// are only allocated when first written; until then they read as the
+// fill value (zero, or the defaultValue given to load()).  The cost of
+// construction and of load() thus depends on the pages touched, not
+// on the size of the address space.
+//
+// Each page (or, in a flat array, each 4K-unit stretch) remembers whether
+// it has been written since the last checkpoint, so that incremental
+// checkpoints save only those.
+//
+// When each unit exactly fills its host type and the data path is a
+// power-of-two number of units, a multi-unit read or write that lies
+// within one page is done as a single host load or store.  Other
+// configurations, and accesses that straddle a page, go unit by unit.
+//
+// By default a read or write completes in the tick it is performed in.
+// setLatency() makes accesses take longer, everywhere or in given ranges
+// of addresses.  An access with a latency of n ticks is started by the
+// first tick it is performed in, and completes when it is performed again
+// (with the same address in MAR) n or more ticks later; until then the
+// memory is busy, and neither reads nor writes, and a read's value may
+// not be pulled from READ.  There is no ready or busy signal to latch:
+// a simulator finds out how long to wait by polling, asking latency()
+// before it starts an access and ticksToWait() while one is waiting, and
+// ticks the clock that many times.  Performing a different access while
+// one is waiting is an error.  Latency is not part of a checkpoint, but
+// the access in progress is.
+//
+// setDram() adds the timing of a banked DRAM (see DramTiming.h) to the
+// latency, so that an access costs more or less depending on which rows
+// the accesses before it left open.  The DRAM's open rows are part of a
+// checkpoint, and are restored if the DRAM has as many banks as the one
+// saved.  Every access a Memory times, through read() and write() or
+// through timeAccess() (for a Cache loading or writing back a line), is
+// counted for printLatencyStats().
+//
+// setNonBlocking() lets reads and writes complete in the tick they are
+// performed in whatever their latency (they are still timed), for a
+// simulator that keeps track of when each would really complete itself,
+// e.g. to let several loads be outstanding at once.  It asks latency()
+// before performing the access.
 //
 
 #ifndef _MEMORY_H_
 #define _MEMORY_H_
 
 #include <iostream>
+#include <vector>
 
 #include <ArchLibError.h>
 #include <Connector.h>
@@ -29,25 +76,155 @@
 #include <StorageObject.h>
 #include <InFlow.h>
 #include <OutFlow.h>
+#include <ProgramImage.h>
+#include <DramTiming.h>
 
 using namespace std;
 
 class Memory;
 
-class LongArray {
+class UnitArray {
 
 	friend class Memory;
 
 private:
-	LongArray();
-	~LongArray();
-	void allocate( long sz );
+	UnitArray();
+	~UnitArray();
+	void allocate( long sz, int bitsPerUnit, bool sparse );
 	long get( long index );
 	void put( long index, long value );
+	void fill( long value );
+	unsigned char *span( long index, long n, bool write );
+		// contiguous storage for units index..index+n-1, or 0
+	void copyIn( long index, const unsigned char *src, long n );
+		// store n units already in our width and host byte order
+	void save( ostream &o, bool incremental );
+	void restore( istream &i );
+		// checkpoint the pages written since the last save, or all
+
+	enum {	PageBits = 12,			// units per page: 4K
+		TableBits = 10,			// pages per table: 1K
+		PageMask = (1 << PageBits) - 1,
+		TableMask = (1 << TableBits) - 1 };
+
+	unsigned char *page( long index ) const;
+		// page holding index, or 0 if never written
+	unsigned char *touch( long index );
+		// page holding index, allocated if necessary, marked dirty
+	void release();		// free all pages
+	long load( const unsigned char *base, long i ) const;
+	void store( unsigned char *base, long i, long value ) const;
+		// unit i of a flat array or page, at our unit width
+
 	long size;
-	long *data;
+	int unitBytes;		// 1, 2, 4 or sizeof(long)
+	unsigned char *data;	// flat array, if not paged
+
+	bool paged;
+	long fillValue;		// what unwritten pages read as
+	long numTables;
+	unsigned char ***tables; // tables[i][j] is page (i<<TableBits)|j
+				// each page is followed by its dirty flag
+
+	vector<unsigned char> dirty; // flat array's dirty flags, per 4K
+	bool cleared;		// fill() since the last save
 };
 
+inline unsigned char *UnitArray::page( long index ) const {
+	unsigned char **t = tables[ index >> (PageBits + TableBits) ];
+
+	return t ? t[ (index >> PageBits) & TableMask ] : 0;
+}
+
+inline long UnitArray::load( const unsigned char *base, long i ) const {
+
+	switch( unitBytes ) {
+		case 1:
+			return base[i];
+		case 2:
+			return ((const unsigned short *)base)[i];
+		case 4:
+			return ((const unsigned int *)base)[i];
+		default:
+			return ((const unsigned long *)base)[i];
+	}
+}
+
+inline void UnitArray::store( unsigned char *base, long i, long value ) const {
+
+	switch( unitBytes ) {
+		case 1:
+			base[i] = (unsigned char)value;
+			break;
+		case 2:
+			((unsigned short *)base)[i] = (unsigned short)value;
+			break;
+		case 4:
+			((unsigned int *)base)[i] = (unsigned int)value;
+			break;
+		default:
+			((unsigned long *)base)[i] = (unsigned long)value;
+	}
+}
+
+inline unsigned char *UnitArray::span( long index, long n, bool write ) {
+
+	if( !paged ) {
+		if( write ) {
+			dirty[ index >> PageBits ] = 1;
+			dirty[ (index + n - 1) >> PageBits ] = 1;
+		}
+		return data + index * unitBytes;
+	}
+	if( (index & PageMask) + n > (1 << PageBits) ) {
+		return 0;
+	}
+
+	unsigned char *base = write ? touch( index ) : page( index );
+
+	return base ? base + (index & PageMask) * unitBytes : 0;
+}
+
+inline long UnitArray::get( long index ) {
+
+	if( index >= size ) {
+		cout << "Illegal address " << index
+		     << " for memory data array" << endl;
+		throw ArchLibError( "Memory::UnitArray illegal address used for get" );
+	}
+
+	unsigned char *base = data;
+
+	if( paged ) {
+		if( !(base = page( index )) ) {
+			return fillValue;
+		}
+		index &= PageMask;
+	}
+
+	return load( base, index );
+}
+
+inline void UnitArray::put( long index, long value ) {
+
+	if( index >= size ) {
+		cout << "Illegal address " << index
+		     << " for memory data array" << endl;
+		throw ArchLibError( "Memory::UnitArray illegal address used for put" );
+	}
+
+	unsigned char *base = data;
+
+	if( paged ) {
+		base = touch( index );
+		index &= PageMask;
+	} else {
+		dirty[ index >> PageBits ] = 1;
+	}
+
+	store( base, index, value );
+}
+
 class Memory : public Connector, public ClockedObject {
 
 public:
@@ -81,6 +258,10 @@ public:
 		// all in hex.  Last line is starting address for program,
 		// ready to be latched through the READ OutFlow.
 		// Rest of memory is initialized to defaultValue.
+		// The file may also be a binary image; see ProgramImage.h.
+	void load( const ProgramImage &image, long defaultValue = 0 );
+		// As above, from a program already read in.  An image can
+		// be loaded into any number of memories.
 	void dump( unsigned long startAddr, unsigned long endAddr,
 		   ostream &o = cout );
 		// diagnostic memory dump for debugging.
@@ -91,13 +272,63 @@ public:
 	int badAddress();
 		// Reflects just completed read or write; this ought to be
 		// called after every such operation, e.g. to cause a trap.
+	int unitsInDataPath() const { return dataPathWidth; }
+		// units moved by each read or write
+
+	void setLatency( int ticks );
+		// extra ticks taken by every read or write, except as below
+	void setLatency( unsigned long firstAddr, unsigned long lastAddr,
+			 int ticks );
+		// ...or by those starting at firstAddr through lastAddr; the
+		// range given last wins where ranges overlap
+	void setDram( const DramTiming &timing );
+		// add the timing of a DRAM (copied) to the latency
+	int latency( unsigned long addr ) const;
+		// extra ticks a read or write starting at addr would take now
+	int latency( unsigned long addr, unsigned long after ) const;
+		// ...or just after one starting at after
+	int timeAccess( unsigned long addr );
+		// note an access at addr that is made now without reading or
+		// writing the memory (e.g. a cache's line fill), and give
+		// its latency
+	void setNonBlocking( bool on );
+		// let every access complete at once, leaving the latency to
+		// the simulator (see above)
+	bool hasLatency() const { return timed; }
+		// whether any access may take extra ticks
+	void printLatencyStats( ostream &o = cout ) const;
+		// the accesses timed and their average latency, and the
+		// DRAM's row hits, misses and conflicts if it has one
+	long ticksToWait() const;
+		// ticks still to pass before the access being waited for
+		// can complete; 0 if it can on the next tick, or if no
+		// access is waiting
+
+	long peek( unsigned long addr );
+	void poke( unsigned long addr, long value );
+		// Read or write a data path's worth of units at addr right
+		// away, without MAR or the clock, for simulators that
+		// interpret a program rather than clocking hardware.  An
+		// address out of range reads as 0, writes nothing, and is
+		// reported by badAddress().  Not traced.
 
 protected:
 	void phase1();
 	void phase2();
 
+	void saveState( ostream &o, bool incremental );
+	void restoreState( istream &i );
+
 private:
 	long computeValue();
+	long readUnits( unsigned long addr );
+	void writeUnits( unsigned long addr, long value );
+		// the multi-unit transfer itself; addr must be in range
+	bool proceeds();
+		// whether the read or write performed this tick goes ahead,
+		// rather than starting or continuing to wait
+	int rangeLatency( unsigned long addr ) const;
+		// the latency set for addr, without the DRAM's
 
 	Operation op;
 	StorageObject mar;
@@ -107,7 +338,7 @@ private:
 	unsigned long currentAddr;
 	long newValue;
 
-	LongArray mem;
+	UnitArray mem;
 
 	unsigned long highPoint;
 	int unitSize;
@@ -120,6 +351,28 @@ private:
 	int dataFieldWidth;
 
 	bool byteSwap;
+	bool wideAccess;	// whole data path moves as one host word
+
+	struct LatencyRange {
+		unsigned long first;
+		unsigned long last;
+		int ticks;
+	};
+
+	int fixedLatency;
+	vector<LatencyRange> latencyRanges;
+	DramTiming *dram;	// if any
+	bool timed;		// any latency at all
+	bool nonBlocking;	// ...but none waited for
+	unsigned long ntimed;	// accesses timed...
+	unsigned long timedTicks; // ...and their latencies in all
+
+	Operation waitOp;	// the access waiting, if any
+	unsigned long waitAddr;
+	long waitStart;		// tick it started in
+	int waitTicks;
+	long decidedAt;		// tick proceeds() last decided for...
+	bool decision;		// ...and what it decided
 };
 
 #endif
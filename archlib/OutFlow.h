@@ -36,6 +36,7 @@ public:
 		// OutFlows get their values from their Connectors
 
 private:
+	friend class Schedule;
 	Connector &connector;
 };
 
@@ -0,0 +1,110 @@
+// ProgramImage.h
+//
+// A program to be loaded into one or more Memory objects.
+//
+// A ProgramImage is read once from either of two file formats and may
+// then be handed to Memory::load() any number of times, e.g. once for
+// an instruction memory and once for a data memory.
+//
+// The text object format is the one Memory has always read:  lines of
+// <addr> <#units> <unit1> ... <unitN>, all in hex, followed by a lone
+// starting address.
+//
+// The binary image format is laid out so that it can be mapped into
+// the simulator and copied into Memory without any parsing.  All
+// fields are little-endian:
+//
+//	header		"AIMG", version, bytes per unit, #segments,
+//			starting address (64 bits), #symbols, reserved
+//	segments	#segments x { address, #units, file offset }
+//			(64 bits each)
+//	symbols		#symbols x { value (64 bits), name offset,
+//			name length (32 bits each) }
+//	names		symbol names, not NUL-terminated
+//	units		each segment's units, bytes-per-unit each
+//
+// The format is recognized by its magic number, so a binary image may be
+// named anywhere a text object file can.  Use the objconv tool to make
+// one from a text object file.
+//
+
+#ifndef _PROGRAMIMAGE_H_
+#define _PROGRAMIMAGE_H_
+
+#include <string>
+#include <vector>
+
+#include <ArchLibError.h>
+
+using namespace std;
+
+class ProgramImage {
+
+public:
+	ProgramImage( const char *fileName );
+	~ProgramImage();
+
+	struct Segment {
+		unsigned long addr;	// address of first unit
+		unsigned long count;	// number of units
+		const unsigned char *units; // unitBytes() each, little-endian
+	};
+
+	struct Symbol {
+		string name;
+		unsigned long value;
+	};
+
+	const char *fileName() const { return name.c_str(); }
+	bool isBinary() const { return binary; }
+	int unitBytes() const { return bytesPerUnit; }
+	unsigned long entry() const { return entryPoint; }
+
+	int numSegments() const { return segments.size(); }
+	const Segment &segment( int i ) const { return segments[i]; }
+	long unit( const Segment &s, unsigned long i ) const;
+		// value of unit i of segment s
+
+	int numSymbols() const { return symbols.size(); }
+	const Symbol &symbol( int i ) const { return symbols[i]; }
+	bool lookup( const char *sym, unsigned long &value ) const;
+	void addSymbol( const char *sym, unsigned long value );
+
+	void write( const char *outName ) const;
+		// save as a binary image
+
+	enum { Version = 1 };
+
+private:
+	ProgramImage( const ProgramImage & );		// not copyable
+	ProgramImage &operator=( const ProgramImage & );
+
+	void parseBinary();
+	void parseText();
+	void corrupt( const char *why );
+
+	string name;
+	bool binary;
+	int bytesPerUnit;
+	unsigned long entryPoint;
+
+	vector<Segment> segments;
+	vector<Symbol> symbols;
+
+	const unsigned char *file;	// mapped file contents
+	unsigned long fileSize;
+	vector<unsigned char> textUnits; // units parsed from a text file
+};
+
+inline long ProgramImage::unit( const Segment &s, unsigned long i ) const {
+	const unsigned char *p = s.units + i * bytesPerUnit;
+	unsigned long v = 0;
+
+	for( int b = bytesPerUnit - 1; b >= 0; b-- ) {
+		v = (v << 8) | p[b];
+	}
+
+	return v;
+}
+
+#endif
@@ -37,6 +37,7 @@ protected:
 
 private:
 	void printOn( ostream &o ) const;
+	int traceStyle() const;
 	long latestTime;
 };
 
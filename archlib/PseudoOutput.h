@@ -32,6 +32,7 @@ protected:
 
 private:
 	void printOn( ostream &o ) const;
+	int traceStyle() const;
 };
 
 #endif
@@ -0,0 +1,156 @@
+// Schedule.h
+//
+// Recorded clock-tick transfers, for replay on later ticks.
+//
+// A simulator that sets up every tick with the same few pullFrom(),
+// latchFrom() and perform() calls (chosen from the same few pieces of
+// state) can record the calls it makes for one tick into a Schedule and,
+// the next time the same state comes around, replay() the Schedule
+// instead of making the calls again:
+//
+//	s.begin();
+//	... pullFrom(), latchFrom(), perform() as usual ...
+//	s.end();
+//	Clock::tick();
+//	...
+//	s.replay();	// exactly the same transfers
+//	Clock::tick();
+//
+// Recording does not change what the calls do, and they are checked as
+// usual; replay skips the checks (they passed when the calls were
+// recorded) and sets up the transfers directly.  A latchFrom() of a Bus
+// whose input was pulled in the same Schedule is replayed as a direct
+// copy from the source to the destination register, without going
+// through the Bus, unless tracing is on.
+//
+// Only pullFrom(), latchFrom(), perform() (and its shorthands) and the
+// ShiftRegister input calls are recorded.  Anything else the simulator
+// does while setting up a tick, such as deciding to halt, has to be done
+// whether or not the tick is replayed.
+//
+// A ScheduleCache keeps one Schedule per key, where the key is whatever
+// state the simulator's choice of calls depends on (e.g. the instruction
+// registers of a pipeline and the outcomes of any data-dependent tests).
+//
+
+#ifndef _SCHEDULE_H_
+#define _SCHEDULE_H_
+
+#include <vector>
+
+#include <ArchLibError.h>
+
+using namespace std;
+
+class InFlow;
+class OutFlow;
+class StorageObject;
+class Counter;
+class Clearable;
+class ShiftRegister;
+class Memory;
+class Cache;
+class BusALU;
+
+class Schedule {
+
+public:
+	Schedule();
+	~Schedule();
+
+	void begin();
+		// record the transfers set up from now on...
+	void end();
+		// ...until now, replacing anything recorded before
+	void replay() const;
+		// set up the recorded transfers for the next tick
+	int size() const { return actions.size(); }
+
+	static bool recording() { return current != 0; }
+
+	// Called by the library's components while a Schedule is being
+	// recorded; do not call.
+	static void notePull( InFlow &i, StorageObject &so );
+	static void noteLatch( StorageObject &so, OutFlow &o );
+	static void noteCount( Counter &c, int op );
+	static void noteClear( Clearable &c, int op );
+	static void noteShift( ShiftRegister &s, int op );
+	static void noteShiftInput( ShiftRegister &s, StorageObject &so,
+				    int left );
+	static void noteMemory( Memory &m, int op );
+	static void noteCache( Cache &c, int op );
+	static void noteALU( BusALU &a, int op );
+
+private:
+	enum Kind { pull, pullEnable, latch, copy, count, clear, shift,
+		    shiftLeftInput, shiftRightInput, memory, cache, alu };
+
+	struct Action {
+		int kind;
+		int op;
+		InFlow *in;
+		StorageObject *so;	// pulled from, or latching
+		OutFlow *out;
+		const StorageObject *from;	// copy: ...via a Bus
+		unsigned long mask;		// ...this wide
+		union {
+			Counter *counter;
+			Clearable *clearable;
+			ShiftRegister *shiftRegister;
+			Memory *memory;
+			Cache *cache;
+			BusALU *busALU;
+		} target;
+	};
+
+	static Action &note( int kind );
+	void compile();
+
+	vector<Action> actions;
+
+	static __thread Schedule *current;	// being recorded on this thread
+};
+
+class ScheduleCache {
+
+public:
+	typedef vector<unsigned long> Key;
+
+	ScheduleCache();
+	~ScheduleCache();
+
+	bool replay( const Key &k );
+		// replay the Schedule recorded for k, if there is one
+	void record( const Key &k );
+		// start recording the Schedule for k...
+	void end();
+		// ...and finish it
+
+	void clear();		// forget every Schedule
+	int size() const { return count; }
+	unsigned long hits() const { return nhits; }
+	unsigned long misses() const { return nmisses; }
+
+private:
+	ScheduleCache( const ScheduleCache & );		// not copyable
+	ScheduleCache &operator=( const ScheduleCache & );
+
+	struct Entry {
+		Key key;
+		unsigned long hash;
+		Schedule schedule;
+		Entry *next;
+	};
+
+	static unsigned long hash( const Key &k );
+	Entry *find( const Key &k, unsigned long h ) const;
+	void grow();
+
+	vector<Entry *> buckets;
+	int count;
+	Entry *recording;
+	unsigned long nhits;
+	unsigned long nmisses;
+};
+
+#endif
@@ -0,0 +1,43 @@
+// SerialBits.h
+//
+// A growable bit vector indexed by CPUObject serial number.
+//
+// Internal implementation class -- not for client simulators
+//
+// Every CPUObject is handed a small, dense serial number when it is
+// created (see CPUObject::serialNumber()).  The object sets use a
+// SerialBits to answer "is this object a member?" in constant time,
+// no matter how many members there are.
+//
+
+#ifndef _SERIALBITS_H_
+#define _SERIALBITS_H_
+
+#include <vector>
+
+using namespace std;
+
+class SerialBits {
+
+public:
+	SerialBits();
+	~SerialBits();
+	void set( unsigned int n );
+	void reset( unsigned int n );
+	int test( unsigned int n ) const;
+	void clear();		// reset all bits
+
+private:
+	enum { WordBits = 8 * sizeof(unsigned long) };
+
+	vector<unsigned long> words;
+};
+
+inline int SerialBits::test( unsigned int n ) const {
+	unsigned int w = n / WordBits;
+
+	return w < words.size() &&
+	       ( (words[w] >> (n % WordBits)) & 1UL ) != 0;
+}
+
+#endif
@@ -56,6 +56,9 @@ public:
 protected:
 	void phase1();
 
+	void saveState( ostream &o, bool incremental );
+	void restoreState( istream &i );
+
 private:
 	Operation change;
 	StorageObject *lefterly;
@@ -0,0 +1,93 @@
+// SimulationContext.h
+//
+// Everything one simulated machine shares:  its clock, the objects it is
+// made of, its debug flags, its trace sink and where its messages go.
+//
+//    Each thread has a current context, and every CPUObject belongs to
+//    the context that was current on its thread when it was created.
+//    A new SimulationContext becomes current as soon as it is created,
+//    so a machine built right after its context belongs to it.  A
+//    thread that never creates one gets a default context, which is how
+//    single-machine simulators keep working unchanged.
+//
+//    The static interfaces (Clock, Trace, Checkpoint, CPUObject::debug)
+//    act on the current context, so a machine must be run on a thread
+//    where its context is current:  several machines may run at once,
+//    one per thread, or in turns on one thread by calling makeCurrent()
+//    before working with each.
+//
+//    CPUObject::debug holds the current context's debug flags;
+//    makeCurrent() puts away the old context's flags and brings in the
+//    new one's.  A new context starts with the flags in effect when it
+//    is created.
+//
+//    The banner, the end-of-simulation summary, Memory load messages and
+//    trace text go to the context's output stream (cout by default).
+//    Error messages still go to cout.
+//
+//    A context must outlive the objects that belong to it.  A thread's
+//    default context is deleted when the thread exits, so objects made
+//    in it must not outlive the thread.
+//
+
+#ifndef _SIMULATIONCONTEXT_H_
+#define _SIMULATIONCONTEXT_H_
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+class ClockedObject;
+class ClockedObjectSet;
+class SerialBits;
+class TraceSink;
+
+class SimulationContext {
+
+public:
+	SimulationContext();
+	SimulationContext( ostream &o );
+	~SimulationContext();
+
+	void makeCurrent();
+		// objects created on this thread from now on belong to me,
+		// and the static interfaces act on me
+	static SimulationContext &current();
+
+	ostream &output() { return *out; }
+	long getTime() const { return time; }
+
+private:
+	SimulationContext( const SimulationContext & );	// not copyable
+	SimulationContext &operator=( const SimulationContext & );
+
+	void init();
+
+	friend class CPUObject;
+	friend class Clock;
+	friend class StorageObject;
+	friend class Trace;
+	friend class Checkpoint;
+
+	ostream *out;
+	int debug;			// CPUObject::debug while not current
+
+	unsigned int objCount;		// CPUObject
+	unsigned int nextSerial;
+
+	long time;			// Clock
+	ClockedObjectSet *objList;
+	vector<ClockedObject *> *active;
+	int scheduling;
+
+	int storObjCount;		// StorageObject
+	int backDoorUsed;
+
+	TraceSink *sink;		// Trace
+	SerialBits *named;
+
+	static __thread SimulationContext *currentContext;
+};
+
+#endif
@@ -82,6 +82,15 @@ public:
 		// "undocumented" function!
 		// Sets reg. value without following normal data flow protocol.
 		// Use only when you give up!
+	void poke( long x );
+		// Set the value right away, outside the clock, e.g. to hand
+		// over the state of a program run by an interpreter.  Any
+		// update pending for the next clock is dropped.  Not traced.
+
+	virtual int traceStyle() const;
+		// For tracing only:  how a TraceSink should print me
+		// (one of TraceRecord::Style).  Subclasses that change
+		// printOn() should change this to match.
 
 protected:
 	void set_contents( unsigned long c );
@@ -97,12 +106,16 @@ protected:
 	void printOn( ostream& o ) const; // used by operator<<
 
 	friend class Clock;
+	friend class Schedule;
 	virtual void phase1();
 		// compute the next value (within self or pulled from outside)
 	virtual void phase2();
 		// If value(int) was called, latch new value.
 		// This should NOT be redefined in subclasses,
 		// only augmented.
+
+	void saveState( ostream &o, bool incremental );
+	void restoreState( istream &i );
 	
 	int incoming();
 		// am I hooked up to an OutFlow for a value this cycle?
@@ -115,32 +128,32 @@ protected:
 
 private:
 	OutFlow *newValueSource;	// ...if from the outside
+	const StorageObject *copySource; // ...or straight from a register
+	unsigned long copyMask;		// over a Bus this wide (Schedule)
 	unsigned long contents;		// current visible value
 	int update;
 	unsigned long newContents;	// new value, not yet visible
 					// (pre - phase 2)
 
-	static int storObjCount;
-	static int backDoorUsed;
-
 	FlowSet flows; // to what am I permanently connected?
 };
 
 inline void StorageObject::hello() {
-	storObjCount += 1;
+	context().storObjCount += 1;
 }
 
 inline int StorageObject::goodbye() {
-	storObjCount -= 1;
-	return storObjCount == 0;
+	context().storObjCount -= 1;
+	return context().storObjCount == 0;
 }
 
 inline int StorageObject::incoming() {
-	return newValueSource != 0;
+	return newValueSource != 0 || copySource != 0;
 }
 
 inline void StorageObject::clear_incoming() {
 	newValueSource = 0;
+	copySource = 0;
 }
 
 inline int StorageObject::updating() {
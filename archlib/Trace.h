@@ -0,0 +1,161 @@
+// Trace.h
+//
+// Where CPUObject::trace output goes.
+//
+//    Do not declare any instances of Trace.  All functions are static,
+//    and are called by the library's components when tracing is on;
+//    client simulators only need setSink().
+//
+//    By default trace output is printed to cout as it happens, exactly
+//    as it always has been.  A TraceSink may be installed instead, in
+//    which case each trace event is handed to it as a fixed-size binary
+//    TraceRecord, and the first time an object appears in a record the
+//    sink is told its name.  BinaryTraceSink buffers the records and
+//    writes them to a file from another thread; the tracedump tool
+//    turns such a file back into the text that would have been printed.
+//
+//    Only the library's own trace output goes to the sink; anything the
+//    simulator itself prints still goes to cout.
+//
+//    The sink, and the set of objects it has been told about, belong
+//    to the current SimulationContext; text output goes to the
+//    context's output stream.
+//
+// TraceFormat holds the text for each kind of trace event, so that the
+// live output and tracedump are guaranteed to agree.
+//
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <iostream>
+
+#include <SerialBits.h>
+#include <SimulationContext.h>
+
+using namespace std;
+
+class CPUObject;
+class StorageObject;
+
+struct TraceRecord {
+
+	enum Kind {
+		name,		// obj is called by the next value bytes;
+				// value2 is its bits
+		nameText,	// 32 more bytes of the name
+		tick,		// start of clock tick value
+		source,		// value from src, via InFlow obj;
+				// op is src's Style
+		transfer,	// "-->value", e.g. result of a Bus
+		aluBegin,	// BusALU obj starts operation op
+		aluComma,	// between the ALU's operands
+		aluEnd,		// ALU result was value
+		flag,		// ALU obj's carry (op 0) or overflow (op 1)
+		constant,	// Constant obj supplied value
+		latch,		// StorageObject obj latched its input
+		count,		// Counter obj incremented (op 0), cleared (1)
+				// or decremented (2) to value; aux: overflow
+		clearSet,	// Clearable obj cleared (op 0) or set (1)
+		shift,		// ShiftRegister obj shifted right (op 0),
+				// left (1) or right arithmetic (2) from
+				// value2 to value
+		memWrite,	// Memory obj stored value at value2
+		memLoad,	// Memory obj supplied loaded value
+		memRead		// Memory obj read value from value2
+	};
+
+	enum Style {		// how a source is printed
+		plain,		// name
+		reg,		// name[value], full width
+		pseudoInput,	// name-input
+		pseudoOutput	// name-output
+	};
+
+	enum { none = ~0U };	// no source object
+
+	unsigned long value;
+	unsigned long value2;
+	unsigned int obj;	// serial numbers (CPUObject::serialNumber)
+	unsigned int src;
+	unsigned char kind;
+	unsigned char base;	// cout's number base and fill character
+	unsigned char fill;	// at the time
+	unsigned char op;
+	unsigned int aux;
+};
+
+class TraceSink {
+
+public:
+	virtual ~TraceSink();
+	virtual void define( unsigned int obj, int bits,
+			     const char *name ) = 0;
+		// called before obj first appears in a record
+	virtual void record( const TraceRecord &r ) = 0;
+};
+
+class TraceFormat {
+
+public:
+	static void tick( ostream &o, long time );
+	static void reg( ostream &o, const char *name, int bits, long value );
+	static void source( ostream &o, int style, const char *srcName,
+			    int bits, long value, const char *inName );
+	static void transfer( ostream &o, long value );
+	static void aluBegin( ostream &o, const char *name, int op );
+	static void aluComma( ostream &o );
+	static void aluEnd( ostream &o, long value );
+	static void flag( ostream &o, const char *name, int which, int value );
+	static void constant( ostream &o, const char *name, long value );
+	static void latch( ostream &o, const char *name );
+	static void count( ostream &o, const char *name, int how,
+			   unsigned long value, int oflow );
+	static void clearSet( ostream &o, const char *name, int set );
+	static void shift( ostream &o, const char *name, int how,
+			   long oldValue, long newValue );
+	static void memWrite( ostream &o, const char *name, long value,
+			      unsigned long addr );
+	static void memLoad( ostream &o, const char *name, long value );
+	static void memRead( ostream &o, const char *name,
+			     unsigned long addr, long value );
+};
+
+class Trace {
+
+public:
+	static void setSink( TraceSink *s );
+		// 0 means print to cout; a sink is deleted when replaced
+		// or at the end of the simulation
+	static TraceSink *getSink();
+
+	static void tick( long time );
+	static void source( const CPUObject &in, const StorageObject *src );
+	static void transfer( long value );
+	static void aluBegin( const CPUObject &alu, int op );
+	static void aluComma();
+	static void aluEnd( long value );
+	static void flag( const CPUObject &alu, int which, int value );
+	static void constant( const CPUObject &c, long value );
+	static void latch( const CPUObject &s );
+	static void count( const CPUObject &c, int how, unsigned long value,
+			   int oflow );
+	static void clearSet( const CPUObject &c, int set );
+	static void shift( const CPUObject &s, int how, long oldValue,
+			   long newValue );
+	static void memWrite( const CPUObject &m, long value,
+			      unsigned long addr );
+	static void memLoad( const CPUObject &m, long value );
+	static void memRead( const CPUObject &m, unsigned long addr,
+			     long value );
+
+private:
+	friend class Clock;
+	static void death( SimulationContext &c );
+		// flush and delete the context's sink
+
+	static unsigned int id( SimulationContext &c, const CPUObject *obj );
+	static void emit( SimulationContext &c, TraceRecord &r );
+};
+
+#endif
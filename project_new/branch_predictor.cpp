@@ -0,0 +1,268 @@
+/**
+ * Source file for "branch_predictor" module that predicts the outcomes of
+ * the z88's branches and jumps, so that the pipeline can fetch past one
+ * whose operands aren't ready yet instead of stalling it.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+//C++ includes
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+
+//local project includes
+#include "branch_predictor.h"
+#include "report.h"
+
+
+/***********************************
+ * Direction predictors            *
+ ***********************************/
+
+/**
+ * Predicts that no branch is taken, which is what fetching the next
+ * instruction in sequence amounts to.
+ */
+class not_taken_predictor : public direction_predictor {
+	public:
+		const char *name(void) const override {
+			return "not-taken";
+		}
+
+		bool predict(uint32_t) override {
+			return false;
+		}
+
+		void update(uint32_t, bool) override {}
+};
+
+/**
+ * Predicts each branch the way the 2-bit saturating counter it maps to
+ * leans: counters 0 and 1 predict not taken, 2 and 3 taken. The counter is
+ * chosen by 'index()', which subclasses can change.
+ */
+class bimodal_predictor : public direction_predictor {
+	public:
+		/**
+		 * Build a bimodal predictor.
+		 *
+		 * @param table_bits The log2 of the number of counters.
+		 */
+		bimodal_predictor(unsigned int table_bits) :
+			counters(1UL << table_bits, 1),
+			mask((1UL << table_bits) - 1)
+		{}
+
+		const char *name(void) const override {
+			return "bimodal";
+		}
+
+		bool predict(uint32_t pc) override {
+			return (counters[index(pc)] >= 2);
+		}
+
+		void update(uint32_t pc, bool taken) override {
+			uint8_t &counter = counters[index(pc)];
+
+			if(taken && (counter < 3)) {
+				counter++;
+			}
+			else if(!taken && (counter > 0)) {
+				counter--;
+			}
+		}
+
+	protected:
+		//the counters, all starting at weakly not taken
+		std::vector<uint8_t> counters;
+
+		//mask for an index into 'counters'
+		uint32_t mask;
+
+		/**
+		 * Choose the counter for a branch.
+		 *
+		 * @param pc The address of the branch.
+		 * @returns The index of its counter.
+		 */
+		virtual uint32_t index(uint32_t pc) const {
+			return (pc >> 2) & mask;
+		}
+};
+
+/**
+ * A bimodal predictor whose counters are chosen by the branch's address
+ * exclusive-ORed with the outcomes of the most recent branches, so that a
+ * branch can be predicted differently depending on how it was reached.
+ */
+class gshare_predictor : public bimodal_predictor {
+	public:
+		/**
+		 * Build a gshare predictor.
+		 *
+		 * @param table_bits The log2 of the number of counters, which
+		 *	is also the number of branch outcomes remembered.
+		 */
+		gshare_predictor(unsigned int table_bits) :
+			bimodal_predictor(table_bits),
+			history(0)
+		{}
+
+		const char *name(void) const override {
+			return "gshare";
+		}
+
+		void update(uint32_t pc, bool taken) override {
+			bimodal_predictor::update(pc, taken);
+			history = ((history << 1) | taken) & mask;
+		}
+
+	protected:
+		uint32_t index(uint32_t pc) const override {
+			return ((pc >> 2) ^ history) & mask;
+		}
+
+	private:
+		//the most recent outcomes, the newest in the low bit
+		uint32_t history;
+};
+
+std::unique_ptr<direction_predictor> make_direction_predictor(
+	const char *name, unsigned int table_bits) {
+	if(!strcmp(name, "not-taken")) {
+		return std::unique_ptr<direction_predictor>(
+			new not_taken_predictor());
+	}
+	if(!strcmp(name, "bimodal")) {
+		return std::unique_ptr<direction_predictor>(
+			new bimodal_predictor(table_bits));
+	}
+	if(!strcmp(name, "gshare")) {
+		return std::unique_ptr<direction_predictor>(
+			new gshare_predictor(table_bits));
+	}
+
+	return nullptr;
+}
+
+
+/***********************************
+ * Function implementations        *
+ ***********************************/
+
+branch_predictor::branch_predictor(
+	std::unique_ptr<direction_predictor> directions,
+	unsigned int btb_entries, unsigned int ras_entries) :
+	directions(std::move(directions)),
+	btb(btb_entries, btb_entry{false, 0, 0}),
+	ras(ras_entries, 0),
+	ras_next(0),
+	ras_count(0),
+	branches(0),
+	branches_correct(0),
+	jumps(0),
+	jumps_correct(0),
+	speculations(0),
+	mispredictions(0),
+	squashes(0)
+{}
+
+bool branch_predictor::predict_taken(uint32_t pc) {
+	return directions->predict(pc);
+}
+
+void branch_predictor::update_taken(uint32_t pc, bool predicted,
+	bool taken) {
+	branches++;
+	if(predicted == taken) {
+		branches_correct++;
+	}
+
+	directions->update(pc, taken);
+}
+
+bool branch_predictor::predict_target(uint32_t pc, bool is_return,
+	uint32_t &target) const {
+	if(is_return && ras_count) {
+		target = ras[(ras_next + ras.size() - 1) % ras.size()];
+		return true;
+	}
+
+	const btb_entry &entry = btb[(pc >> 2) % btb.size()];
+	if(entry.valid && (entry.pc == pc)) {
+		target = entry.target;
+		return true;
+	}
+
+	return false;
+}
+
+void branch_predictor::update_target(uint32_t pc, bool is_return,
+	bool predicted, uint32_t predicted_target, uint32_t target) {
+	jumps++;
+	if(predicted && (predicted_target == target)) {
+		jumps_correct++;
+	}
+
+	//returns are left to the RAS
+	if(!is_return) {
+		btb[(pc >> 2) % btb.size()] = btb_entry{true, pc, target};
+	}
+}
+
+void branch_predictor::push_return(uint32_t address) {
+	ras[ras_next] = address;
+	ras_next = (ras_next + 1) % ras.size();
+	if(ras_count < ras.size()) {
+		ras_count++;
+	}
+}
+
+void branch_predictor::pop_return(void) {
+	if(ras_count) {
+		ras_next = (ras_next + ras.size() - 1) % ras.size();
+		ras_count--;
+	}
+}
+
+void branch_predictor::count_speculation(bool mispredicted, bool squashed) {
+	speculations++;
+	if(mispredicted) {
+		mispredictions++;
+	}
+	if(squashed) {
+		squashes++;
+	}
+}
+
+void branch_predictor::print_report(std::ostream &out) const {
+	std::ios_base::fmtflags old = out.flags();
+	std::streamsize old_precision = out.precision();
+
+	out << std::dec << std::endl << "Branch predictor: " <<
+		directions->name() << ", " << btb.size() << "-entry BTB, " <<
+		ras.size() << "-entry RAS" << std::endl;
+
+	out << "Branches:          " << branches << ", predicted correctly ";
+	print_percentage(out, branches_correct, branches);
+	out << std::endl;
+
+	out << "Register jumps:    " << jumps << ", predicted correctly ";
+	print_percentage(out, jumps_correct, jumps);
+	out << std::endl;
+
+	/* each branch or jump speculated past would otherwise have stalled
+		for a cycle, and each squash costs one back */
+	out << "Speculated past:   " << speculations << ", mispredicted ";
+	print_percentage(out, mispredictions, speculations);
+	out << std::endl << "Cycles saved:      " <<
+		(long)(speculations - squashes) << " (" << speculations <<
+		" stalls avoided, " << squashes << " wrong-path fetches)" <<
+		std::endl;
+
+	(void)out.flags(old);
+	(void)out.precision(old_precision);
+}
@@ -0,0 +1,197 @@
+/**
+ * Header file for "branch_predictor" module that predicts the outcomes of
+ * the z88's branches and jumps, so that the pipeline can fetch past one
+ * whose operands aren't ready yet instead of stalling it.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+#ifndef _BRANCH_PREDICTOR_H_
+#define _BRANCH_PREDICTOR_H_
+
+//C++ includes
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+/**
+ * Predicts whether conditional branches are taken. Each kind of predictor
+ * is a subclass.
+ */
+class direction_predictor {
+	public:
+		virtual ~direction_predictor(void) {}
+
+		/**
+		 * Get the name of this kind of predictor.
+		 *
+		 * @returns The name, as given to make_direction_predictor().
+		 */
+		virtual const char *name(void) const = 0;
+
+		/**
+		 * Predict whether a branch will be taken.
+		 *
+		 * @param pc The address of the branch.
+		 * @returns True if the branch is predicted taken.
+		 */
+		virtual bool predict(uint32_t pc) = 0;
+
+		/**
+		 * Learn the outcome of a branch, once it is known.
+		 *
+		 * @param pc The address of the branch.
+		 * @param taken Whether it was taken.
+		 */
+		virtual void update(uint32_t pc, bool taken) = 0;
+};
+
+/**
+ * Make a direction predictor of the named kind: "not-taken" (always
+ * predicts not taken), "bimodal" (a table of 2-bit saturating counters
+ * indexed by branch address), or "gshare" (the same, indexed by branch
+ * address exclusive-ORed with the recent branch history).
+ *
+ * @param name The kind of predictor.
+ * @param table_bits The log2 of the number of counters (bimodal and
+ *	gshare) and the number of bits of history (gshare).
+ * @returns The predictor, or null if the kind is not known.
+ */
+std::unique_ptr<direction_predictor> make_direction_predictor(
+	const char *name, unsigned int table_bits = 10);
+
+/**
+ * A branch predictor: a direction predictor for conditional branches, a
+ * branch target buffer (BTB) for jumps through registers, and a return
+ * address stack (RAS) for returns from subroutines (JR r31). Also keeps the
+ * counts the pipeline reports at the end of a program.
+ */
+class branch_predictor {
+	public:
+		/**
+		 * Build a branch predictor.
+		 *
+		 * @param directions The direction predictor to use.
+		 * @param btb_entries The number of entries in the BTB.
+		 * @param ras_entries The depth of the RAS.
+		 */
+		branch_predictor(
+			std::unique_ptr<direction_predictor> directions,
+			unsigned int btb_entries = 64,
+			unsigned int ras_entries = 8);
+
+		/**
+		 * Predict whether a conditional branch will be taken.
+		 *
+		 * @param pc The address of the branch.
+		 * @returns True if it is predicted taken.
+		 */
+		bool predict_taken(uint32_t pc);
+
+		/**
+		 * Learn the outcome of a conditional branch.
+		 *
+		 * @param pc The address of the branch.
+		 * @param predicted What was predicted for it.
+		 * @param taken Whether it was taken.
+		 */
+		void update_taken(uint32_t pc, bool predicted, bool taken);
+
+		/**
+		 * Look up the target of a jump through a register, without
+		 * changing anything: the top of the RAS for a return, or the
+		 * BTB entry for any other jump (or for a return when the RAS
+		 * is empty).
+		 *
+		 * @param pc The address of the jump.
+		 * @param is_return Whether the jump is a return (JR r31).
+		 * @param target Set to the predicted target, if there is one.
+		 * @returns True if a target was predicted.
+		 */
+		bool predict_target(uint32_t pc, bool is_return,
+			uint32_t &target) const;
+
+		/**
+		 * Learn the target of a jump through a register.
+		 *
+		 * @param pc The address of the jump.
+		 * @param is_return Whether the jump is a return (JR r31).
+		 * @param predicted Whether a target was predicted for it.
+		 * @param predicted_target The target predicted, if one was.
+		 * @param target Where it jumped to.
+		 */
+		void update_target(uint32_t pc, bool is_return, bool predicted,
+			uint32_t predicted_target, uint32_t target);
+
+		/**
+		 * Push a return address onto the RAS, for a subroutine call
+		 * (JAL or JALR). The oldest address is lost if it is full.
+		 *
+		 * @param address The address the call returns to.
+		 */
+		void push_return(uint32_t address);
+
+		/**
+		 * Pop the top address off the RAS, for a return, if there is
+		 * one.
+		 */
+		void pop_return(void);
+
+		/**
+		 * Count a branch or jump that the pipeline fetched past on a
+		 * prediction instead of stalling for its operands.
+		 *
+		 * @param mispredicted Whether the prediction turned out
+		 *	wrong.
+		 * @param squashed Whether an instruction on the wrong path
+		 *	had to be thrown away (which costs the cycle the
+		 *	stall would have).
+		 */
+		void count_speculation(bool mispredicted, bool squashed);
+
+		/**
+		 * Print how accurate the predictions were and how many cycles
+		 * speculating saved.
+		 *
+		 * @param out Where to print the report.
+		 */
+		void print_report(std::ostream &out) const;
+
+	private:
+		//an entry of the BTB
+		struct btb_entry {
+			bool valid;
+			uint32_t pc;
+			uint32_t target;
+		};
+
+		//predicts the directions of conditional branches
+		std::unique_ptr<direction_predictor> directions;
+
+		//the BTB, indexed by jump address
+		std::vector<btb_entry> btb;
+
+		/* the RAS, as a circular buffer: the top is just before
+			'ras_next', and 'ras_count' addresses are on it */
+		std::vector<uint32_t> ras;
+		unsigned int ras_next;
+		unsigned int ras_count;
+
+		//conditional branches predicted, and how many correctly
+		unsigned long branches;
+		unsigned long branches_correct;
+
+		//jumps through registers predicted, and how many correctly
+		unsigned long jumps;
+		unsigned long jumps_correct;
+
+		/* branches and jumps speculated past, how many were
+			mispredicted, and how many wrong-path fetches that
+			cost */
+		unsigned long speculations;
+		unsigned long mispredictions;
+		unsigned long squashes;
+};
+
+#endif // _BRANCH_PREDICTOR_H_
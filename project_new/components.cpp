@@ -9,90 +9,6 @@
 //local project includes
 #include "components.h"
 
-//constant values
-const unsigned int WORD_WIDTH(32);
-const unsigned int NUM_GPRS(32);
-const unsigned int ADDR_WIDTH(32);
-const unsigned int UNIT_BITS(8);
-const unsigned int MAX_ADDR(0xFFFF);
-
-//the general purpose registers
-StorageObject r0("R0", WORD_WIDTH, 0);
-StorageObject r1("R1", WORD_WIDTH, 0);
-StorageObject r2("R2", WORD_WIDTH, 0);
-StorageObject r3("R3", WORD_WIDTH, 0);
-StorageObject r4("R4", WORD_WIDTH, 0);
-StorageObject r5("R5", WORD_WIDTH, 0);
-StorageObject r6("R6", WORD_WIDTH, 0);
-StorageObject r7("R7", WORD_WIDTH, 0);
-StorageObject r8("R8", WORD_WIDTH, 0);
-StorageObject r9("R9", WORD_WIDTH, 0);
-StorageObject r10("R10", WORD_WIDTH, 0);
-StorageObject r11("R11", WORD_WIDTH, 0);
-StorageObject r12("R12", WORD_WIDTH, 0);
-StorageObject r13("R13", WORD_WIDTH, 0);
-StorageObject r14("R14", WORD_WIDTH, 0);
-StorageObject r15("R15", WORD_WIDTH, 0);
-StorageObject r16("R16", WORD_WIDTH, 0);
-StorageObject r17("R17", WORD_WIDTH, 0);
-StorageObject r18("R18", WORD_WIDTH, 0);
-StorageObject r19("R19", WORD_WIDTH, 0);
-StorageObject r20("R20", WORD_WIDTH, 0);
-StorageObject r21("R21", WORD_WIDTH, 0);
-StorageObject r22("R22", WORD_WIDTH, 0);
-StorageObject r23("R23", WORD_WIDTH, 0);
-StorageObject r24("R24", WORD_WIDTH, 0);
-StorageObject r25("R25", WORD_WIDTH, 0);
-StorageObject r26("R26", WORD_WIDTH, 0);
-StorageObject r27("R27", WORD_WIDTH, 0);
-StorageObject r28("R28", WORD_WIDTH, 0);
-StorageObject r29("R29", WORD_WIDTH, 0);
-StorageObject r30("R30", WORD_WIDTH, 0);
-StorageObject r31("R31", WORD_WIDTH, 0);
-
-//array of pointers to GPRs
-StorageObject *gprs[NUM_GPRS] = {
-	&r0,
-	&r1,
-	&r2,
-	&r3,
-	&r4,
-	&r5,
-	&r6,
-	&r7,
-	&r8,
-	&r9,
-	&r10,
-	&r11,
-	&r12,
-	&r13,
-	&r14,
-	&r15,
-	&r16,
-	&r17,
-	&r18,
-	&r19,
-	&r20,
-	&r21,
-	&r22,
-	&r23,
-	&r24,
-	&r25,
-	&r26,
-	&r27,
-	&r28,
-	&r29,
-	&r30,
-	&r31
-};
-
-//instruction memory
-Memory instruction_mem("IMemory", ADDR_WIDTH, UNIT_BITS, MAX_ADDR,
-	ADDR_WIDTH / UNIT_BITS);
-//data memory
-Memory data_mem("DMemory", ADDR_WIDTH, UNIT_BITS, MAX_ADDR,
-	ADDR_WIDTH / UNIT_BITS);
-
 //constructor for pre-IF pipeline register
 if_reg::if_reg(void) :
 	pc("PC", ADDR_WIDTH, 0)
@@ -103,7 +19,8 @@ ifid_reg::ifid_reg(void) :
 	valid("valid", 1, 0),
 	pc("PC", ADDR_WIDTH, 0),
 	new_pc("new PC", ADDR_WIDTH, 0),
-	ir("IR", WORD_WIDTH, 0)
+	ir("IR", WORD_WIDTH, 0),
+	uop()
 {}
 
 //constructor for ID/EX pipeline register
@@ -111,6 +28,7 @@ idex_reg::idex_reg(void) :
 	valid("valid", 1, 0),
 	pc("PC", ADDR_WIDTH, 0),
 	ir("IR", WORD_WIDTH, 0),
+	uop(),
 	a("A", WORD_WIDTH, 0),
 	b("B", WORD_WIDTH, 0),
 	imm("IMM", WORD_WIDTH, 0),
@@ -122,6 +40,7 @@ exmem_reg::exmem_reg(void) :
 	valid("valid", 1, 0),
 	pc("PC", ADDR_WIDTH, 0),
 	ir("IR", WORD_WIDTH, 0),
+	uop(),
 	b("B", WORD_WIDTH, 0),
 	c("C", WORD_WIDTH, 0)
 {}
@@ -131,6 +50,7 @@ memwb_reg::memwb_reg(void) :
 	valid("valid", 1, 0),
 	pc("PC", ADDR_WIDTH, 0),
 	ir("IR", WORD_WIDTH, 0),
+	uop(),
 	c("C", WORD_WIDTH, 0)
 {}
 
@@ -138,72 +58,197 @@ memwb_reg::memwb_reg(void) :
 post_wb_reg::post_wb_reg(void) :
 	valid("valid", 1, 0),
 	ir("IR", WORD_WIDTH, 0),
+	uop(),
 	pc("PC", ADDR_WIDTH, 0)
 {}
 
 
-//instances of pipeline registers
-if_reg if_r{};
-ifid_reg ifid_r{};
-idex_reg idex_r{};
-exmem_reg exmem_r{};
-memwb_reg memwb_r{};
-post_wb_reg post_wb_r{};
-
-//fetch stage busses, ALUs, temporary registers, and constants
-Bus if_instruction_mem_addr_bus("if_instruction_mem_addr_bus", ADDR_WIDTH);
-Bus if_pc_forward("if_pc_forward", WORD_WIDTH);
-Bus if_branch_bus("if_branch_bus", ADDR_WIDTH);
-
-//decode stage busses, ALUs, temporary registers, and constants
-Bus id_valid_forward("id_valid_forward", 1);
-Bus id_pc_forward("if_pc_forward", WORD_WIDTH);
-Bus id_ir_forward("id_ir_forward", WORD_WIDTH);
-Bus id_a_load_bus("id_a_load_bus", WORD_WIDTH);
-Bus id_b_load_bus("id_b_load_bus", WORD_WIDTH);
-BusALU id_imm_alu("id_imm_alu", WORD_WIDTH);
-StorageObject id_imm_sign_extend_mask(
-	"id_imm_sign_extend_mask", WORD_WIDTH, 0x00008000);
-StorageObject id_imm_zero_extend_mask(
-	"id_imm_zero_extend_mask", WORD_WIDTH, 0x0000FFFF);
-StorageObject id_sh_field_shift_amount(
-	"id_sh_field_shift_amount", WORD_WIDTH, 0x00000006);
-StorageObject id_temp_reg("id_temp_reg", WORD_WIDTH, 0);
-Bus id_temp_reg_load_bus("id_temp_reg_load_bus", WORD_WIDTH);
-StorageObject id_shift_field_mask(
-	"id_shift_field_mask", WORD_WIDTH, 0x0000001F);
-StorageObject id_jump_target_mask(
-	"id_jump_target_mask", WORD_WIDTH, 0x03FFFFFF);
-
-//execute stage busses, ALUs, temporary registers, and constants
-Bus ex_valid_forward("ex_valid_forward", 1);
-Bus ex_pc_forward("ex_pc_forward", WORD_WIDTH);
-Bus ex_ir_forward("ex_ir_forward", WORD_WIDTH);
-Bus ex_b_forward("ex_b_forward", WORD_WIDTH);
-BusALU ex_alu("ex_alu", WORD_WIDTH);
-StorageObject ex_lui_shift_amount(
-	"ex_lui_shift_amount", WORD_WIDTH, 0x00000010);
-StorageObject ex_jump_link_return_offset(
-	"ex_jump_link_return_offset", WORD_WIDTH, 0x00000008);
-
-//memory stage busses, ALUs, temporary registers, and constants
-Bus mem_valid_forward("mem_valid_forward", 1);
-Bus mem_pc_forward("mem_pc_forward", WORD_WIDTH);
-Bus mem_ir_forward("mem_ir_forward", WORD_WIDTH);
-Bus mem_c_forward("mem_c_forward", WORD_WIDTH);
-Bus mem_data_mem_addr_bus("mem_data_mem_addr_bus", ADDR_WIDTH);
-
-//writeback stage busses, ALUs, temporary registers, and constants
-Bus wb_register_write_bus("wb_register_write_bus", WORD_WIDTH);
-Bus wb_pc_forward("wb_pc_forward", ADDR_WIDTH);
-Bus wb_ir_forward("wb_ir_forward", WORD_WIDTH);
-Bus wb_valid_forward("wb_valid_forward", 1);
-
-//forwarding busses
-Bus idex_a_fill("idex_a_fill", WORD_WIDTH);
-Bus idex_b_fill("idex_b_fill", WORD_WIDTH);
-
-//stalling busses and constants
-Bus idex_nop_insert_bus("idex_nop_insert_bus", WORD_WIDTH);
-StorageObject stalling_nop_constant(
-	"stalling_nop_constant", WORD_WIDTH, 0x04000000);
+//constructor for all of the components of one z88
+z88_components::z88_components(std::ostream &out) :
+	context(out),
+	//the general purpose registers
+	r0("R0", WORD_WIDTH, 0),
+	r1("R1", WORD_WIDTH, 0),
+	r2("R2", WORD_WIDTH, 0),
+	r3("R3", WORD_WIDTH, 0),
+	r4("R4", WORD_WIDTH, 0),
+	r5("R5", WORD_WIDTH, 0),
+	r6("R6", WORD_WIDTH, 0),
+	r7("R7", WORD_WIDTH, 0),
+	r8("R8", WORD_WIDTH, 0),
+	r9("R9", WORD_WIDTH, 0),
+	r10("R10", WORD_WIDTH, 0),
+	r11("R11", WORD_WIDTH, 0),
+	r12("R12", WORD_WIDTH, 0),
+	r13("R13", WORD_WIDTH, 0),
+	r14("R14", WORD_WIDTH, 0),
+	r15("R15", WORD_WIDTH, 0),
+	r16("R16", WORD_WIDTH, 0),
+	r17("R17", WORD_WIDTH, 0),
+	r18("R18", WORD_WIDTH, 0),
+	r19("R19", WORD_WIDTH, 0),
+	r20("R20", WORD_WIDTH, 0),
+	r21("R21", WORD_WIDTH, 0),
+	r22("R22", WORD_WIDTH, 0),
+	r23("R23", WORD_WIDTH, 0),
+	r24("R24", WORD_WIDTH, 0),
+	r25("R25", WORD_WIDTH, 0),
+	r26("R26", WORD_WIDTH, 0),
+	r27("R27", WORD_WIDTH, 0),
+	r28("R28", WORD_WIDTH, 0),
+	r29("R29", WORD_WIDTH, 0),
+	r30("R30", WORD_WIDTH, 0),
+	r31("R31", WORD_WIDTH, 0),
+
+	//array of pointers to GPRs
+	gprs{
+		&r0,
+		&r1,
+		&r2,
+		&r3,
+		&r4,
+		&r5,
+		&r6,
+		&r7,
+		&r8,
+		&r9,
+		&r10,
+		&r11,
+		&r12,
+		&r13,
+		&r14,
+		&r15,
+		&r16,
+		&r17,
+		&r18,
+		&r19,
+		&r20,
+		&r21,
+		&r22,
+		&r23,
+		&r24,
+		&r25,
+		&r26,
+		&r27,
+		&r28,
+		&r29,
+		&r30,
+		&r31
+	},
+
+	//instruction memory
+	instruction_mem("IMemory", ADDR_WIDTH, UNIT_BITS, MAX_ADDR,
+		ADDR_WIDTH / UNIT_BITS),
+
+	//data memory
+	data_mem("DMemory", ADDR_WIDTH, UNIT_BITS, MAX_ADDR,
+		ADDR_WIDTH / UNIT_BITS),
+
+	//instances of pipeline registers
+	if_r(),
+	ifid_r(),
+	idex_r(),
+	exmem_r(),
+	memwb_r(),
+	post_wb_r(),
+
+	//fetch stage busses, ALUs, temporary registers, and constants
+	if_instruction_mem_addr_bus("if_instruction_mem_addr_bus", ADDR_WIDTH),
+	if_pc_forward("if_pc_forward", WORD_WIDTH),
+	if_branch_bus("if_branch_bus", ADDR_WIDTH),
+
+	//decode stage busses, ALUs, temporary registers, and constants
+	id_valid_forward("id_valid_forward", 1),
+	id_pc_forward("if_pc_forward", WORD_WIDTH),
+	id_ir_forward("id_ir_forward", WORD_WIDTH),
+	id_a_load_bus("id_a_load_bus", WORD_WIDTH),
+	id_b_load_bus("id_b_load_bus", WORD_WIDTH),
+	id_imm_alu("id_imm_alu", WORD_WIDTH),
+	id_imm_sign_extend_mask(
+		"id_imm_sign_extend_mask", WORD_WIDTH, 0x00008000),
+	id_imm_zero_extend_mask(
+		"id_imm_zero_extend_mask", WORD_WIDTH, 0x0000FFFF),
+	id_sh_field_shift_amount(
+		"id_sh_field_shift_amount", WORD_WIDTH, 0x00000006),
+	id_temp_reg("id_temp_reg", WORD_WIDTH, 0),
+	id_temp_reg_load_bus("id_temp_reg_load_bus", WORD_WIDTH),
+	id_shift_field_mask("id_shift_field_mask", WORD_WIDTH, 0x0000001F),
+	id_jump_target_mask("id_jump_target_mask", WORD_WIDTH, 0x03FFFFFF),
+
+	//execute stage busses, ALUs, temporary registers, and constants
+	ex_valid_forward("ex_valid_forward", 1),
+	ex_pc_forward("ex_pc_forward", WORD_WIDTH),
+	ex_ir_forward("ex_ir_forward", WORD_WIDTH),
+	ex_b_forward("ex_b_forward", WORD_WIDTH),
+	ex_alu("ex_alu", WORD_WIDTH),
+	ex_lui_shift_amount("ex_lui_shift_amount", WORD_WIDTH, 0x00000010),
+	ex_jump_link_return_offset(
+		"ex_jump_link_return_offset", WORD_WIDTH, 0x00000008),
+
+	//memory stage busses, ALUs, temporary registers, and constants
+	mem_valid_forward("mem_valid_forward", 1),
+	mem_pc_forward("mem_pc_forward", WORD_WIDTH),
+	mem_ir_forward("mem_ir_forward", WORD_WIDTH),
+	mem_c_forward("mem_c_forward", WORD_WIDTH),
+	mem_data_mem_addr_bus("mem_data_mem_addr_bus", ADDR_WIDTH),
+
+	//writeback stage busses, ALUs, temporary registers, and constants
+	wb_register_write_bus("wb_register_write_bus", WORD_WIDTH),
+	wb_pc_forward("wb_pc_forward", ADDR_WIDTH),
+	wb_ir_forward("wb_ir_forward", WORD_WIDTH),
+	wb_valid_forward("wb_valid_forward", 1),
+
+	//forwarding busses
+	idex_a_fill("idex_a_fill", WORD_WIDTH),
+	idex_b_fill("idex_b_fill", WORD_WIDTH),
+
+	//stalling busses and constants
+	idex_nop_insert_bus("idex_nop_insert_bus", WORD_WIDTH),
+	stalling_nop_constant("stalling_nop_constant", WORD_WIDTH, 0x04000000),
+
+	//branch prediction registers and busses
+	id_predicted_target("id_predicted_target", ADDR_WIDTH, 0),
+	ex_redirect_bus("ex_redirect_bus", ADDR_WIDTH),
+
+	//caches, if any, are added later
+	instruction_cache(),
+	data_cache()
+{}
+
+void z88_components::add_instruction_cache(const cache_config &config) {
+	//the cache belongs to this z88's context, like everything else
+	context.makeCurrent();
+
+	instruction_cache.reset(new Cache("ICache", instruction_mem,
+		config.size, config.line_size, config.ways,
+		config.replacement, config.write_policy,
+		2 * config.miss_penalty));
+	make_instruction_cache_connections();
+}
+
+void z88_components::add_data_cache(const cache_config &config) {
+	//the cache belongs to this z88's context, like everything else
+	context.makeCurrent();
+
+	data_cache.reset(new Cache("DCache", data_mem, config.size,
+		config.line_size, config.ways, config.replacement,
+		config.write_policy, 2 * config.miss_penalty));
+	make_data_cache_connections();
+}
+
+void z88_components::add_memory_latency(const memory_latency &latency) {
+	//a cycle is two ticks of the clock
+	instruction_mem.setLatency(latency.first, latency.last,
+		2 * latency.cycles);
+	data_mem.setLatency(latency.first, latency.last, 2 * latency.cycles);
+}
+
+void z88_components::add_dram(const dram_config &config) {
+	//a cycle is two ticks of the clock
+	DramTiming timing(config.banks, config.row_size, 2 * config.t_rcd,
+		2 * config.t_cas, 2 * config.t_rp, config.page_policy);
+
+	//the memories are separate, so each has banks of its own
+	instruction_mem.setDram(timing);
+	data_mem.setDram(timing);
+}
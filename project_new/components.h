@@ -8,13 +8,22 @@
 #ifndef _COMPONENTS_H_
 #define _COMPONENTS_H_
 
+//C++ includes
+#include <iostream>
+#include <memory>
+
 //arch library includes
 #include <StorageObject.h>
 #include <Clearable.h>
 #include <Memory.h>
+#include <Cache.h>
 #include <Bus.h>
 #include <BusALU.h>
 #include <Counter.h>
+#include <SimulationContext.h>
+
+//local project includes
+#include "instruction_decode.h"
 
 /**
  * A pipeline register that is "positioned" before the instruction fetch
@@ -49,6 +58,8 @@ class ifid_reg {
 		Counter new_pc;
 		//storage for the instruction itself
 		StorageObject ir;
+		//the instruction, decoded
+		micro_op uop;
 };
 
 /**
@@ -69,6 +80,8 @@ class idex_reg {
 		Counter pc;
 		//storage for the instruction itself
 		StorageObject ir;
+		//the instruction, decoded
+		micro_op uop;
 		/* storage for the contents of the 'rs' register specified
 			by a decoded instruction */
 		StorageObject a;
@@ -99,6 +112,8 @@ class exmem_reg {
 		StorageObject pc;
 		//storage for the instruction itself
 		StorageObject ir;
+		//the instruction, decoded
+		micro_op uop;
 		/* storage for the contents of the 'rt' register specified
 			by a decoded instruction, if it needs to be passed
 			through the execute phase */
@@ -124,6 +139,8 @@ class memwb_reg {
 		StorageObject pc;
 		//storage for the instruction itself
 		StorageObject ir;
+		//the instruction, decoded
+		micro_op uop;
 		/* storage for the results of calculations done during the
 			execute phase, if they need to be passed through the
 			memory phase, or for data read in from data memory. */
@@ -153,6 +170,8 @@ class post_wb_reg {
 		Clearable valid;
 		//storage for the instruction itself
 		StorageObject ir;
+		//the instruction, decoded
+		micro_op uop;
 		/* storage for memory address the instruction in the MEM/WB
 			register was pulled from. */
 		StorageObject pc;
@@ -160,150 +179,372 @@ class post_wb_reg {
 
 
 //size of a register/standard memory unit (in bits)
-extern const unsigned int WORD_WIDTH;
+const unsigned int WORD_WIDTH = 32;
 //number of general purpose registers available
-extern const unsigned int NUM_GPRS;
+const unsigned int NUM_GPRS = 32;
 //the size of an address (in bits)
-extern const unsigned int ADDR_WIDTH;
+const unsigned int ADDR_WIDTH = 32;
 //the size of the smallest addressable unit of memory (int bits)
-extern const unsigned int UNIT_BITS;
+const unsigned int UNIT_BITS = 8;
 //the highest allowed address in memory
-extern const unsigned int MAX_ADDR;
-
-//pipeline register for fetch stage
-extern if_reg if_r;
-//IF/ID pipeline register
-extern ifid_reg ifid_r;
-//ID/EX pipeline register
-extern idex_reg idex_r;
-//EX/MEM pipeline register
-extern exmem_reg exmem_r;
-//MEM/WB pipeline register
-extern memwb_reg memwb_r;
-//special post-WB pipeline register for instruction trace printouts
-extern post_wb_reg post_wb_r;
-
-//the general puspose registers and a macro to access them more easily
-extern StorageObject *gprs[];
+const unsigned int MAX_ADDR = 0xFFFFFFFF;
+
+//macro to access the general purpose registers more easily
 #define GPR(x) (*(gprs[x]))
 
-//instruction memory
-extern Memory instruction_mem;
-//data memory
-extern Memory data_mem;
-
-
-//fetch stage busses, ALUs, temporary registers, and constants
-
-	//bus for loading PC contents into instruction memory MAR
-	extern Bus if_instruction_mem_addr_bus;
-	//bus for forwarding PC contents into IF/ID register
-	extern Bus if_pc_forward;
-	//bus for loading destainations of branch instructions into PC
-	extern Bus if_branch_bus;
-
-
-//decode stage busses, ALUs, temporary registers, and constants
-
-	//bus for forwarding valid bit through ID stage
-	extern Bus id_valid_forward;
-	//bus for forwarding PC through ID stage
-	extern Bus id_pc_forward;
-	//bus for forwarding IR through ID stage
-	extern Bus id_ir_forward;
-	//bus for loading A register with contents of GPR specified in 'rs'
-	extern Bus id_a_load_bus;
-	//bus for loading B register with contents of GPR specified in 'rt'
-	extern Bus id_b_load_bus;
-	//ALU for decode stage, performs a wide variety of operations
-	extern BusALU id_imm_alu;
-	//constant used for sign extending immediate value from instruction
-	extern StorageObject id_imm_sign_extend_mask;
-	//constant used for zero extending immediate value from instruction
-	extern StorageObject id_imm_zero_extend_mask;
-	/* constant used for shifting when extracting the 'sh' field from a
-		shift instruction */
-	extern StorageObject id_sh_field_shift_amount;
-	/* temporary register for use in decode stage. holds intermediate
-		results between the first and second clock ticks of the
-		decode stage for certain instructions. In particular, shift
-		instructions require a temporary value while extracting the
-		'sh' field from their instruction, and jump and branch
-		instructions require intermediate values when computing
-		destination addresses */
-	extern StorageObject id_temp_reg;
-	//bus for loading values into aforementioned temporary register
-	extern Bus id_temp_reg_load_bus;
-	/* constant mask for extracting the contents of the 'sh' field for
-		shift instructions */
-	extern StorageObject id_shift_field_mask;
-	/* constant mask for extracting the target address from jump
-		instructions */
-	extern StorageObject id_jump_target_mask;
-
-
-//execute stage busses, ALUs, temporary registers, and constants
-
-	//bus for forwarding valid bit through ID stage
-	extern Bus ex_valid_forward;
-	//bus for forwarding PC through ID stage
-	extern Bus ex_pc_forward;
-	//bus for forwarding IR through ID stage
-	extern Bus ex_ir_forward;
-	/* bus for forwarding contents of GPR specified in 'rt' through the
-		EX stage */
-	extern Bus ex_b_forward;
-	//primary ALU for executing instructions
-	extern BusALU ex_alu;
-	/* constant amount to shift immediate values by when executing LUI
-		instructions */
-	extern StorageObject ex_lui_shift_amount;
-	/* constant offset to add to PC when saving the return address for JAL
-		and JALR instructions */
-	extern StorageObject ex_jump_link_return_offset;
-
-
-//memory stage busses, ALUs, temporary registers, and constants
-
-	//bus for forwarding valid bit through MEM stage
-	extern Bus mem_valid_forward;
-	//bus for forwarding PC through MEM stage
-	extern Bus mem_pc_forward;
-	//bus for forwarding IR through MEM stage
-	extern Bus mem_ir_forward;
-	/* bus for forwarding the results of ALU computations through MEM
-		stage */
-	extern Bus mem_c_forward;
-	//bus for loading addresses into the data memory's MAR
-	extern Bus mem_data_mem_addr_bus;
-
-
-//writeback stage busses, ALUs, temporary registers, and constants
-
-	//bus used for writing results into general purpose registers
-	extern Bus wb_register_write_bus;
-	//bus for forwarding PC through WB stage
-	extern Bus wb_pc_forward;
-	//bus for forwarding IR through WB stage
-	extern Bus wb_ir_forward;
-	//bus for forwarding valid bit through WB stage
-	extern Bus wb_valid_forward;
-
-
-//busses used to implement forwarding
-
-	//bus for forwarding data that will be written to 'rs' register
-	extern Bus idex_a_fill;
-	//bus for forwarding data that will be writtent to 'rt' register
-	extern Bus idex_b_fill;
-
-
-//busses and constants used to implement stalling
-
-	/* bus used to fill in the ID/EX pipeline registers IR field with a
-		NOP instruction */
-	extern Bus idex_nop_insert_bus;
-	//constant holding the opcode for a NOP instruction
-	extern StorageObject stalling_nop_constant;
+/**
+ * The makeup of a cache to put in front of one of the z88's memories (see
+ * the arch library's Cache).
+ */
+struct cache_config {
+	//capacity and line size, in bytes
+	unsigned long size;
+	int line_size;
+	//associativity (1 for direct-mapped)
+	int ways;
+	//which line a miss replaces
+	Cache::Replacement replacement;
+	//whether stores are written back or written through
+	Cache::WritePolicy write_policy;
+	/* cycles the pipeline waits for a line to be loaded, on top of the
+		memory's latency */
+	int miss_penalty;
+};
+
+/**
+ * A latency for the z88's memories: the cycles an access to a range of
+ * addresses takes beyond the one the pipeline gives it.
+ */
+struct memory_latency {
+	//the addresses it applies to
+	unsigned long first;
+	unsigned long last;
+	//the extra cycles an access takes
+	int cycles;
+};
+
+/**
+ * The makeup of the banked DRAM behind the z88's memories (see the arch
+ * library's DramTiming).
+ */
+struct dram_config {
+	//banks, and the bytes in each row
+	int banks;
+	unsigned long row_size;
+	//cycles to open a row, access an open one, and close one
+	int t_rcd;
+	int t_cas;
+	int t_rp;
+	//whether a row is left open after an access
+	DramTiming::PagePolicy page_policy;
+};
+
+/**
+ * All of the hardware components of one z88 CPU, and the simulation context
+ * they belong to. Any number of z88s can be built, each with its own clock
+ * and its own copy of every component. The components are created in the
+ * order they are declared here, which is also the order the arch library
+ * numbers (and traces) them in.
+ */
+class z88_components {
+	public:
+		/**
+		 * Build a z88's components in a new simulation context of
+		 * their own.
+		 *
+		 * @param out Where the context's messages (and trace) go.
+		 */
+		z88_components(std::ostream &out = std::cout);
+
+		/**
+		 * Set up all of the connections between the components.
+		 */
+		void connect_components(void);
+
+		/**
+		 * Put a cache in front of the instruction memory, for the
+		 * fetch stage to read instructions through. Must be done
+		 * before a checkpoint is saved or restored, as the cache is
+		 * part of what one holds.
+		 *
+		 * @param config The makeup of the cache.
+		 */
+		void add_instruction_cache(const cache_config &config);
+
+		/**
+		 * Put a cache in front of the data memory, for the memory
+		 * stage's loads and stores to go through. Must be done before
+		 * a checkpoint is saved or restored, as the cache is part of
+		 * what one holds.
+		 *
+		 * @param config The makeup of the cache.
+		 */
+		void add_data_cache(const cache_config &config);
+
+		/**
+		 * Make accesses to a range of addresses in both memories
+		 * take longer. A range given later takes precedence over
+		 * those given before where they overlap.
+		 *
+		 * @param latency The range and its latency.
+		 */
+		void add_memory_latency(const memory_latency &latency);
+
+		/**
+		 * Give both memories the timing of a banked DRAM, on top of
+		 * any other latency, so that accesses take longer or shorter
+		 * by which rows they find open.
+		 *
+		 * @param config The makeup of the DRAM.
+		 */
+		void add_dram(const dram_config &config);
+
+		/* the context the components belong to. Declared first so
+			that it is created before (and destroyed after) all of
+			them */
+		SimulationContext context;
+
+		//the general purpose registers
+		StorageObject r0, r1, r2, r3, r4, r5, r6, r7,
+			r8, r9, r10, r11, r12, r13, r14, r15,
+			r16, r17, r18, r19, r20, r21, r22, r23,
+			r24, r25, r26, r27, r28, r29, r30, r31;
+		//array of pointers to GPRs, for the GPR macro
+		StorageObject *gprs[NUM_GPRS];
+
+		//instruction memory
+		Memory instruction_mem;
+		//data memory
+		Memory data_mem;
+
+		//pipeline register for fetch stage
+		if_reg if_r;
+		//IF/ID pipeline register
+		ifid_reg ifid_r;
+		//ID/EX pipeline register
+		idex_reg idex_r;
+		//EX/MEM pipeline register
+		exmem_reg exmem_r;
+		//MEM/WB pipeline register
+		memwb_reg memwb_r;
+		/* special post-WB pipeline register for instruction trace
+			printouts */
+		post_wb_reg post_wb_r;
+
+	//fetch stage busses, ALUs, temporary registers, and constants
+
+		//bus for loading PC contents into instruction memory MAR
+		Bus if_instruction_mem_addr_bus;
+		//bus for forwarding PC contents into IF/ID register
+		Bus if_pc_forward;
+		//bus for loading destainations of branch instructions into PC
+		Bus if_branch_bus;
+
+
+	//decode stage busses, ALUs, temporary registers, and constants
+
+		//bus for forwarding valid bit through ID stage
+		Bus id_valid_forward;
+		//bus for forwarding PC through ID stage
+		Bus id_pc_forward;
+		//bus for forwarding IR through ID stage
+		Bus id_ir_forward;
+		/* bus for loading A register with contents of GPR specified
+			in 'rs' */
+		Bus id_a_load_bus;
+		/* bus for loading B register with contents of GPR specified
+			in 'rt' */
+		Bus id_b_load_bus;
+		//ALU for decode stage, performs a wide variety of operations
+		BusALU id_imm_alu;
+		/* constant used for sign extending immediate value from
+			instruction */
+		StorageObject id_imm_sign_extend_mask;
+		/* constant used for zero extending immediate value from
+			instruction */
+		StorageObject id_imm_zero_extend_mask;
+		/* constant used for shifting when extracting the 'sh' field
+			from a shift instruction */
+		StorageObject id_sh_field_shift_amount;
+		/* temporary register for use in decode stage. holds
+			intermediate results between the first and second
+			clock ticks of the decode stage for certain
+			instructions. In particular, shift instructions
+			require a temporary value while extracting the 'sh'
+			field from their instruction, and jump and branch
+			instructions require intermediate values when
+			computing destination addresses */
+		StorageObject id_temp_reg;
+		//bus for loading values into aforementioned temporary register
+		Bus id_temp_reg_load_bus;
+		/* constant mask for extracting the contents of the 'sh'
+			field for shift instructions */
+		StorageObject id_shift_field_mask;
+		/* constant mask for extracting the target address from jump
+			instructions */
+		StorageObject id_jump_target_mask;
+
+
+	//execute stage busses, ALUs, temporary registers, and constants
+
+		//bus for forwarding valid bit through ID stage
+		Bus ex_valid_forward;
+		//bus for forwarding PC through ID stage
+		Bus ex_pc_forward;
+		//bus for forwarding IR through ID stage
+		Bus ex_ir_forward;
+		/* bus for forwarding contents of GPR specified in 'rt'
+			through the EX stage */
+		Bus ex_b_forward;
+		//primary ALU for executing instructions
+		BusALU ex_alu;
+		/* constant amount to shift immediate values by when
+			executing LUI instructions */
+		StorageObject ex_lui_shift_amount;
+		/* constant offset to add to PC when saving the return
+			address for JAL and JALR instructions */
+		StorageObject ex_jump_link_return_offset;
+
+
+	//memory stage busses, ALUs, temporary registers, and constants
+
+		//bus for forwarding valid bit through MEM stage
+		Bus mem_valid_forward;
+		//bus for forwarding PC through MEM stage
+		Bus mem_pc_forward;
+		//bus for forwarding IR through MEM stage
+		Bus mem_ir_forward;
+		/* bus for forwarding the results of ALU computations through
+			MEM stage */
+		Bus mem_c_forward;
+		//bus for loading addresses into the data memory's MAR
+		Bus mem_data_mem_addr_bus;
+
+
+	//writeback stage busses, ALUs, temporary registers, and constants
+
+		//bus used for writing results into general purpose registers
+		Bus wb_register_write_bus;
+		//bus for forwarding PC through WB stage
+		Bus wb_pc_forward;
+		//bus for forwarding IR through WB stage
+		Bus wb_ir_forward;
+		//bus for forwarding valid bit through WB stage
+		Bus wb_valid_forward;
+
+
+	//busses used to implement forwarding
+
+		//bus for forwarding data that will be written to 'rs' register
+		Bus idex_a_fill;
+		//bus for forwarding data that will be writtent to 'rt' register
+		Bus idex_b_fill;
+
+
+	//busses and constants used to implement stalling
+
+		/* bus used to fill in the ID/EX pipeline registers IR field
+			with a NOP instruction */
+		Bus idex_nop_insert_bus;
+		//constant holding the opcode for a NOP instruction
+		StorageObject stalling_nop_constant;
+
+
+	//registers and busses used to implement branch prediction
+
+		/* register holding the target the branch predictor gives for
+			a jump through a register being decoded */
+		StorageObject id_predicted_target;
+		/* bus for restarting the fetch stage on the right path when a
+			branch or jump in the execute stage was mispredicted */
+		Bus ex_redirect_bus;
+
+
+	//caches
+
+		/* caches in front of the instruction and data memories, if
+			the z88 has them (they are built after everything else,
+			by 'add_instruction_cache' and 'add_data_cache') */
+		std::unique_ptr<Cache> instruction_cache;
+		std::unique_ptr<Cache> data_cache;
+
+	private:
+		/**
+		 * Connect all of the registers in the register file to the
+		 * input of the specifed bus. Utility function.
+		 *
+		 * @param b The bus to connect the register file to.
+		 */
+		void connect_reg_file_to_bus_input(Bus &b);
+
+		/**
+		 * Connect all of the registers in the register file to the
+		 * output of the specified bus. Utility function.
+		 *
+		 * @param b The bus to connect the register file to.
+		 */
+		void connect_reg_file_to_bus_output(Bus &b);
+
+		/**
+		 * Make the connections that will be used in the fetch stage
+		 * of the pipeline.
+		 */
+		void make_fetch_stage_connections(void);
+
+		/**
+		 * Make the connections that will be used in the decode stage
+		 * of the pipeline.
+		 */
+		void make_decode_stage_connections(void);
+
+		/**
+		 * Make the connections that will be used in the execute stage
+		 * of the pipeline.
+		 */
+		void make_execute_stage_connections(void);
+
+		/**
+		 * Make the connections that will be used in the memory stage
+		 * of the pipeline.
+		 */
+		void make_memory_stage_connections(void);
+
+		/**
+		 * Make the connections that will be used in the writeback
+		 * stage of the pipeline.
+		 */
+		void make_writeback_stage_connections(void);
+
+		/**
+		 * Make the connections that will be used for forwarding
+		 * results from leter instructions back to the execute stage.
+		 */
+		void make_connections_for_forwarding(void);
+
+		/**
+		 * Make the connections that will be used for inserting NOPs
+		 * in order to do stalling after load instructions.
+		 */
+		void make_connections_for_stalling(void);
+
+		/**
+		 * Make the connections that will be used for fetching past
+		 * predicted branches and jumps, and for recovering when a
+		 * prediction was wrong.
+		 */
+		void make_connections_for_branch_prediction(void);
+
+		/**
+		 * Make the connections that will be used for the fetch stage
+		 * to read instructions through the instruction cache.
+		 */
+		void make_instruction_cache_connections(void);
+
+		/**
+		 * Make the connections that will be used for the memory stage
+		 * to load and store through the data cache.
+		 */
+		void make_data_cache_connections(void);
+};
 
 #endif // _COMPONENTS_H_
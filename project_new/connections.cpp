@@ -6,65 +6,9 @@
  */
 
 //local project includes
-#include "connections.h"
 #include "components.h"
 
-/**
- * Connect all of the registers in the register file to the input of the
- * specifed bus. Utility function.
- *
- * @param b The bus to connect the register file to.
- */
-void connect_reg_file_to_bus_input(Bus &b);
-
-/**
- * Connect all of the registers in the register file to the output of the
- * specified bus. Utility function.
- *
- * @param b The bus to connect the register file to.
- */
-void connect_reg_file_to_bus_output(Bus &b);
-
-/**
- * Make the connections that will be used in the fetch stage of the pipeline.
- */
-void make_fetch_stage_connections(void);
-
-/**
- * Make the connections that will be used in the decode stage of the pipeline.
- */
-void make_decode_stage_connections(void);
-
-/**
- * Make the connections that will be used in the execute stage of the
- * pipeline.
- */
-void make_execute_stage_connections(void);
-
-/**
- * Make the connections that will be used in the memory stage of the pipeline.
- */
-void make_memory_stage_connections(void);
-
-/**
- * Make the connections that will be used in the writeback stage of the
- * pipeline.
- */
-void make_writeback_stage_connections(void);
-
-/**
- * Make the connections that will be used for forwarding results from leter
- * instructions back to the execute stage.
- */
-void make_connections_for_forwarding(void);
-
-/**
- * Make the connections that will be used for inserting NOPs in order to do
- * stalling after load instructions.
- */
-void make_connections_for_stalling(void);
-
-void connect_components(void) {
+void z88_components::connect_components(void) {
 	//connection for bootstrapping program entry point
 	if_r.pc.connectsTo(instruction_mem.READ());
 
@@ -75,12 +19,14 @@ void connect_components(void) {
 	make_memory_stage_connections();
 	make_writeback_stage_connections();
 
-	//make additional connections used in forwarding and stalling
+	/* make additional connections used in forwarding, stalling and
+		branch prediction */
 	make_connections_for_forwarding();
 	make_connections_for_stalling();
+	make_connections_for_branch_prediction();
 }
 
-void make_fetch_stage_connections(void) {
+void z88_components::make_fetch_stage_connections(void) {
 	/* for loading the instruction memory MAR with the contents of the
 		program counter */
 	if_r.pc.connectsTo(if_instruction_mem_addr_bus.IN());
@@ -108,7 +54,7 @@ void make_fetch_stage_connections(void) {
 	if_r.pc.connectsTo(id_imm_alu.OUT());
 }
 
-void make_decode_stage_connections(void) {
+void z88_components::make_decode_stage_connections(void) {
 	//connections for reading 'rs' register contents into A
 	connect_reg_file_to_bus_input(id_a_load_bus);
 	idex_r.a.connectsTo(id_a_load_bus.OUT());
@@ -169,7 +115,7 @@ void make_decode_stage_connections(void) {
 	ifid_r.new_pc.connectsTo(id_imm_alu.OP2());
 }
 
-void make_execute_stage_connections(void) {
+void z88_components::make_execute_stage_connections(void) {
 	/* for forwarding the instruction register contents through to the
 		EX/MEM pipeline register */
 	idex_r.ir.connectsTo(ex_ir_forward.IN());
@@ -210,7 +156,7 @@ void make_execute_stage_connections(void) {
 	ex_jump_link_return_offset.connectsTo(ex_alu.OP2());
 }
 
-void make_memory_stage_connections(void) {
+void z88_components::make_memory_stage_connections(void) {
 	/* for forwarding instruction register contents through to MEM/WB
 		pipeline register */
 	exmem_r.ir.connectsTo(mem_ir_forward.IN());
@@ -242,7 +188,7 @@ void make_memory_stage_connections(void) {
 	memwb_r.valid.connectsTo(mem_valid_forward.OUT());
 }
 
-void make_writeback_stage_connections(void) {
+void z88_components::make_writeback_stage_connections(void) {
 	//used to write ALU results to destination registers
 	memwb_r.c.connectsTo(wb_register_write_bus.IN());
 	connect_reg_file_to_bus_output(wb_register_write_bus);
@@ -260,7 +206,7 @@ void make_writeback_stage_connections(void) {
 	post_wb_r.ir.connectsTo(wb_ir_forward.OUT());
 }
 
-void make_connections_for_forwarding(void) {
+void z88_components::make_connections_for_forwarding(void) {
 	/* for forwarding execution and load results that write the executing
 		instruction's 'rs' register back to the execute stage */
 	exmem_r.c.connectsTo(idex_a_fill.IN());
@@ -280,14 +226,45 @@ void make_connections_for_forwarding(void) {
 	memwb_r.c.connectsTo(id_temp_reg_load_bus.IN());
 }
 
-void make_connections_for_stalling(void) {
+void z88_components::make_connections_for_stalling(void) {
 	/* for inserting NOP instructions into the pipeline to produce a
 		stall effect */
 	stalling_nop_constant.connectsTo(idex_nop_insert_bus.IN());
 	idex_r.ir.connectsTo(idex_nop_insert_bus.OUT());
 }
 
-void connect_reg_file_to_bus_input(Bus &b) {
+void z88_components::make_connections_for_branch_prediction(void) {
+	/* for sending the predicted target of a jump through a register to
+		the program counter */
+	id_predicted_target.connectsTo(if_branch_bus.IN());
+
+	/* for restarting the fetch stage at the right address after a
+		misprediction: the branch target (held in IMM) for a branch
+		wrongly predicted not taken, the forwarded 'rs' register (in
+		A) for a jump through a register, and the address after the
+		delay slot (from the ALU) for a branch wrongly predicted
+		taken */
+	idex_r.imm.connectsTo(ex_redirect_bus.IN());
+	idex_r.a.connectsTo(ex_redirect_bus.IN());
+	if_r.pc.connectsTo(ex_redirect_bus.OUT());
+	if_r.pc.connectsTo(ex_alu.OUT());
+}
+
+void z88_components::make_instruction_cache_connections(void) {
+	//the same connections the fetch stage makes to instruction memory
+	instruction_cache->MAR().connectsTo(
+		if_instruction_mem_addr_bus.OUT());
+	ifid_r.ir.connectsTo(instruction_cache->READ());
+}
+
+void z88_components::make_data_cache_connections(void) {
+	//the same connections the memory stage makes to data memory
+	data_cache->MAR().connectsTo(mem_data_mem_addr_bus.OUT());
+	memwb_r.c.connectsTo(data_cache->READ());
+	exmem_r.b.connectsTo(data_cache->WRITE());
+}
+
+void z88_components::connect_reg_file_to_bus_input(Bus &b) {
 	//for each general purpose register
 	for(unsigned int i = 0; i < NUM_GPRS; ++i) {
 		//connect it to the bus
@@ -295,7 +272,7 @@ void connect_reg_file_to_bus_input(Bus &b) {
 	}
 }
 
-void connect_reg_file_to_bus_output(Bus &b) {
+void z88_components::connect_reg_file_to_bus_output(Bus &b) {
 	//for each general purpose register
 	for(unsigned int i = 0; i < NUM_GPRS; ++i) {
 		//connect it to the bus
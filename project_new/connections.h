@@ -1,16 +0,0 @@
-/**
- * Header file for "connections" module, which creates all of the connections
- * between z88 CPU components.
- *
- * Authors: Coleman Link and Ben Maitland
- */
-
-#ifndef _CONNECTIONS_H_
-#define _CONNECTIONS_H_
-
-/**
- * Set up all of the connections between hardware components for the z88 CPU.
- */
-void connect_components(void);
-
-#endif // _CONNECTIONS_H_
@@ -0,0 +1,207 @@
+/**
+ * Source file for "cpi_stack" module that attributes every cycle the z88's
+ * pipeline runs to what it spent that cycle on, and breaks its CPI down by
+ * those causes, overall and by instruction address.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+//C++ includes
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+//local project includes
+#include "cpi_stack.h"
+#include "instruction_decode.h"
+
+//how each cause is named in the report
+static const char *cause_names[NUM_CYCLE_CAUSES] = {
+	"retired",
+	"load-use stall (ID/EX)",
+	"load-to-branch stall (EX/MEM)",
+	"ID result stall (ID/EX)",
+	"pending load stall (MSHR)",
+	"misprediction",
+	"instruction memory stall",
+	"data memory stall",
+	"pipeline fill",
+	"pipeline drain",
+	"halt"
+};
+
+//the causes that are charged to the instructions that suffered them
+static const cycle_cause charged_causes[] = {
+	CYCLE_LOAD_USE_STALL,
+	CYCLE_LOAD_TO_BRANCH_STALL,
+	CYCLE_ID_RESULT_STALL,
+	CYCLE_PENDING_LOAD_STALL,
+	CYCLE_MISPREDICTION,
+	CYCLE_IMEM_STALL,
+	CYCLE_DMEM_STALL
+};
+
+//how those causes head their columns in the report
+static const char *charged_headings[] = {
+	"load-use",
+	"load-br",
+	"ID-result",
+	"pend-load",
+	"mispred",
+	"I-mem",
+	"D-mem"
+};
+
+cpi_stack::cpi_stack(void) :
+	totals(),
+	by_address(false),
+	addresses()
+{}
+
+void cpi_stack::count_by_address(bool enable) {
+	by_address = enable;
+}
+
+void cpi_stack::count(cycle_cause cause, uint32_t pc, z11::op operation) {
+	totals[cause]++;
+
+	//only continue if counting by address
+	if(!by_address) {
+		return;
+	}
+
+	auto entry = addresses.find(pc);
+	if(entry == addresses.end()) {
+		entry = addresses.emplace(pc,
+			address_cycles{z11::UNKNOWN, {}}).first;
+	}
+
+	entry->second.cycles[cause]++;
+	if(operation != z11::UNKNOWN) {
+		entry->second.operation = operation;
+	}
+}
+
+cycle_cause cpi_stack::stall_cycle_cause(z11::stall_cause stall) {
+	switch(stall) {
+		case z11::LOAD_USE_STALL:
+			return CYCLE_LOAD_USE_STALL;
+		case z11::LOAD_TO_BRANCH_STALL:
+			return CYCLE_LOAD_TO_BRANCH_STALL;
+		case z11::ID_RESULT_STALL:
+			return CYCLE_ID_RESULT_STALL;
+		case z11::PENDING_LOAD_STALL:
+			return CYCLE_PENDING_LOAD_STALL;
+		default:
+			return CYCLE_RETIRED;
+	}
+}
+
+unsigned long cpi_stack::cycles(cycle_cause cause) const {
+	return totals[cause];
+}
+
+unsigned long cpi_stack::total_cycles(void) const {
+	unsigned long total = 0;
+
+	for(unsigned long cycles : totals) {
+		total += cycles;
+	}
+
+	return total;
+}
+
+void cpi_stack::print_report(std::ostream &out, const symbol_table &symbols,
+	unsigned int top) const {
+	std::ios_base::fmtflags old = out.flags();
+	std::streamsize old_precision = out.precision();
+	char old_fill = out.fill();
+	unsigned long total = total_cycles();
+	//the HALT is a program instruction too
+	unsigned long instructions = totals[CYCLE_RETIRED] +
+		totals[CYCLE_HALT];
+	double per_instruction = (instructions ? 1.0 / instructions : 0.0);
+
+	out << std::dec << std::setfill(' ') << std::fixed << std::endl <<
+		"CPI stack: " << instructions << " instructions in " << total <<
+		" cycles (CPI " << std::setprecision(4) <<
+		(total * per_instruction) << ")" << std::endl;
+	out << std::left << std::setw(32) << "Cause" << std::right <<
+		std::setw(12) << "Cycles" << std::setw(10) << "CPI" <<
+		std::setw(9) << "Share" << std::endl;
+
+	for(unsigned int i = 0; i < NUM_CYCLE_CAUSES; ++i) {
+		out << std::left << std::setw(32) << cause_names[i] <<
+			std::right << std::setw(12) << totals[i] <<
+			std::setw(10) << std::setprecision(4) <<
+			(totals[i] * per_instruction) << std::setw(8) <<
+			std::setprecision(1) <<
+			(total ? (100.0 * totals[i] / total) : 0.0) << "%" <<
+			std::endl;
+	}
+
+	/* rank the instructions by the cycles charged to them other than
+		for retiring */
+	std::vector<std::pair<unsigned long, uint32_t>> ranked;
+	for(const auto &entry : addresses) {
+		unsigned long charged = 0;
+		for(cycle_cause cause : charged_causes) {
+			charged += entry.second.cycles[cause];
+		}
+		if(charged) {
+			ranked.push_back({charged, entry.first});
+		}
+	}
+	std::sort(ranked.begin(), ranked.end(),
+		[](const std::pair<unsigned long, uint32_t> &a,
+		const std::pair<unsigned long, uint32_t> &b) {
+			return (a.first != b.first) ? (a.first > b.first) :
+				(a.second < b.second);
+		});
+	if(ranked.size() > top) {
+		ranked.resize(top);
+	}
+
+	//only continue if an instruction was charged cycles
+	if(ranked.empty()) {
+		(void)out.flags(old);
+		(void)out.precision(old_precision);
+		(void)out.fill(old_fill);
+		return;
+	}
+
+	out << std::endl << "Stall, misprediction and memory cycles by" <<
+		" instruction (top " << ranked.size() << "):" << std::endl;
+	out << std::left << std::setw(10) << "Address" << std::setw(8) <<
+		"Instr" << std::right << std::setw(12) << "Retired";
+	for(const char *heading : charged_headings) {
+		out << std::setw(10) << heading;
+	}
+	out << std::setw(9) << "CPI" << "  Location" << std::endl;
+
+	for(const auto &rank : ranked) {
+		const address_cycles &entry = addresses.at(rank.second);
+		unsigned long retired = entry.cycles[CYCLE_RETIRED];
+
+		out << std::hex << std::setfill('0') << std::setw(8) <<
+			rank.second << std::dec << std::setfill(' ') << "  " <<
+			std::left << std::setw(8) <<
+			z11::mnemonics[entry.operation] << std::right <<
+			std::setw(12) << retired;
+		for(cycle_cause cause : charged_causes) {
+			out << std::setw(10) << entry.cycles[cause];
+		}
+
+		//the cycles each execution of it took, counting its own
+		out << std::setw(9) << std::setprecision(4) <<
+			(retired ? (double)(retired + rank.first) / retired :
+			0.0) << "  " << symbols.locate(rank.second) <<
+			std::endl;
+	}
+
+	(void)out.flags(old);
+	(void)out.precision(old_precision);
+	(void)out.fill(old_fill);
+}
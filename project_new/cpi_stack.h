@@ -0,0 +1,139 @@
+/**
+ * Header file for "cpi_stack" module that attributes every cycle the z88's
+ * pipeline runs to what it spent that cycle on, and breaks its CPI down by
+ * those causes, overall and by instruction address.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+#ifndef _CPI_STACK_H_
+#define _CPI_STACK_H_
+
+//C++ includes
+#include <iostream>
+#include <array>
+#include <unordered_map>
+#include <cstdint>
+
+//local project includes
+#include "instruction_decode.h"
+#include "profiler.h"
+
+/* what a pipeline cycle was spent on, judged by what left the writeback
+	stage that cycle (or, if the pipeline was held for a memory
+	access, by which memory was waited for) */
+enum cycle_cause {
+	//a program instruction retired
+	CYCLE_RETIRED,
+	//a stall NOP retired, for a load in ID/EX
+	CYCLE_LOAD_USE_STALL,
+	//a stall NOP retired, for a load in EX/MEM used in the decode stage
+	CYCLE_LOAD_TO_BRANCH_STALL,
+	/* a stall NOP retired, for a result from ID/EX used in the decode
+		stage */
+	CYCLE_ID_RESULT_STALL,
+	/* a stall NOP retired, for a load still waiting on memory (see
+		z88_cpu::use_non_blocking_loads()) */
+	CYCLE_PENDING_LOAD_STALL,
+	//nothing retired, as an instruction was squashed after a misprediction
+	CYCLE_MISPREDICTION,
+	/* nothing moved, as the fetch stage waited for the instruction
+		memory (or a miss in its cache) */
+	CYCLE_IMEM_STALL,
+	/* nothing moved, as the memory stage waited for the data memory (or
+		a miss in its cache) */
+	CYCLE_DMEM_STALL,
+	//nothing retired, as the pipeline was still filling
+	CYCLE_FILL,
+	//nothing retired, as the pipeline was draining
+	CYCLE_DRAIN,
+	//the HALT retired
+	CYCLE_HALT,
+	//number of causes in this enum
+	NUM_CYCLE_CAUSES
+};
+
+/**
+ * The cycles of a run of the pipeline, counted by cause. Can also count
+ * them by the address of the instruction they are charged to: the one that
+ * retired, the one that was stalled, the branch or jump that was
+ * mispredicted, or the one whose fetch, load or store was waited for.
+ */
+class cpi_stack {
+	public:
+		/**
+		 * Build an empty CPI stack.
+		 */
+		cpi_stack(void);
+
+		/**
+		 * Start or stop counting cycles by instruction address.
+		 *
+		 * @param enable Whether to count them.
+		 */
+		void count_by_address(bool enable);
+
+		/**
+		 * Count a cycle.
+		 *
+		 * @param cause What the cycle was spent on.
+		 * @param pc The address of the instruction it is charged to,
+		 *	if any.
+		 * @param operation That instruction, if it retired.
+		 */
+		void count(cycle_cause cause, uint32_t pc = 0,
+			z11::op operation = z11::UNKNOWN);
+
+		/**
+		 * Convert a stall NOP's cause to the cause of its cycle.
+		 *
+		 * @param stall Why the NOP was put in.
+		 * @returns The cause of the cycle it retires in.
+		 */
+		static cycle_cause stall_cycle_cause(z11::stall_cause stall);
+
+		/**
+		 * Get the cycles counted for a cause.
+		 *
+		 * @param cause The cause.
+		 * @returns The cycles.
+		 */
+		unsigned long cycles(cycle_cause cause) const;
+
+		/**
+		 * Get the cycles counted in all.
+		 *
+		 * @returns The cycles.
+		 */
+		unsigned long total_cycles(void) const;
+
+		/**
+		 * Print the CPI stack: the cycles and CPI spent on each cause,
+		 * and, if they were counted, the instructions that most
+		 * cycles other than their own retirement were charged to.
+		 *
+		 * @param out Where to print the report.
+		 * @param symbols The program's labels, to name the
+		 *	instructions with.
+		 * @param top The most instructions to list.
+		 */
+		void print_report(std::ostream &out,
+			const symbol_table &symbols,
+			unsigned int top = 10) const;
+
+	private:
+		//the cycles charged to one instruction address, by cause
+		struct address_cycles {
+			z11::op operation;
+			std::array<unsigned long, NUM_CYCLE_CAUSES> cycles;
+		};
+
+		//the cycles by cause
+		std::array<unsigned long, NUM_CYCLE_CAUSES> totals;
+
+		//whether cycles are counted by address too, and their counts
+		bool by_address;
+		std::unordered_map<uint32_t, address_cycles> addresses;
+};
+
+#endif // _CPI_STACK_H_
@@ -0,0 +1,185 @@
+/**
+ * Source file for "functional" module that executes programs one instruction
+ * at a time, without the pipeline, for when only a program's results and its
+ * instruction trace are wanted.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+//C++ includes
+#include <iostream>
+#include <cstdint>
+
+//local project includes
+#include "run_program.h"
+#include "components.h"
+#include "instruction_decode.h"
+
+
+/***********************************
+ * Function implementations        *
+ ***********************************/
+
+void z88_cpu::run_functional(void) {
+	//the clock and static interfaces below act on this z88
+	context.makeCurrent();
+
+	//the entry point comes through the PC, as for the pipeline
+	bootstrap_program();
+
+	//start from whatever the GPRs hold (all zero for a new z88)
+	enter_functional();
+
+	while(!halted) {
+		//stop a runaway program, or one whose trace can't be written
+		if((cycle_limit && (instructions >= cycle_limit)) || !out) {
+			break;
+		}
+
+		step_functional();
+	}
+}
+
+void z88_cpu::step_functional(void) {
+	uint32_t pc = functional_pc;
+	uint32_t word = instruction_mem.peek(pc);
+	micro_op uop = decode_micro_op(word);
+	uint32_t target = functional_next_pc + 4;
+
+	execute_functional(pc, word, uop, target);
+	halted = instruction_halts(uop.operation);
+
+	print_instruction_record(pc, word, uop);
+
+	functional_pc = functional_next_pc;
+	functional_next_pc = target;
+}
+
+void z88_cpu::enter_functional(void) {
+	functional = true;
+	for(unsigned int i = 0; i < NUM_GPRS; ++i) {
+		functional_gprs[i] = GPR(i).uvalue();
+	}
+
+	functional_pc = if_r.pc.uvalue();
+	functional_next_pc = functional_pc + 4;
+}
+
+void z88_cpu::execute_functional(uint32_t pc, uint32_t word,
+	const micro_op &uop, uint32_t &target) {
+	uint32_t rs = functional_gprs[uop.rs];
+	uint32_t rt = functional_gprs[uop.rt];
+	uint32_t imm = (uint32_t)uop.immediate;
+	//zero-extended immediate
+	uint32_t uimm = word & 0xFFFF;
+	//shift amount, from the 'sh' field or from 'rs'
+	uint32_t sh = ((uop.classes & z11::VARIABLE_SHIFT) ? rs :
+		(word >> 6)) & 0x1F;
+	uint32_t result = 0;
+
+	switch(uop.operation) {
+		//immediate ALU instructions
+		case z11::ADDI:
+			result = rs + imm;
+			break;
+		case z11::SLTI:
+			result = ((int32_t)rs < (int32_t)imm);
+			break;
+		case z11::ANDI:
+			result = rs & uimm;
+			break;
+		case z11::ORI:
+			result = rs | uimm;
+			break;
+		case z11::XORI:
+			result = rs ^ uimm;
+			break;
+		case z11::LUI:
+			result = uimm << 16;
+			break;
+
+		//register-register ALU instructions
+		case z11::ADD:
+			result = rs + rt;
+			break;
+		case z11::SUB:
+			result = rs - rt;
+			break;
+		case z11::AND:
+			result = rs & rt;
+			break;
+		case z11::OR:
+			result = rs | rt;
+			break;
+		case z11::XOR:
+			result = rs ^ rt;
+			break;
+		case z11::SLT:
+			result = ((int32_t)rs < (int32_t)rt);
+			break;
+		case z11::SLTU:
+			result = (rs < rt);
+			break;
+		case z11::SLL:
+		case z11::SLLV:
+			result = rt << sh;
+			break;
+		case z11::SRL:
+		case z11::SRLV:
+			result = rt >> sh;
+			break;
+		case z11::SRA:
+		case z11::SRAV:
+			result = (uint32_t)((int32_t)rt >> sh);
+			break;
+
+		//load/store instructions
+		case z11::LW:
+			result = data_mem.peek(rs + imm);
+			break;
+		case z11::SW:
+			data_mem.poke(rs + imm, rt);
+			break;
+
+		//jumps, which link to the instruction after the delay slot
+		case z11::J:
+			target = word & 0x03FFFFFF;
+			break;
+		case z11::JAL:
+			target = word & 0x03FFFFFF;
+			result = pc + 8;
+			break;
+		case z11::JR:
+			target = rs;
+			break;
+		case z11::JALR:
+			target = rs;
+			result = pc + 8;
+			break;
+
+		//branches, whose offsets are from the delay slot
+		case z11::BEQ:
+			if(rs == rt) {
+				target = pc + 4 + imm;
+			}
+			break;
+		case z11::BNE:
+			if(rs != rt) {
+				target = pc + 4 + imm;
+			}
+			break;
+
+		//do nothing (halting is decided by 'instruction_halts')
+		case z11::NOP:
+		case z11::HALT:
+		case z11::BREAK:
+		case z11::UNKNOWN: //invalid instructions
+		default: //valid but unimplemented instructions
+			break;
+	}
+
+	//r0 can't be overwritten
+	if(uop.destination != 0) {
+		functional_gprs[uop.destination] = result;
+	}
+}
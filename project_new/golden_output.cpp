@@ -0,0 +1,85 @@
+/**
+ * Source file for "golden_output" module that checks a z88's output, as it
+ * is written, against the expected ("golden") output for a test program.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+//C++ includes
+#include <algorithm>
+#include <cstring>
+
+//local project includes
+#include "golden_output.h"
+
+golden_output::golden_output(const std::string &expected) :
+	expected(expected),
+	position(expected.find('\n')),
+	past_banner(false),
+	differed(false)
+{
+	//nothing to compare if there isn't even a banner line
+	if(position == std::string::npos) {
+		position = expected.size();
+	}
+}
+
+bool golden_output::matching(void) const {
+	return !differed;
+}
+
+bool golden_output::matched(void) const {
+	return !differed && past_banner && (position == expected.size());
+}
+
+unsigned long golden_output::line(void) const {
+	return std::count(expected.begin(), expected.begin() + position,
+		'\n') + 1;
+}
+
+golden_output::int_type golden_output::overflow(int_type c) {
+	if(traits_type::eq_int_type(c, traits_type::eof())) {
+		return traits_type::not_eof(c);
+	}
+
+	char ch = traits_type::to_char_type(c);
+
+	return (xsputn(&ch, 1) == 1) ? c : traits_type::eof();
+}
+
+std::streamsize golden_output::xsputn(const char *s, std::streamsize n) {
+	std::streamsize done = 0;
+
+	if(differed) {
+		return 0;
+	}
+
+	//skip the output's banner line, up to the newline that ends it
+	if(!past_banner) {
+		const char *nl = static_cast<const char *>(memchr(s, '\n', n));
+
+		if(!nl) {
+			return n;
+		}
+
+		done = nl - s;
+		past_banner = true;
+	}
+
+	//compare the rest against the expected output
+	std::streamsize left = n - done;
+	std::streamsize avail = expected.size() - position;
+	std::streamsize len = std::min(left, avail);
+
+	const char *mismatch = std::mismatch(s + done, s + done + len,
+		expected.data() + position).first;
+
+	position += mismatch - (s + done);
+
+	if((mismatch != s + done + len) || (left > avail)) {
+		differed = true;
+		return mismatch - s;
+	}
+
+	return n;
+}
@@ -0,0 +1,80 @@
+/**
+ * Header file for "golden_output" module that checks a z88's output, as it
+ * is written, against the expected ("golden") output for a test program.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+#ifndef _GOLDEN_OUTPUT_H_
+#define _GOLDEN_OUTPUT_H_
+
+//C++ includes
+#include <streambuf>
+#include <string>
+
+/**
+ * A stream buffer that compares everything written to it against the
+ * expected output instead of storing it. Writing fails as soon as the
+ * output differs from what was expected, so a z88 writing its trace through
+ * an ostream on this buffer can stop right there.
+ *
+ * The first line on both sides is the simulator banner, which carries the
+ * date the arch library was built, so it is not compared.
+ */
+class golden_output : public std::streambuf {
+	public:
+		/**
+		 * Make a comparator for the given expected output.
+		 *
+		 * @param expected The complete expected output. Must outlive
+		 *	the comparator.
+		 */
+		golden_output(const std::string &expected);
+
+		/**
+		 * Determine whether everything written so far matched the
+		 * expected output.
+		 *
+		 * @returns True if no difference has been found yet.
+		 */
+		bool matching(void) const;
+
+		/**
+		 * Determine whether the output matched and was complete, that
+		 * is, nothing expected is still missing.
+		 *
+		 * @returns True if the output was exactly as expected.
+		 */
+		bool matched(void) const;
+
+		/**
+		 * Get the line of the expected output at which the output
+		 * first differed, or at which it stopped short.
+		 *
+		 * @returns The line number, counting from 1.
+		 */
+		unsigned long line(void) const;
+
+	protected:
+		//compare a single character
+		int_type overflow(int_type c) override;
+
+		//compare a run of characters
+		std::streamsize xsputn(const char *s, std::streamsize n)
+			override;
+
+	private:
+		//the expected output
+		const std::string &expected;
+
+		//how much of the expected output has been matched
+		std::string::size_type position;
+
+		//whether the output's banner line has been skipped yet
+		bool past_banner;
+
+		//whether the output has differed from the expected output
+		bool differed;
+};
+
+#endif // _GOLDEN_OUTPUT_H_
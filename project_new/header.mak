@@ -3,5 +3,5 @@ ARCHVER = arch2-5a
 CXX = g++
 CCFLAGS = -g -I$(BASE)/include/$(ARCHVER)
 CXXFLAGS = $(CCFLAGS) -std=c++14
-LIBFLAGS = -g -L$(BASE)/lib/$(SYS_TYPE) -l$(ARCHVER)
+LIBFLAGS = -g -L$(BASE)/lib/$(SYS_TYPE) -l$(ARCHVER) -lpthread
 CCLIBFLAGS = $(LIBFLAGS)
@@ -6,6 +6,9 @@
  * Authors: Coleman Link and Ben Maitland
  */
 
+//C++ includes
+#include <cstdint>
+
 //local project includes
 #include "instruction_decode.h"
 
@@ -65,209 +68,243 @@ namespace z11 {
 }
 
 
+/* class bits shared by each group of instructions. Shifts count as R-R ALU
+	ops based on tests developed to see when the example solution does
+	and doesn't do forwarding. Also, shifts read 'rt' and write 'rd', like
+	R-R ALU instruction do. */
+const unsigned int RR_ALU = z11::REGISTER_ALU | z11::USES_RS | z11::USES_RT |
+	z11::USES_RT_IN_EX;
+const unsigned int IMM_ALU = z11::IMMEDIATE_ALU | z11::USES_RS;
+const unsigned int JUMP_REG = z11::JUMP | z11::JUMP_REGISTER | z11::USES_RS |
+	z11::USES_RS_IN_ID;
+
+//which field of an instruction selects its table entry
+enum decode_field {
+	OPCODE,
+	FUNCT
+};
+
+//one instruction of the z88 ISA
+struct isa_entry {
+	//the instruction
+	z11::op operation;
+	//where its code is
+	decode_field field;
+	//its opcode or 'funct' value
+	unsigned int code;
+	//its class bits
+	unsigned int classes;
+	//the field naming the GPR it writes, if any
+	z11::destination written;
+};
+
+/* the z88 ISA, from which the decode tables are built. Unimplemented
+	instructions have no class bits, so the pipeline treats them like
+	NOPs */
+constexpr isa_entry isa[] = {
+	{z11::NOP,	OPCODE,	1,	0,	z11::NO_DESTINATION},
+	{z11::J,	OPCODE,	2,	z11::JUMP,	z11::NO_DESTINATION},
+	{z11::JAL,	OPCODE,	3,	z11::JUMP,	z11::DESTINATION_R31},
+	{z11::ADDI,	OPCODE,	16,	IMM_ALU,	z11::DESTINATION_RT},
+	{z11::ADDIU,	OPCODE,	17,	0,	z11::NO_DESTINATION},
+	{z11::ANDI,	OPCODE,	20,	IMM_ALU,	z11::DESTINATION_RT},
+	{z11::ORI,	OPCODE,	21,	IMM_ALU,	z11::DESTINATION_RT},
+	{z11::XORI,	OPCODE,	22,	IMM_ALU,	z11::DESTINATION_RT},
+	//SLTI gets 'rt' forwarded, but doesn't use it
+	{z11::SLTI,	OPCODE,	24,	IMM_ALU | z11::SET_IF_LESS_THAN |
+		z11::USES_RT_IN_EX,	z11::DESTINATION_RT},
+	{z11::SLTIU,	OPCODE,	25,	0,	z11::NO_DESTINATION},
+	{z11::LB,	OPCODE,	32,	0,	z11::NO_DESTINATION},
+	{z11::LH,	OPCODE,	33,	0,	z11::NO_DESTINATION},
+	{z11::LW,	OPCODE,	35,	z11::LOAD | z11::USES_RS,
+		z11::DESTINATION_RT},
+	{z11::LBU,	OPCODE,	36,	0,	z11::NO_DESTINATION},
+	{z11::LHU,	OPCODE,	37,	0,	z11::NO_DESTINATION},
+	//LUI counts as reading 'rs', like the other ALU immediates
+	{z11::LUI,	OPCODE,	39,	IMM_ALU,	z11::DESTINATION_RT},
+	{z11::SB,	OPCODE,	40,	0,	z11::NO_DESTINATION},
+	{z11::SH,	OPCODE,	41,	0,	z11::NO_DESTINATION},
+	{z11::SW,	OPCODE,	43,	z11::STORE | z11::USES_RS |
+		z11::USES_RT | z11::USES_RT_IN_EX,	z11::NO_DESTINATION},
+	{z11::BLTZ,	OPCODE,	50,	0,	z11::NO_DESTINATION},
+	{z11::BLTZAL,	OPCODE,	51,	0,	z11::NO_DESTINATION},
+	{z11::BGEZ,	OPCODE,	58,	0,	z11::NO_DESTINATION},
+	{z11::BGEZAL,	OPCODE,	59,	0,	z11::NO_DESTINATION},
+	{z11::BEQ,	OPCODE,	60,	z11::BRANCH | z11::USES_RS |
+		z11::USES_RT | z11::USES_RS_IN_ID | z11::USES_RT_IN_ID,
+		z11::NO_DESTINATION},
+	{z11::BNE,	OPCODE,	61,	z11::BRANCH | z11::USES_RS |
+		z11::USES_RT | z11::USES_RS_IN_ID | z11::USES_RT_IN_ID,
+		z11::NO_DESTINATION},
+	{z11::BLEZ,	OPCODE,	62,	0,	z11::NO_DESTINATION},
+	{z11::BGTZ,	OPCODE,	63,	0,	z11::NO_DESTINATION},
+
+	{z11::HALT,	FUNCT,	0,	0,	z11::NO_DESTINATION},
+	{z11::JR,	FUNCT,	2,	JUMP_REG,	z11::NO_DESTINATION},
+	{z11::JALR,	FUNCT,	3,	JUMP_REG,	z11::DESTINATION_RD},
+	{z11::SYSCALL,	FUNCT,	6,	0,	z11::NO_DESTINATION},
+	{z11::BREAK,	FUNCT,	7,	0,	z11::NO_DESTINATION},
+	{z11::ADD,	FUNCT,	16,	RR_ALU,	z11::DESTINATION_RD},
+	{z11::ADDU,	FUNCT,	17,	0,	z11::NO_DESTINATION},
+	{z11::SUB,	FUNCT,	18,	RR_ALU,	z11::DESTINATION_RD},
+	{z11::SUBU,	FUNCT,	19,	0,	z11::NO_DESTINATION},
+	{z11::AND,	FUNCT,	20,	RR_ALU,	z11::DESTINATION_RD},
+	{z11::OR,	FUNCT,	21,	RR_ALU,	z11::DESTINATION_RD},
+	{z11::XOR,	FUNCT,	22,	RR_ALU,	z11::DESTINATION_RD},
+	{z11::NOR,	FUNCT,	23,	0,	z11::NO_DESTINATION},
+	{z11::SLT,	FUNCT,	24,	RR_ALU | z11::SET_IF_LESS_THAN,
+		z11::DESTINATION_RD},
+	{z11::SLTU,	FUNCT,	25,	RR_ALU | z11::SET_IF_LESS_THAN,
+		z11::DESTINATION_RD},
+	{z11::SLL,	FUNCT,	37,	RR_ALU,	z11::DESTINATION_RD},
+	{z11::SRL,	FUNCT,	38,	RR_ALU,	z11::DESTINATION_RD},
+	{z11::SRA,	FUNCT,	39,	RR_ALU,	z11::DESTINATION_RD},
+	{z11::SLLV,	FUNCT,	45,	RR_ALU | z11::VARIABLE_SHIFT |
+		z11::USES_RS_IN_ID,	z11::DESTINATION_RD},
+	{z11::SRLV,	FUNCT,	46,	RR_ALU | z11::VARIABLE_SHIFT |
+		z11::USES_RS_IN_ID,	z11::DESTINATION_RD},
+	{z11::SRAV,	FUNCT,	47,	RR_ALU | z11::VARIABLE_SHIFT |
+		z11::USES_RS_IN_ID,	z11::DESTINATION_RD}
+};
+
+//lookup tables built from the ISA
+struct decode_tables {
+	//entry for each opcode; opcode 0 is looked up by 'funct' instead
+	z11::instruction_info opcodes[64];
+	//entry for each 'funct' value of a "special" instruction
+	z11::instruction_info functs[64];
+	//class bits for each instruction
+	unsigned int classes[z11::NUM_OPS];
+};
+
 /**
- * Helper function for decoding the 'funct' field of "special" instructions to
- * get their exact instruction type.
+ * Build the decode tables from the ISA. Codes not in the ISA decode to
+ * UNKNOWN.
  *
- * @param ir The instruction register to read the contents of the 'funct'
- *	field from.
- * @returns An enum value representing the instruction that was in the
- *      specified IR.
+ * @returns The decode tables.
  */
-z11::op decode_special_instruction(StorageObject &ir);
+constexpr decode_tables build_decode_tables(void) {
+	decode_tables tables{};
+	const z11::instruction_info unknown = {z11::UNKNOWN, 0,
+		z11::NO_DESTINATION};
 
+	for(unsigned int code = 0; code < 64; ++code) {
+		tables.opcodes[code] = unknown;
+		tables.functs[code] = unknown;
+	}
 
-z11::op decode_instruction(StorageObject &ir) {
-	switch(ir(31, 26)) {
-		case 0:
-			return decode_special_instruction(ir);
-		case 1: //NOP
-			return z11::NOP;
-		case 2: //J
-			return z11::J;
-		case 3: //JAL
-			return z11::JAL;
-		case 16: //ADDI
-			return z11::ADDI;
-		case 17: //ADDIU
-			return z11::ADDIU;
-		case 20: //ANDI
-			return z11::ANDI;
-		case 21: //ORI
-			return z11::ORI;
-		case 22: //XORI
-			return z11::XORI;
-		case 24: //SLTI
-			return z11::SLTI;
-		case 25: //SLTIU
-			return z11::SLTIU;
-		case 32: //LB
-			return z11::LB;
-		case 33: //LH
-			return z11::LH;
-		case 35: //LW
-			return z11::LW;
-		case 36: //LBU
-			return z11::LBU;
-		case 37: //LHU
-			return z11::LHU;
-		case 39: //LUI
-			return z11::LUI;
-		case 40: //SB
-			return z11::SB;
-		case 41: //SH
-			return z11::SH;
-		case 43: //SW
-			return z11::SW;
-		case 50: //BLTZ
-			return z11::BLTZ;
-		case 51: //BLTZAL
-			return z11::BLTZAL;
-		case 58: //BGEZ
-			return z11::BGEZ;
-		case 59: //BGEZAL
-			return z11::BGEZAL;
-		case 60: //BEQ
-			return z11::BEQ;
-		case 61: //BNE
-			return z11::BNE;
-		case 62: //BLEZ
-			return z11::BLEZ;
-		case 63: //BGTZ
-			return z11::BGTZ;
-		default:
-			return z11::UNKNOWN;
+	for(const isa_entry &entry : isa) {
+		const z11::instruction_info info = {entry.operation,
+			entry.classes, entry.written};
+
+		if(entry.field == OPCODE) {
+			tables.opcodes[entry.code] = info;
+		}
+		else {
+			tables.functs[entry.code] = info;
+		}
+		tables.classes[entry.operation] = entry.classes;
 	}
+
+	return tables;
+}
+
+constexpr decode_tables tables = build_decode_tables();
+
+
+const z11::instruction_info &decode_instruction_info(StorageObject &ir) {
+	return decode_instruction_info(ir.uvalue());
 }
 
-z11::op decode_special_instruction(StorageObject &ir) {
-	switch(ir(5, 0)) {
-		case 0: //HALT
-			return z11::HALT;
-		case 2: //JR
-			return z11::JR;
-		case 3: //JALR
-			return z11::JALR;
-		case 6: //SYSCALL
-			return z11::SYSCALL;
-		case 7: //BREAK
-			return z11::BREAK;
-		case 16: //ADD
-			return z11::ADD;
-		case 17: //ADDU
-			return z11::ADDU;
-		case 18: //SUB
-			return z11::SUB;
-		case 19: //SUBU
-			return z11::SUBU;
-		case 20: //AND
-			return z11::AND;
-		case 21: //OR
-			return z11::OR;
-		case 22: //XOR
-			return z11::XOR;
-		case 23: //NOR
-			return z11::NOR;
-		case 24: //SLT
-			return z11::SLT;
-		case 25: //SLTU
-			return z11::SLTU;
-		case 37: //SLL
-			return z11::SLL;
-		case 38: //SRL
-			return z11::SRL;
-		case 39: //SRA
-			return z11::SRA;
-		case 45: //SLLV
-			return z11::SLLV;
-		case 46: //SRLV
-			return z11::SRLV;
-		case 47: //SRAV
-			return z11::SRAV;
+const z11::instruction_info &decode_instruction_info(unsigned long word) {
+	unsigned int opcode = (word >> 26) & 0x3F;
+
+	if(opcode == 0) {
+		return tables.functs[word & 0x3F];
+	}
+
+	return tables.opcodes[opcode];
+}
+
+micro_op decode_micro_op(StorageObject &ir) {
+	return decode_micro_op(ir.uvalue());
+}
+
+micro_op decode_micro_op(unsigned long word) {
+	const z11::instruction_info &info = decode_instruction_info(word);
+	micro_op uop;
+
+	uop.operation = info.operation;
+	uop.classes = info.classes;
+	uop.rs = (word >> 21) & 0x1F;
+	uop.rt = (word >> 16) & 0x1F;
+	uop.rd = (word >> 11) & 0x1F;
+	uop.immediate = (int16_t)(word & 0xFFFF);
+	uop.stalled_for = z11::NO_STALL;
+	uop.stalled_pc = 0;
+
+	switch(info.written) {
+		case z11::DESTINATION_RT:
+			uop.destination = uop.rt;
+			break;
+		case z11::DESTINATION_RD:
+			uop.destination = uop.rd;
+			break;
+		case z11::DESTINATION_R31:
+			uop.destination = 31;
+			break;
 		default:
-			return z11::UNKNOWN;
+			uop.destination = 0;
+			break;
 	}
+
+	return uop;
 }
 
+z11::op decode_instruction(StorageObject &ir) {
+	return decode_instruction_info(ir).operation;
+}
+
+long destination_register(StorageObject &ir) {
+	return decode_micro_op(ir).destination;
+}
 
 bool is_special_instruction(StorageObject &ir) {
 	return (ir(31, 26) == 0);
 }
 
+bool has_class(z11::op instruction, unsigned int classes) {
+	return ((tables.classes[instruction] & classes) != 0);
+}
 
 bool is_register_alu_instruction(z11::op instruction) {
-	switch(instruction) {
-		case z11::ADD:
-		case z11::SUB:
-		case z11::AND:
-		case z11::OR:
-		case z11::XOR:
-		/* shifts count as R-R ALU ops based on tests developed to see
-			when the example solution does and doesn't do
-			forwarding. Also, shifts read 'rt' and write 'rd',
-			like R-R ALU instruction do. */
-		case z11::SLT:
-		case z11::SLTU:
-		case z11::SLL:
-		case z11::SRL:
-		case z11::SRA:
-		case z11::SLLV:
-		case z11::SRLV:
-		case z11::SRAV:
-			return true;
-	}
-
-	return false;
+	return has_class(instruction, z11::REGISTER_ALU);
 }
 
 bool is_immediate_alu_instruction(z11::op instruction) {
-	switch(instruction) {
-		case z11::ADDI:
-		case z11::SLTI:
-		case z11::ANDI:
-		case z11::ORI:
-		case z11::XORI:
-		case z11::LUI:
-			return true;
-	}
-
-	return false;
+	return has_class(instruction, z11::IMMEDIATE_ALU);
 }
 
 bool is_load_instruction(z11::op instruction) {
-	return (instruction == z11::LW);
+	return has_class(instruction, z11::LOAD);
 }
 
 bool is_store_instruction(z11::op instruction) {
-	return (instruction == z11::SW);
+	return has_class(instruction, z11::STORE);
 }
 
 bool is_branch_instruction(z11::op instruction) {
-	return ((instruction == z11::BEQ) || (instruction == z11::BNE));
+	return has_class(instruction, z11::BRANCH);
 }
 
 bool is_jump_register_instruction(z11::op instruction) {
-	return ((instruction == z11::JR) || (instruction == z11::JALR));
+	return has_class(instruction, z11::JUMP_REGISTER);
 }
 
 bool is_variable_shift_instruction(z11::op instruction) {
-	switch(instruction) {
-		case z11::SLLV:
-		case z11::SRLV:
-		case z11::SRAV:
-			return true;
-	}
-
-	return false;
+	return has_class(instruction, z11::VARIABLE_SHIFT);
 }
 
 bool is_set_if_less_than_instruction(z11::op instruction) {
-	switch(instruction) {
-		case z11::SLT:
-		case z11::SLTU:
-		case z11::SLTI:
-			return true;
-	}
-
-	return false;
+	return has_class(instruction, z11::SET_IF_LESS_THAN);
 }
@@ -9,6 +9,9 @@
 #ifndef _INSTRUCTION_DECODE_H_
 #define _INSTRUCTION_DECODE_H_
 
+//C++ includes
+#include <cstdint>
+
 //arch library imports
 #include <StorageObject.h>
 
@@ -70,18 +73,135 @@ namespace z11 {
 		SYSCALL = 45,
 		ADDU = 46,
 		SUBU = 47,
-		NOR = 48
+		NOR = 48,
+		//number of instructions in this enum
+		NUM_OPS = 49
+	};
+
+	/* bits describing what an instruction is and which of its operands
+		it reads when. An instruction's class is any combination of
+		these */
+	enum instruction_class : unsigned int {
+		//what kind of instruction it is
+		REGISTER_ALU = 1 << 0,
+		IMMEDIATE_ALU = 1 << 1,
+		LOAD = 1 << 2,
+		STORE = 1 << 3,
+		BRANCH = 1 << 4,
+		JUMP = 1 << 5,
+		JUMP_REGISTER = 1 << 6,
+		VARIABLE_SHIFT = 1 << 7,
+		SET_IF_LESS_THAN = 1 << 8,
+		//reads 'rs' or 'rt' somewhere (loads ahead of it must stall it)
+		USES_RS = 1 << 9,
+		USES_RT = 1 << 10,
+		//reads 'rs' or 'rt' in the decode stage
+		USES_RS_IN_ID = 1 << 11,
+		USES_RT_IN_ID = 1 << 12,
+		//has 'rt' forwarded to it in the execute stage
+		USES_RT_IN_EX = 1 << 13
+	};
+
+	//which field, if any, names the GPR an instruction writes
+	enum destination {
+		NO_DESTINATION,
+		DESTINATION_RT,
+		DESTINATION_RD,
+		//always r31 (ie: JAL)
+		DESTINATION_R31
+	};
+
+	//why the decode stage stalled an instruction, if it did
+	enum stall_cause : unsigned char {
+		NO_STALL,
+		//a load in ID/EX writes a register it uses
+		LOAD_USE_STALL,
+		/* a load in EX/MEM writes a register it uses in the decode
+			stage (ie: it is a branch or jump register) */
+		LOAD_TO_BRANCH_STALL,
+		/* the instruction in ID/EX writes a register it uses in the
+			decode stage */
+		ID_RESULT_STALL,
+		/* a load still waiting on memory in a miss-status holding
+			register writes a register it uses or writes */
+		PENDING_LOAD_STALL
+	};
+
+	//everything the decoder knows about an instruction
+	struct instruction_info {
+		op operation;
+		unsigned int classes;
+		destination written;
 	};
 
 	//list of strings containing the names of instructions
 	extern const char *mnemonics[];
 }
 
+/* an instruction decoded once, as it enters the decode stage, and carried
+	down the pipeline alongside its IR so that later stages and the
+	hazard checks can read its fields directly */
+struct micro_op {
+	//the instruction
+	z11::op operation;
+	//its z11::instruction_class bits
+	unsigned int classes;
+	//its 'rs', 'rt' and 'rd' fields
+	unsigned int rs;
+	unsigned int rt;
+	unsigned int rd;
+	//the GPR it writes, or 0 if it writes none
+	unsigned int destination;
+	//its sign-extended immediate field
+	long immediate;
+	/* if it is a NOP put in by a stall rather than a fetched one, why
+		the instruction behind it was stalled, and that instruction's
+		address */
+	z11::stall_cause stalled_for;
+	uint32_t stalled_pc;
+};
+
 //macros for extracting fields from the contents of an instruction register
 #define RS(ir) (ir(25, 21))
 #define RT(ir) (ir(20, 16))
 #define RD(ir) (ir(15, 11))
 
+/**
+ * Look up everything known about the instruction stored in the specified
+ * instruction register: its enum value, class bits and destination field.
+ *
+ * @param ir The instruction register to read the instruction from.
+ * @returns The decode table entry for the instruction's opcode, or for its
+ *	'funct' field if it is a "special" instruction.
+ */
+const z11::instruction_info &decode_instruction_info(StorageObject &ir);
+
+/**
+ * Look up everything known about an instruction, as for
+ * decode_instruction_info(StorageObject &), given the instruction itself.
+ *
+ * @param word The instruction.
+ * @returns The decode table entry for the instruction.
+ */
+const z11::instruction_info &decode_instruction_info(unsigned long word);
+
+/**
+ * Decode the instruction stored in the specified instruction register into a
+ * micro-op.
+ *
+ * @param ir The instruction register to read the instruction from.
+ * @returns The decoded instruction.
+ */
+micro_op decode_micro_op(StorageObject &ir);
+
+/**
+ * Decode an instruction into a micro-op, given the instruction itself.
+ *
+ * @param word The instruction.
+ * @returns The decoded instruction.
+ */
+micro_op decode_micro_op(unsigned long word);
+
 /**
  * Translate the instruction stored in the specified instruction register into
  * the CPU's internal enum-based representation.
@@ -92,6 +212,26 @@ namespace z11 {
  */
 z11::op decode_instruction(StorageObject &ir);
 
+/**
+ * Determine the GPR written by the instruction stored in the specified
+ * instruction register.
+ *
+ * @param ir The instruction register to read the instruction from.
+ * @returns The number of the GPR the instruction writes, or 0 if it writes
+ *	none.
+ */
+long destination_register(StorageObject &ir);
+
+/**
+ * Determine if the specified instruction is in any of the specified classes.
+ *
+ * @param instruction The instruction to test.
+ * @param classes The z11::instruction_class bits to test for.
+ * @returns True if the instruction has any of the class bits, false
+ *	otherwise.
+ */
+bool has_class(z11::op instruction, unsigned int classes);
+
 /**
  * Determine whether the instruction stored in the specified instruction
  * register is a "special" instruction that uses the 'funct' field to
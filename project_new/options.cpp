@@ -0,0 +1,357 @@
+/**
+ * Source file for "options" module that reads the options making up a z88's
+ * branch predictor, memory system and end-of-program reports, builds them
+ * into a z88 and prints its reports. The z88 takes them on its command line,
+ * and the regression runner from a test's .opts file.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+//C++ includes
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+//arch library includes
+#include <ProgramImage.h>
+
+//local project includes
+#include "options.h"
+#include "branch_predictor.h"
+#include "profiler.h"
+
+machine_options::machine_options(void) :
+	predictor(),
+	instruction_cache(),
+	data_cache(),
+	use_instruction_cache(false),
+	use_data_cache(false),
+	prefetcher(),
+	use_prefetcher(false),
+	latencies(),
+	dram(),
+	use_dram(false),
+	mshrs(0),
+	cpi(false),
+	profile(false),
+	assembly_file()
+{}
+
+bool parse_cache_config(const char *spec, cache_config &config) {
+	std::istringstream fields(spec);
+	std::string field;
+	unsigned long numbers[3];
+
+	config.replacement = Cache::lru;
+	config.write_policy = Cache::writeBack;
+	config.miss_penalty = 10;
+
+	//the size, line size and associativity must be given
+	for(unsigned long &number : numbers) {
+		char *end;
+
+		if(!std::getline(fields, field, ':') || field.empty()) {
+			return false;
+		}
+		number = strtoul(field.c_str(), &end, 0);
+		if(*end || !number) {
+			return false;
+		}
+	}
+	config.size = numbers[0];
+	config.line_size = numbers[1];
+	config.ways = numbers[2];
+
+	//the rest may be left out
+	if(std::getline(fields, field, ':')) {
+		if(field == "plru") {
+			config.replacement = Cache::plru;
+		}
+		else if(field == "random") {
+			config.replacement = Cache::random;
+		}
+		else if(field != "lru") {
+			return false;
+		}
+	}
+	if(std::getline(fields, field, ':')) {
+		if(field == "wt") {
+			config.write_policy = Cache::writeThrough;
+		}
+		else if(field != "wb") {
+			return false;
+		}
+	}
+	if(std::getline(fields, field, ':')) {
+		char *end;
+
+		config.miss_penalty = strtoul(field.c_str(), &end, 0);
+		if(*end || field.empty()) {
+			return false;
+		}
+	}
+
+	return !std::getline(fields, field, ':');
+}
+
+bool parse_memory_latency(const char *spec, memory_latency &latency) {
+	const char *colon = strchr(spec, ':');
+	char *end;
+
+	latency.first = 0;
+	latency.last = MAX_ADDR;
+
+	//the range, if there is one
+	if(colon) {
+		latency.first = strtoul(spec, &end, 0);
+		if(end == spec || *end != '-') {
+			return false;
+		}
+		latency.last = strtoul(end + 1, &end, 0);
+		if(end != colon || latency.first > latency.last) {
+			return false;
+		}
+		spec = colon + 1;
+	}
+
+	latency.cycles = strtol(spec, &end, 0);
+	return end != spec && !*end && latency.cycles >= 0;
+}
+
+bool parse_dram_config(const char *spec, dram_config &config) {
+	std::istringstream fields(spec);
+	std::string field;
+	unsigned long numbers[5];
+
+	config.page_policy = DramTiming::openPage;
+
+	//the banks, row size and timings must be given
+	for(unsigned long &number : numbers) {
+		char *end;
+
+		if(!std::getline(fields, field, ':') || field.empty()) {
+			return false;
+		}
+		number = strtoul(field.c_str(), &end, 0);
+		if(*end) {
+			return false;
+		}
+	}
+	config.banks = numbers[0];
+	config.row_size = numbers[1];
+	config.t_rcd = numbers[2];
+	config.t_cas = numbers[3];
+	config.t_rp = numbers[4];
+
+	//the policy may be left out
+	if(std::getline(fields, field, ':')) {
+		if(field == "closed") {
+			config.page_policy = DramTiming::closedPage;
+		}
+		else if(field != "open") {
+			return false;
+		}
+	}
+
+	return !std::getline(fields, field, ':');
+}
+
+bool parse_prefetcher_config(const char *spec, prefetcher_config &config) {
+	std::istringstream fields(spec);
+	std::string field;
+	unsigned long numbers[3] = {0, 0, 64};
+	int given = 0;
+
+	//the degree and distance must be given, but the entries may be left out
+	for(unsigned long &number : numbers) {
+		char *end;
+
+		if(!std::getline(fields, field, ':')) {
+			break;
+		}
+		number = strtoul(field.c_str(), &end, 0);
+		if(field.empty() || *end || !number) {
+			return false;
+		}
+		given++;
+	}
+	config.degree = numbers[0];
+	config.distance = numbers[1];
+	config.entries = numbers[2];
+
+	return (given >= 2) && !std::getline(fields, field, ':');
+}
+
+int parse_machine_option(int argc, const char *const argv[], int arg,
+	machine_options &options, std::ostream &errors) {
+	const char *option = argv[arg];
+
+	//the options that take no value
+	if(!strcmp(option, "-c")) {
+		options.cpi = true;
+		return 1;
+	}
+	else if(!strcmp(option, "-P")) {
+		options.profile = true;
+		return 1;
+	}
+
+	//the rest take one
+	if((option[0] != '-') || !option[1] || option[2] ||
+		!strchr("abIDFLMN", option[1])) {
+		return 0;
+	}
+	if(arg + 1 >= argc) {
+		errors << "Missing value for " << option << std::endl;
+		return -1;
+	}
+	const char *value = argv[arg + 1];
+
+	switch(option[1]) {
+		case 'a':
+			options.assembly_file = value;
+			break;
+		case 'b':
+			if(!make_direction_predictor(value)) {
+				errors << "Unknown branch predictor: " <<
+					value << std::endl;
+				return -1;
+			}
+			options.predictor = value;
+			break;
+		case 'I':
+		case 'D':
+			if(!parse_cache_config(value, (option[1] == 'D') ?
+				options.data_cache :
+				options.instruction_cache)) {
+				errors << "Bad cache: " << value << std::endl;
+				return -1;
+			}
+			((option[1] == 'D') ? options.use_data_cache :
+				options.use_instruction_cache) = true;
+			break;
+		case 'F':
+			if(!parse_prefetcher_config(value,
+				options.prefetcher)) {
+				errors << "Bad prefetcher: " << value <<
+					std::endl;
+				return -1;
+			}
+			options.use_prefetcher = true;
+			break;
+		case 'L': {
+			memory_latency latency;
+
+			if(!parse_memory_latency(value, latency)) {
+				errors << "Bad latency: " << value << std::endl;
+				return -1;
+			}
+			options.latencies.push_back(latency);
+			break;
+		}
+		case 'M':
+			if(!parse_dram_config(value, options.dram)) {
+				errors << "Bad DRAM: " << value << std::endl;
+				return -1;
+			}
+			options.use_dram = true;
+			break;
+		case 'N': {
+			char *end;
+			unsigned long mshrs = strtoul(value, &end, 0);
+
+			if(!*value || *end || !mshrs || (mshrs > MAX_MSHRS)) {
+				errors << "Bad MSHR count: " << value <<
+					std::endl;
+				return -1;
+			}
+			options.mshrs = mshrs;
+			break;
+		}
+	}
+
+	return 2;
+}
+
+bool machine_options_consistent(const machine_options &options) {
+	//a prefetcher needs a data cache to prefetch into
+	return !options.use_prefetcher || options.use_data_cache;
+}
+
+bool machine_options_checkpointed(const machine_options &options) {
+	return options.predictor.empty() && !options.mshrs &&
+		!options.use_prefetcher;
+}
+
+void configure_machine(z88_cpu &machine, const machine_options &options) {
+	if(!options.predictor.empty()) {
+		(void)machine.use_branch_predictor(options.predictor.c_str());
+	}
+	if(options.mshrs) {
+		machine.use_non_blocking_loads(options.mshrs);
+	}
+	if(options.cpi) {
+		machine.count_cycles_by_address();
+	}
+
+	//the caches are made (and their makeup checked) here
+	if(options.use_instruction_cache) {
+		machine.add_instruction_cache(options.instruction_cache);
+	}
+	if(options.use_data_cache) {
+		machine.add_data_cache(options.data_cache);
+	}
+	if(options.use_prefetcher) {
+		machine.use_prefetcher(options.prefetcher);
+	}
+	for(const memory_latency &latency : options.latencies) {
+		machine.add_memory_latency(latency);
+	}
+	if(options.use_dram) {
+		machine.add_dram(options.dram);
+	}
+}
+
+void read_symbols(const char *object_file, const std::string &assembly_file,
+	symbol_table &symbols, std::ostream &errors) {
+	//the labels given, or the image's own, or its source's
+	if(!assembly_file.empty()) {
+		if(!symbols.read_assembly(assembly_file.c_str())) {
+			errors << "Could not read " << assembly_file <<
+				std::endl;
+		}
+	}
+	else {
+		symbols.read_image(ProgramImage(object_file));
+		if(symbols.empty()) {
+			std::string source(object_file);
+			std::string::size_type dot = source.rfind('.');
+
+			source = source.substr(0, dot) + ".asm";
+			symbols.read_assembly(source.c_str());
+		}
+	}
+}
+
+void print_machine_reports(const z88_cpu &machine,
+	const machine_options &options, const char *object_file,
+	std::ostream &report) {
+	if(options.cpi || options.profile) {
+		symbol_table symbols;
+
+		read_symbols(object_file, options.assembly_file, symbols,
+			report);
+		if(options.cpi) {
+			machine.print_cpi_stack(report, symbols);
+		}
+		if(options.profile) {
+			machine.print_profile(report, symbols);
+		}
+	}
+
+	machine.print_branch_predictor_report(report);
+	machine.print_memory_report(report);
+}
@@ -0,0 +1,175 @@
+/**
+ * Header file for "options" module that reads the options making up a z88's
+ * branch predictor, memory system and end-of-program reports, builds them
+ * into a z88 and prints its reports. The z88 takes them on its command line,
+ * and the regression runner from a test's .opts file.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+#ifndef _OPTIONS_H_
+#define _OPTIONS_H_
+
+//C++ includes
+#include <iostream>
+#include <string>
+#include <vector>
+
+//local project includes
+#include "components.h"
+#include "prefetcher.h"
+#include "run_program.h"
+
+//the most miss-status holding registers a z88 may be given
+const unsigned int MAX_MSHRS = 64;
+
+/**
+ * The makeup of a z88 beyond its bare pipeline, and the reports it prints
+ * at the end of a program, as read from its options.
+ */
+struct machine_options {
+	/**
+	 * Start out with the bare pipeline and no reports.
+	 */
+	machine_options(void);
+
+	//the branch predictor, or empty for none
+	std::string predictor;
+	//the caches
+	cache_config instruction_cache;
+	cache_config data_cache;
+	bool use_instruction_cache;
+	bool use_data_cache;
+	//the prefetcher, which needs a data cache
+	prefetcher_config prefetcher;
+	bool use_prefetcher;
+	//the memories' latencies, and the DRAM behind them
+	std::vector<memory_latency> latencies;
+	dram_config dram;
+	bool use_dram;
+	//miss-status holding registers, or 0 for blocking loads
+	unsigned int mshrs;
+	/* whether to print the CPI stack and the execution profile, and
+		the assembly source to name addresses in them with */
+	bool cpi;
+	bool profile;
+	std::string assembly_file;
+};
+
+/**
+ * Read the makeup of a cache from the command line: its size, line size
+ * and associativity, and then, optionally, its replacement policy, write
+ * policy and miss penalty, separated by colons (eg: "4096:16:2:plru:wt:20").
+ *
+ * @param spec The cache, as given on the command line.
+ * @param config Filled in with the cache's makeup.
+ * @returns False if the cache is not given properly, true otherwise.
+ */
+bool parse_cache_config(const char *spec, cache_config &config);
+
+/**
+ * Read a memory latency from the command line: the extra cycles an access
+ * takes, either everywhere or, given as "first-last:cycles", in a range of
+ * addresses (eg: "0x8000-0xffff:20").
+ *
+ * @param spec The latency, as given on the command line.
+ * @param latency Filled in with the latency and its range.
+ * @returns False if the latency is not given properly, true otherwise.
+ */
+bool parse_memory_latency(const char *spec, memory_latency &latency);
+
+/**
+ * Read the makeup of a banked DRAM from the command line: its banks, row
+ * size, tRCD, tCAS and tRP, and then, optionally, its page policy,
+ * separated by colons (eg: "8:1024:3:3:3:closed").
+ *
+ * @param spec The DRAM, as given on the command line.
+ * @param config Filled in with the DRAM's makeup.
+ * @returns False if the DRAM is not given properly, true otherwise.
+ */
+bool parse_dram_config(const char *spec, dram_config &config);
+
+/**
+ * Read the makeup of a stride prefetcher from the command line: its degree
+ * and distance, and then, optionally, the entries in its reference
+ * prediction table, separated by colons (eg: "2:4:128").
+ *
+ * @param spec The prefetcher, as given on the command line.
+ * @param config Filled in with the prefetcher's makeup.
+ * @returns False if the prefetcher is not given properly, true otherwise.
+ */
+bool parse_prefetcher_config(const char *spec, prefetcher_config &config);
+
+/**
+ * Read one of the options making up a z88 (-b, -I, -D, -F, -L, -M, -N, -c,
+ * -P or -a) and the value it takes, if any.
+ *
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @param arg The index of the option to read.
+ * @param options Has the option added to it.
+ * @param errors Where to say what is wrong with an option given badly.
+ * @returns The number of arguments the option took up, 0 if argv[arg] is not
+ *	one of these options, or -1 if it was given badly.
+ */
+int parse_machine_option(int argc, const char *const argv[], int arg,
+	machine_options &options, std::ostream &errors);
+
+/**
+ * Determine whether options read separately make sense together.
+ *
+ * @param options The options read.
+ * @returns False if a prefetcher was given without a data cache, true
+ *	otherwise.
+ */
+bool machine_options_consistent(const machine_options &options);
+
+/**
+ * Determine whether a checkpoint holds all of the state of a z88 built from
+ * its options. Those of its caches and memories do; the branch predictor's
+ * tables, the outstanding loads in the MSHRs and the registers they will
+ * write, and the prefetcher's table and prefetches on their way don't.
+ *
+ * @param options The options read.
+ * @returns False if a branch predictor, MSHRs or a prefetcher were given,
+ *	true otherwise.
+ */
+bool machine_options_checkpointed(const machine_options &options);
+
+/**
+ * Build a z88's branch predictor and memory system from its options, once
+ * its components are connected.
+ *
+ * @param machine The z88.
+ * @param options Its makeup.
+ */
+void configure_machine(z88_cpu &machine, const machine_options &options);
+
+/**
+ * Read the labels to name a program's addresses with in its CPI stack and
+ * execution profile.
+ *
+ * @param object_file The program's object file or image.
+ * @param assembly_file The program's assembly source, or empty to use the
+ *	image's symbols, or those of the .asm file beside the object file.
+ * @param symbols Has the program's labels added to it.
+ * @param errors Where to say that the assembly source couldn't be read.
+ */
+void read_symbols(const char *object_file, const std::string &assembly_file,
+	symbol_table &symbols, std::ostream &errors);
+
+/**
+ * Print the reports a z88 was asked for at the end of a program: the CPI
+ * stack and execution profile, if they were, and then those of its branch
+ * predictor and memory system.
+ *
+ * @param machine The z88 that ran the program.
+ * @param options What it was asked for.
+ * @param object_file The program's object file or image.
+ * @param report Where to print the reports.
+ */
+void print_machine_reports(const z88_cpu &machine,
+	const machine_options &options, const char *object_file,
+	std::ostream &report);
+
+#endif // _OPTIONS_H_
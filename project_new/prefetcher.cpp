@@ -0,0 +1,153 @@
+/**
+ * Source file for "prefetcher" module that watches the addresses the z88's
+ * loads and stores are made at, and prefetches the lines they are about to
+ * use into its data cache.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+//C++ includes
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+//local project includes
+#include "prefetcher.h"
+#include "report.h"
+
+
+/***********************************
+ * Function implementations        *
+ ***********************************/
+
+stride_prefetcher::stride_prefetcher(const prefetcher_config &config) :
+	table(config.entries, rpt_entry{false, 0, 0, 0, INITIAL}),
+	degree(config.degree),
+	distance(config.distance),
+	outstanding(),
+	accesses(0),
+	steady_accesses(0),
+	predicted(0),
+	prefetched(0),
+	late(0),
+	late_cycles(0)
+{}
+
+void stride_prefetcher::observe(uint32_t pc, uint32_t address,
+	std::vector<uint32_t> &prefetches) {
+	rpt_entry &entry = table[(pc >> 2) % table.size()];
+
+	accesses++;
+
+	//an instruction not in the table starts out with no stride
+	if(!entry.valid || (entry.pc != pc)) {
+		entry = rpt_entry{true, pc, address, 0, INITIAL};
+		return;
+	}
+
+	/* a stride seen twice running makes the entry steady, and a
+		steady entry keeps its stride through a single break in
+		it; otherwise the new stride is taken on trial */
+	int32_t stride = int32_t(address - entry.last_address);
+	if(stride == entry.stride) {
+		entry.state = (entry.state == NO_PREDICTION) ? TRANSIENT :
+			STEADY;
+	}
+	else {
+		switch(entry.state) {
+			case INITIAL:
+				entry.state = TRANSIENT;
+				break;
+			case STEADY:
+				entry.state = INITIAL;
+				break;
+			default:
+				entry.state = NO_PREDICTION;
+				break;
+		}
+		if(entry.state != INITIAL) {
+			entry.stride = stride;
+		}
+	}
+	entry.last_address = address;
+
+	//only continue if there is a stride to follow
+	if((entry.state != STEADY) || !entry.stride) {
+		return;
+	}
+
+	steady_accesses++;
+	for(unsigned int i = 0; i < degree; ++i) {
+		prefetches.push_back(address +
+			uint32_t(entry.stride) * (distance + i));
+	}
+	predicted += degree;
+}
+
+void stride_prefetcher::issued(uint32_t line, unsigned long cycle,
+	unsigned long ready) {
+	//prefetches that have arrived are no longer waited for
+	outstanding.erase(std::remove_if(outstanding.begin(),
+		outstanding.end(), [cycle](const in_flight &prefetch) {
+			return prefetch.ready <= cycle;
+		}), outstanding.end());
+
+	outstanding.push_back(in_flight{line, ready, false});
+	prefetched++;
+}
+
+unsigned long stride_prefetcher::arrival(uint32_t line, unsigned long cycle) {
+	for(in_flight &prefetch : outstanding) {
+		if((prefetch.line == line) && (prefetch.ready > cycle)) {
+			if(!prefetch.late) {
+				prefetch.late = true;
+				late++;
+				late_cycles += prefetch.ready - cycle;
+			}
+			return prefetch.ready;
+		}
+	}
+
+	return 0;
+}
+
+void stride_prefetcher::forget_in_flight(void) {
+	outstanding.clear();
+}
+
+void stride_prefetcher::print_report(std::ostream &out,
+	const Cache &cache) const {
+	std::ios_base::fmtflags old = out.flags();
+	std::streamsize old_precision = out.precision();
+	unsigned long used = cache.usefulPrefetches();
+	unsigned long misses = cache.readMisses() + cache.writeMisses();
+
+	out << std::dec << "Stride prefetcher: " << table.size() <<
+		"-entry RPT, degree " << degree << ", distance " << distance <<
+		std::endl;
+
+	out << "  accesses " << accesses << ", with a steady stride ";
+	print_percentage(out, steady_accesses, accesses);
+	out << std::endl << "  prefetches " << prefetched << " (of " <<
+		predicted << " addresses predicted, the rest already cached)" <<
+		std::endl;
+
+	/* accuracy is the prefetches used, coverage the misses they
+		removed of those there would have been, and timeliness the
+		used ones that arrived before they were wanted */
+	out << "  accuracy ";
+	print_percentage(out, used, prefetched);
+	out << " used, " << cache.unusedPrefetches() <<
+		" evicted unused" << std::endl;
+	out << "  coverage ";
+	print_percentage(out, used, used + misses);
+	out << " misses removed, " << misses << " left" << std::endl;
+	out << "  timeliness ";
+	print_percentage(out, (used > late) ? (used - late) : 0, used);
+	out << " in time, " << late << " late by " << late_cycles <<
+		" cycles" << std::endl;
+
+	(void)out.flags(old);
+	(void)out.precision(old_precision);
+}
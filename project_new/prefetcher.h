@@ -0,0 +1,149 @@
+/**
+ * Header file for "prefetcher" module that watches the addresses the z88's
+ * loads and stores are made at, and prefetches the lines they are about to
+ * use into its data cache.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+#ifndef _PREFETCHER_H_
+#define _PREFETCHER_H_
+
+//C++ includes
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+//arch library includes
+#include <Cache.h>
+
+/**
+ * The makeup of a stride prefetcher.
+ */
+struct prefetcher_config {
+	/* the lines prefetched for each access, and how many strides
+		ahead of it the first of them is */
+	unsigned int degree;
+	unsigned int distance;
+	//entries in the reference prediction table
+	unsigned int entries;
+};
+
+/**
+ * A stride prefetcher: a reference prediction table (RPT), indexed by the
+ * address of the load or store, that learns the stride between the
+ * addresses each one is made at. Once an instruction has been seen to
+ * repeat its stride, each of its accesses predicts the addresses 'distance'
+ * to 'distance + degree - 1' strides ahead, for the pipeline to prefetch.
+ * Also keeps track of the prefetches still on their way, and the counts the
+ * pipeline reports at the end of a program.
+ */
+class stride_prefetcher {
+	public:
+		/**
+		 * Build a stride prefetcher.
+		 *
+		 * @param config Its degree, distance and table size.
+		 */
+		stride_prefetcher(const prefetcher_config &config);
+
+		/**
+		 * Learn the stride of a load or store from the address it is
+		 * made at, and predict the addresses to prefetch if its
+		 * stride is steady.
+		 *
+		 * @param pc The address of the load or store.
+		 * @param address The address it is made at.
+		 * @param prefetches Has the addresses to prefetch added to it.
+		 */
+		void observe(uint32_t pc, uint32_t address,
+			std::vector<uint32_t> &prefetches);
+
+		/**
+		 * Note a prefetch that loaded a line, and when it arrives.
+		 *
+		 * @param line The line prefetched.
+		 * @param cycle The cycle it was prefetched in.
+		 * @param ready The first cycle in which an access can use it.
+		 */
+		void issued(uint32_t line, unsigned long cycle,
+			unsigned long ready);
+
+		/**
+		 * Find out whether an access has to wait for a prefetch of its
+		 * line that is still on its way, counting the prefetch late
+		 * the first time one does.
+		 *
+		 * @param line The line accessed.
+		 * @param cycle The cycle the access is made in.
+		 * @returns The cycle the line can be used from, or 0 if the
+		 *	access needn't wait for it.
+		 */
+		unsigned long arrival(uint32_t line, unsigned long cycle);
+
+		/**
+		 * Forget the prefetches on their way, as when the pipeline is
+		 * emptied. The table is kept.
+		 */
+		void forget_in_flight(void);
+
+		/**
+		 * Print how many prefetches were made, and how accurate,
+		 * timely and complete (in misses removed) they were.
+		 *
+		 * @param out Where to print the report.
+		 * @param cache The cache prefetched into, which counts the
+		 *	prefetched lines used and its remaining misses.
+		 */
+		void print_report(std::ostream &out, const Cache &cache) const;
+
+	private:
+		//how far an RPT entry trusts its stride
+		enum rpt_state {
+			INITIAL,
+			TRANSIENT,
+			STEADY,
+			NO_PREDICTION
+		};
+
+		/* an entry of the RPT: the load or store it is for, the
+			address it was last made at, the stride it is
+			following, and how far it trusts it */
+		struct rpt_entry {
+			bool valid;
+			uint32_t pc;
+			uint32_t last_address;
+			int32_t stride;
+			rpt_state state;
+		};
+
+		/* a prefetch on its way: the line, the cycle from which it
+			can be used, and whether an access has waited for it */
+		struct in_flight {
+			uint32_t line;
+			unsigned long ready;
+			bool late;
+		};
+
+		//the RPT, indexed by load or store address
+		std::vector<rpt_entry> table;
+
+		unsigned int degree;
+		unsigned int distance;
+
+		//prefetches still on their way
+		std::vector<in_flight> outstanding;
+
+		/* accesses seen, and those with a steady stride; addresses
+			predicted, and prefetches that loaded a line; and
+			prefetches an access waited for, and the cycles it
+			waited */
+		unsigned long accesses;
+		unsigned long steady_accesses;
+		unsigned long predicted;
+		unsigned long prefetched;
+		unsigned long late;
+		unsigned long late_cycles;
+};
+
+#endif // _PREFETCHER_H_
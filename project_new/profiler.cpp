@@ -0,0 +1,459 @@
+/**
+ * Source file for "profiler" module that counts, as the z88's instructions
+ * retire, how often each was executed and how many cycles each cost, and
+ * reports them by instruction, basic block and function, named with the
+ * program's labels.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+//C++ includes
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+
+//arch library includes
+#include <ProgramImage.h>
+
+//local project includes
+#include "profiler.h"
+#include "instruction_decode.h"
+
+//the instructions that have a delay slot and end a basic block after it
+static const unsigned int CONTROL = z11::BRANCH | z11::JUMP;
+
+
+/***********************************
+ * Symbol table                    *
+ ***********************************/
+
+void symbol_table::add(const std::string &name, uint32_t address) {
+	labels.emplace(address, name);
+}
+
+bool symbol_table::read_assembly(const char *file_name) {
+	std::ifstream source(file_name);
+	std::string line;
+	//where the next word assembled goes
+	uint32_t location = 0;
+	//labels waiting for the statement they label
+	std::vector<std::string> pending;
+
+	if(!source) {
+		return false;
+	}
+
+	while(std::getline(source, line)) {
+		//comments run from ';' to the end of the line
+		line = line.substr(0, line.find(';'));
+
+		//a label ends with ':', and may share its line with a statement
+		std::string::size_type colon = line.find(':');
+		if(colon != std::string::npos) {
+			std::istringstream label(line.substr(0, colon));
+			std::string name;
+			if(label >> name) {
+				pending.push_back(name);
+			}
+			line = line.substr(colon + 1);
+		}
+
+		std::istringstream statement(line);
+		std::string word;
+		if(!(statement >> word)) {
+			continue;
+		}
+
+		if(word == ".org") {
+			std::string address;
+			statement >> address;
+			location = strtoul(address.c_str(), nullptr, 0);
+		}
+		//data takes a word per value, and its labels are left out
+		else if(word == ".word") {
+			pending.clear();
+			location += 4;
+			for(char c : line) {
+				location += ((c == ',') ? 4 : 0);
+			}
+		}
+		//any other directive assembles nothing
+		else if(word[0] != '.') {
+			for(const std::string &name : pending) {
+				add(name, location);
+			}
+			pending.clear();
+			location += 4;
+		}
+	}
+
+	return true;
+}
+
+void symbol_table::read_image(const ProgramImage &image) {
+	for(int i = 0; i < image.numSymbols(); ++i) {
+		add(image.symbol(i).name, image.symbol(i).value);
+	}
+}
+
+bool symbol_table::empty(void) const {
+	return labels.empty();
+}
+
+std::string symbol_table::locate(uint32_t address) const {
+	std::ostringstream name;
+
+	auto label = labels.upper_bound(address);
+	if(label == labels.begin()) {
+		name << std::hex << std::setfill('0') << std::setw(8) <<
+			address;
+		return name.str();
+	}
+
+	--label;
+	name << label->second;
+	if(label->first != address) {
+		name << "+0x" << std::hex << (address - label->first);
+	}
+
+	return name.str();
+}
+
+
+/***********************************
+ * Execution profile               *
+ ***********************************/
+
+execution_profile::execution_profile(void) :
+	pages(),
+	last_page_number(0),
+	last_page(nullptr),
+	cycles(0),
+	instructions(0),
+	older(nullptr),
+	older_pc(0),
+	newer(nullptr),
+	newer_pc(0),
+	call_stack(),
+	functions(),
+	edges()
+{}
+
+execution_profile::pc_counts &execution_profile::counts(uint32_t pc) {
+	uint32_t page_number = pc >> (PAGE_BITS + 2);
+
+	if(!last_page || (page_number != last_page_number)) {
+		std::vector<pc_counts> &page = pages[page_number];
+		if(page.empty()) {
+			page.resize(1 << PAGE_BITS, pc_counts{0, 0, 0, 0,
+				z11::UNKNOWN, 0, 0, false});
+		}
+
+		last_page_number = page_number;
+		last_page = page.data();
+	}
+
+	pc_counts &entry = last_page[(pc >> 2) & ((1 << PAGE_BITS) - 1)];
+	entry.pc = pc;
+	return entry;
+}
+
+void execution_profile::retire(uint32_t pc, const micro_op &uop) {
+	pc_counts &retired = counts(pc);
+
+	retired.executions++;
+	retired.operation = uop.operation;
+	retired.classes = uop.classes;
+	retired.rs = uop.rs;
+
+	//the first instruction starts the program's outermost function
+	if(!instructions) {
+		retired.leader = true;
+		functions[pc];
+		call_stack.push_back({pc, cycles});
+	}
+	/* the instruction after a branch's or jump's delay slot is where it
+		went: where a basic block starts */
+	else if(!newer) {
+		retired.leader = true;
+	}
+	else if(older && (older->classes & CONTROL)) {
+		retired.leader = true;
+
+		if(older->classes & z11::BRANCH) {
+			if(pc != older_pc + 8) {
+				older->taken++;
+			}
+		}
+		else {
+			follow_call(*older, pc);
+		}
+	}
+
+	instructions++;
+	older = newer;
+	older_pc = newer_pc;
+	newer = &retired;
+	newer_pc = pc;
+}
+
+void execution_profile::charge(uint32_t pc) {
+	counts(pc).cycles++;
+	cycles++;
+}
+
+void execution_profile::break_flow(void) {
+	older = nullptr;
+	newer = nullptr;
+
+	//the outermost function is still running
+	if(!call_stack.empty()) {
+		call_stack.resize(1);
+	}
+}
+
+void execution_profile::follow_call(const pc_counts &caller,
+	uint32_t target) {
+	//a return (JR r31) finishes the innermost call, if there is one
+	if((caller.operation == z11::JR) && (caller.rs == 31)) {
+		if(call_stack.size() > 1) {
+			return_from_call();
+		}
+		return;
+	}
+
+	//only continue for a call (JAL or JALR)
+	if((caller.operation != z11::JAL) && (caller.operation != z11::JALR)) {
+		return;
+	}
+
+	edges[{call_stack.back().function, target}].calls++;
+	functions[target].calls++;
+	call_stack.push_back({target, cycles});
+}
+
+void execution_profile::return_from_call(void) {
+	call_frame frame = call_stack.back();
+	unsigned long spent = cycles - frame.entered;
+
+	call_stack.pop_back();
+	edges[{call_stack.back().function, frame.function}].cycles += spent;
+
+	/* a recursive call's cycles are already counted by the outer call to
+		the same function */
+	for(const call_frame &outer : call_stack) {
+		if(outer.function == frame.function) {
+			return;
+		}
+	}
+	functions[frame.function].cycles += spent;
+}
+
+std::vector<execution_profile::basic_block>
+	execution_profile::find_basic_blocks(void) const {
+	std::vector<basic_block> blocks;
+	std::vector<uint32_t> page_numbers;
+	//where the current block would continue, and whether it ends here
+	uint32_t expected = 0;
+	bool ended = true;
+	bool delay_slot_next = false;
+
+	for(const auto &page : pages) {
+		page_numbers.push_back(page.first);
+	}
+	std::sort(page_numbers.begin(), page_numbers.end());
+
+	for(uint32_t page_number : page_numbers) {
+		const std::vector<pc_counts> &page = pages.at(page_number);
+
+		for(const pc_counts &instruction : page) {
+			uint32_t pc = instruction.pc;
+
+			if(!instruction.executions) {
+				continue;
+			}
+
+			if(instruction.leader || ended || (pc != expected)) {
+				blocks.push_back({pc, pc,
+					instruction.executions, 0});
+			}
+			blocks.back().end = pc;
+			blocks.back().cycles += instruction.cycles;
+
+			//a block ends after a branch's or jump's delay slot
+			expected = pc + 4;
+			ended = delay_slot_next;
+			delay_slot_next = (instruction.classes & CONTROL);
+		}
+	}
+
+	return blocks;
+}
+
+uint32_t execution_profile::function_of(uint32_t pc) const {
+	auto function = functions.upper_bound(pc);
+
+	//before the first function is charged to the first function
+	if(function == functions.begin()) {
+		return (functions.empty() ? pc : function->first);
+	}
+
+	return (--function)->first;
+}
+
+/**
+ * Print a count of cycles and the percentage of all cycles it is.
+ *
+ * @param out Where to print them.
+ * @param part The cycles.
+ * @param whole All cycles.
+ */
+static void print_cycles(std::ostream &out, unsigned long part,
+	unsigned long whole) {
+	out << std::setw(12) << part << std::setw(7) << std::setprecision(1) <<
+		(whole ? (100.0 * part / whole) : 0.0) << "%";
+}
+
+void execution_profile::print_report(std::ostream &out,
+	const symbol_table &symbols, unsigned int top) const {
+	std::ios_base::fmtflags old = out.flags();
+	std::streamsize old_precision = out.precision();
+	char old_fill = out.fill();
+
+	out << std::dec << std::setfill(' ') << std::fixed << std::endl <<
+		"Profile: " << instructions << " instructions retired in " <<
+		cycles << " cycles" << std::endl;
+
+	//the hottest basic blocks
+	std::vector<basic_block> blocks = find_basic_blocks();
+	std::stable_sort(blocks.begin(), blocks.end(),
+		[](const basic_block &a, const basic_block &b) {
+			return (a.cycles > b.cycles);
+		});
+	if(blocks.size() > top) {
+		blocks.resize(top);
+	}
+
+	out << std::endl << "Hottest basic blocks:" << std::endl <<
+		std::setw(12) << "Cycles" << std::setw(8) << "%" <<
+		std::setw(12) << "Executions" << std::setw(8) << "Instrs" <<
+		std::setw(9) << "CPI" << "  Block" << std::endl;
+	for(const basic_block &block : blocks) {
+		unsigned long length = (block.end - block.start) / 4 + 1;
+
+		print_cycles(out, block.cycles, cycles);
+		out << std::setw(12) << block.executions << std::setw(8) <<
+			length << std::setw(9) << std::setprecision(4) <<
+			(block.executions ? (double)block.cycles /
+			(block.executions * length) : 0.0) << "  " <<
+			symbols.locate(block.start) << " .. " <<
+			symbols.locate(block.end) << std::endl;
+	}
+
+	//the hottest instructions, and how often the branches were taken
+	std::vector<const pc_counts *> hottest;
+	for(const auto &page : pages) {
+		for(const pc_counts &instruction : page.second) {
+			if(instruction.cycles) {
+				hottest.push_back(&instruction);
+			}
+		}
+	}
+	std::sort(hottest.begin(), hottest.end(),
+		[](const pc_counts *a, const pc_counts *b) {
+			return (a->cycles != b->cycles) ?
+				(a->cycles > b->cycles) : (a->pc < b->pc);
+		});
+	if(hottest.size() > top) {
+		hottest.resize(top);
+	}
+
+	out << std::endl << "Hottest instructions:" << std::endl <<
+		std::setw(12) << "Cycles" << std::setw(8) << "%" <<
+		std::setw(12) << "Executions" << std::setw(9) << "CPI" <<
+		"  Address   Instr   " << std::setw(15) << "Taken" <<
+		"  Location" << std::endl;
+	for(const pc_counts *hot : hottest) {
+		const pc_counts &instruction = *hot;
+		std::ostringstream taken;
+
+		if(instruction.classes & z11::BRANCH) {
+			taken << instruction.taken << " (" << std::fixed <<
+				std::setprecision(1) <<
+				(instruction.executions ? (100.0 *
+				instruction.taken / instruction.executions) :
+				0.0) << "%)";
+		}
+		else {
+			taken << "-";
+		}
+
+		print_cycles(out, instruction.cycles, cycles);
+		out << std::setw(12) << instruction.executions <<
+			std::setw(9) << std::setprecision(4) <<
+			(instruction.executions ? (double)instruction.cycles /
+			instruction.executions : 0.0) << "  " << std::hex <<
+			std::setfill('0') << std::setw(8) << instruction.pc <<
+			std::dec << std::setfill(' ') << "  " << std::left <<
+			std::setw(8) << z11::mnemonics[instruction.operation] <<
+			std::right << std::setw(15) << taken.str() << "  " <<
+			symbols.locate(instruction.pc) << std::endl;
+	}
+
+	//the functions, with their self and inclusive cycles, and callees
+	std::map<uint32_t, unsigned long> self;
+	for(const auto &page : pages) {
+		for(const pc_counts &instruction : page.second) {
+			if(instruction.cycles) {
+				self[function_of(instruction.pc)] +=
+					instruction.cycles;
+			}
+		}
+	}
+
+	//calls still in progress count up to now
+	std::map<uint32_t, call_edge> inclusive = functions;
+	for(unsigned int i = 0; i < call_stack.size(); ++i) {
+		bool recursive = false;
+		for(unsigned int j = 0; j < i; ++j) {
+			recursive |= (call_stack[j].function ==
+				call_stack[i].function);
+		}
+		if(!recursive) {
+			inclusive[call_stack[i].function].cycles += cycles -
+				call_stack[i].entered;
+		}
+	}
+
+	out << std::endl << "Call graph:" << std::endl <<
+		std::setw(12) << "Inclusive" << std::setw(8) << "%" <<
+		std::setw(12) << "Self" << std::setw(8) << "%" <<
+		std::setw(10) << "Calls" << "  Function" << std::endl;
+	for(const auto &function : inclusive) {
+		print_cycles(out, function.second.cycles, cycles);
+		print_cycles(out, self[function.first], cycles);
+		out << std::setw(10) << function.second.calls << "  " <<
+			symbols.locate(function.first) << std::endl;
+
+		for(const auto &edge : edges) {
+			if(edge.first.first == function.first) {
+				out << std::setw(50) << edge.second.calls <<
+					"    calls " <<
+					symbols.locate(edge.first.second) <<
+					" (" << edge.second.cycles <<
+					" cycles)" << std::endl;
+			}
+		}
+	}
+
+	(void)out.flags(old);
+	(void)out.precision(old_precision);
+	(void)out.fill(old_fill);
+}
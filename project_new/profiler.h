@@ -0,0 +1,241 @@
+/**
+ * Header file for "profiler" module that counts, as the z88's instructions
+ * retire, how often each was executed and how many cycles each cost, and
+ * reports them by instruction, basic block and function, named with the
+ * program's labels.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+//C++ includes
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+
+//local project includes
+#include "instruction_decode.h"
+
+class ProgramImage;
+
+/**
+ * The labels of a program, by address, for naming the places a profile
+ * refers to.
+ */
+class symbol_table {
+	public:
+		/**
+		 * Add a label.
+		 *
+		 * @param name The label.
+		 * @param address The address it labels.
+		 */
+		void add(const std::string &name, uint32_t address);
+
+		/**
+		 * Add the labels of the instructions in an assembly source
+		 * file, working out their addresses from its '.org'
+		 * directives. Labels of '.word' data are left out.
+		 *
+		 * @param file_name The assembly source file.
+		 * @returns False if the file could not be read, true
+		 *	otherwise.
+		 */
+		bool read_assembly(const char *file_name);
+
+		/**
+		 * Add the symbols of a program image, if it has any.
+		 *
+		 * @param image The program image.
+		 */
+		void read_image(const ProgramImage &image);
+
+		/**
+		 * Determine whether there are any labels.
+		 *
+		 * @returns True if there are none.
+		 */
+		bool empty(void) const;
+
+		/**
+		 * Name an address by the nearest label at or before it: the
+		 * label itself, or "label+offset".
+		 *
+		 * @param address The address.
+		 * @returns The name, or the address in hex if no label comes
+		 *	before it.
+		 */
+		std::string locate(uint32_t address) const;
+
+	private:
+		//the labels, by address (the first given for an address)
+		std::map<uint32_t, std::string> labels;
+};
+
+/**
+ * Execution counts and cycles for every instruction address a program
+ * retires from, collected cheaply enough to be left on. Branch outcomes,
+ * basic blocks, and calls and returns are worked out from the order the
+ * instructions retire in, so the profile needs nothing from the pipeline
+ * but the retirements and who each cycle is charged to.
+ */
+class execution_profile {
+	public:
+		/**
+		 * Build an empty profile.
+		 */
+		execution_profile(void);
+
+		/**
+		 * Count an instruction retiring.
+		 *
+		 * @param pc Its address.
+		 * @param uop The instruction.
+		 */
+		void retire(uint32_t pc, const micro_op &uop);
+
+		/**
+		 * Charge a cycle to an instruction: the one that retired in
+		 * it, or the one it was lost to.
+		 *
+		 * @param pc The address of the instruction.
+		 */
+		void charge(uint32_t pc);
+
+		/**
+		 * Forget which instructions retired last and which calls are
+		 * in progress, as the next instruction to retire doesn't
+		 * follow them (eg: after executing functionally).
+		 */
+		void break_flow(void);
+
+		/**
+		 * Print the profile: the basic blocks and instructions that
+		 * took the most cycles, with the branches' taken counts, and
+		 * the call graph.
+		 *
+		 * @param out Where to print the report.
+		 * @param symbols The program's labels.
+		 * @param top The most blocks and instructions to list.
+		 */
+		void print_report(std::ostream &out, const symbol_table &symbols,
+			unsigned int top = 20) const;
+
+	private:
+		//the counts for one instruction address
+		struct pc_counts {
+			//the address (which needn't be word aligned)
+			uint32_t pc;
+			//times it retired, and cycles charged to it
+			unsigned long executions;
+			unsigned long cycles;
+			//for a branch, the times it was taken
+			unsigned long taken;
+			//the instruction, as it last retired
+			z11::op operation;
+			unsigned int classes;
+			unsigned int rs;
+			/* whether it retired right after a branch's or jump's
+				delay slot, or first, so starts a basic block */
+			bool leader;
+		};
+
+		//a basic block found in the profile
+		struct basic_block {
+			uint32_t start;
+			uint32_t end;
+			unsigned long executions;
+			unsigned long cycles;
+		};
+
+		//the calls from one function to another
+		struct call_edge {
+			unsigned long calls;
+			unsigned long cycles;
+		};
+
+		//a call in progress: the function called, and when
+		struct call_frame {
+			uint32_t function;
+			unsigned long entered;
+		};
+
+		//the counts are kept in pages of this many instructions
+		static const unsigned int PAGE_BITS = 10;
+
+		//the pages, by page number
+		std::unordered_map<uint32_t, std::vector<pc_counts>> pages;
+
+		//the page used last, which is nearly always the next one used
+		uint32_t last_page_number;
+		pc_counts *last_page;
+
+		//cycles charged and instructions retired in all
+		unsigned long cycles;
+		unsigned long instructions;
+
+		/* the last two instructions to retire, the older first (null
+			if there aren't any) */
+		pc_counts *older;
+		uint32_t older_pc;
+		pc_counts *newer;
+		uint32_t newer_pc;
+
+		//the calls in progress, innermost last
+		std::vector<call_frame> call_stack;
+
+		/* the functions (the one entered first, and those called), by
+			address, with the times they were called and the cycles
+			spent in calls to them */
+		std::map<uint32_t, call_edge> functions;
+
+		//the calls between functions, by caller and callee
+		std::map<std::pair<uint32_t, uint32_t>, call_edge> edges;
+
+		/**
+		 * Get the counts for an instruction address, making them if
+		 * this is the first time it is seen.
+		 *
+		 * @param pc The address.
+		 * @returns Its counts.
+		 */
+		pc_counts &counts(uint32_t pc);
+
+		/**
+		 * Note the instruction a call went to, or that a return
+		 * happened.
+		 *
+		 * @param caller The call or return instruction.
+		 * @param target The address of the instruction it went to.
+		 */
+		void follow_call(const pc_counts &caller, uint32_t target);
+
+		/**
+		 * Finish a call in progress, charging the cycles it took to
+		 * the function called and its caller's edge to it.
+		 */
+		void return_from_call(void);
+
+		/**
+		 * Find the basic blocks of the instructions that retired.
+		 *
+		 * @returns The blocks, in address order.
+		 */
+		std::vector<basic_block> find_basic_blocks(void) const;
+
+		/**
+		 * Find the function an address is in: the nearest function at
+		 * or before it.
+		 *
+		 * @param pc The address.
+		 * @returns The address of the function.
+		 */
+		uint32_t function_of(uint32_t pc) const;
+};
+
+#endif // _PROFILER_H_
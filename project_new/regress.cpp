@@ -0,0 +1,507 @@
+/**
+ * Source file for main function of the z88 regression runner. Runs z88
+ * test programs side by side, one z88 per test, and checks each one's
+ * output against the expected output as it is produced.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+//C++ includes
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+//C includes
+#include <dirent.h>
+
+//arch library includes
+#include <ProgramImage.h>
+
+//local project includes
+#include "run_program.h"
+#include "golden_output.h"
+#include "options.h"
+
+//cycles a test may run for if no budget is given
+const unsigned long DEFAULT_CYCLE_BUDGET = 1000000;
+
+//a test program, its expected output and how it fared
+struct test_case {
+	//object file name
+	std::string object_file;
+	//the program, or null if it could not be read
+	std::unique_ptr<ProgramImage> image;
+	//contents of the matching .out file
+	std::string expected;
+	//the z88 options in the matching .opts file, if there is one
+	machine_options options;
+	bool has_options;
+	//whether the test passed, or was skipped
+	bool passed;
+	bool skipped;
+	//why it failed or was skipped, if it was
+	std::string reason;
+	//cycles the z88 executed
+	unsigned long cycles;
+	//time the test took, in milliseconds
+	double millis;
+};
+
+//the tests a worker thread has still to run
+struct test_queue {
+	std::mutex lock;
+	std::deque<unsigned int> tests;
+};
+
+/**
+ * Print the command line usage of the regression runner.
+ *
+ * @param prog The name the runner was run as.
+ */
+void usage(const char *prog) {
+	std::cout << "Usage: " << prog << " [-f] [-j <threads>] [-c <cycles>]" <<
+		" [<directory> | <object_file>...]" << std::endl <<
+		"  -f  run the tests without the pipeline, leaving out the" <<
+		" simulated time" << std::endl <<
+		"  -j  run this many tests at once (default: one per CPU)" <<
+		std::endl <<
+		"  -c  fail a test that hasn't halted after this many cycles" <<
+		" (or instructions, with -f; default " <<
+		DEFAULT_CYCLE_BUDGET << ")" << std::endl <<
+		"With no files, every .obj file in the directory (default ." <<
+		") is run." << std::endl <<
+		"Each test's expected output is the .out file next to it," <<
+		" and the z88 options" << std::endl <<
+		"it is run with, if any, are in the .opts file next to it." <<
+		" Tests with options" << std::endl <<
+		"are skipped with -f, as are stalling (s-* and fs-*) tests." <<
+		std::endl;
+}
+
+/**
+ * Add every object file in a directory to the list of tests to run.
+ *
+ * @param dir The directory to look in.
+ * @param files The list of object files to add to.
+ * @returns False if the directory could not be read, true otherwise.
+ */
+bool find_object_files(const std::string &dir,
+	std::vector<std::string> &files) {
+	DIR *d = opendir(dir.c_str());
+
+	if(!d) {
+		return false;
+	}
+
+	std::vector<std::string> found;
+	while(struct dirent *e = readdir(d)) {
+		std::string name(e->d_name);
+
+		if((name.size() > 4) &&
+			(name.compare(name.size() - 4, 4, ".obj") == 0)) {
+			found.push_back(dir + "/" + name);
+		}
+	}
+	closedir(d);
+
+	//in the same order the RUN script would take them
+	std::sort(found.begin(), found.end());
+	files.insert(files.end(), found.begin(), found.end());
+
+	return true;
+}
+
+/**
+ * Read the z88 options a test is run with from its .opts file, if it has
+ * one: options and values separated by white space, as they would be given
+ * on the z88's command line.
+ *
+ * @param t The test, with its object file name filled in.
+ * @param base The test's file names, less their extensions.
+ * @returns False if the options could not all be read, true otherwise.
+ */
+bool load_options(test_case &t, const std::string &base) {
+	std::ifstream file(base + ".opts");
+	std::vector<std::string> words;
+	std::string word;
+
+	t.has_options = false;
+	if(!file) {
+		return true;
+	}
+
+	while(file >> word) {
+		words.push_back(word);
+	}
+	t.has_options = true;
+
+	std::vector<const char*> args;
+	for(const std::string &w : words) {
+		args.push_back(w.c_str());
+	}
+
+	//what is wrong with a bad option goes in the reason
+	std::ostringstream errors;
+	int arg = 0;
+	while(arg < (int)args.size()) {
+		int taken = parse_machine_option(args.size(), args.data(),
+			arg, t.options, errors);
+
+		if(taken < 0) {
+			std::string why = errors.str();
+
+			t.reason = why.substr(0, why.find('\n')) + " in " +
+				base + ".opts";
+			return false;
+		}
+		else if(!taken) {
+			t.reason = "unknown option " + words[arg] + " in " +
+				base + ".opts";
+			return false;
+		}
+		arg += taken;
+	}
+
+	if(!machine_options_consistent(t.options)) {
+		t.reason = "options that don't go together in " + base +
+			".opts";
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Read a test's program, options and expected output. A test whose files
+ * can't be read is failed right away.
+ *
+ * @param t The test, with its object file name filled in.
+ * @param functional Whether the test will be run without the pipeline, in
+ *	which case the simulated time at the end isn't expected, and a test
+ *	with options or stalls is skipped.
+ */
+void load_test(test_case &t, bool functional) {
+	std::string base = t.object_file.substr(0,
+		t.object_file.size() - 4);
+	std::ifstream golden(base + ".out", std::ios::binary);
+
+	t.passed = false;
+	t.skipped = false;
+	t.has_options = false;
+	t.cycles = 0;
+	t.millis = 0;
+
+	if(!golden) {
+		t.reason = "no expected output in " + base + ".out";
+		return;
+	}
+
+	if(!load_options(t, base)) {
+		return;
+	}
+
+	//the options are all about the pipeline, which -f leaves out
+	if(functional && t.has_options) {
+		t.skipped = true;
+		t.reason = "has z88 options";
+		return;
+	}
+
+	/* so are the NOPs a stall puts in the trace, which only the
+		stalling tests expect */
+	std::string name = base.substr(base.find_last_of('/') + 1);
+	if(functional && (!name.compare(0, 2, "s-") ||
+		!name.compare(0, 3, "fs-"))) {
+		t.skipped = true;
+		t.reason = "stalls";
+		return;
+	}
+
+	std::ostringstream contents;
+	contents << golden.rdbuf();
+	t.expected = contents.str();
+
+	//only the pipeline's timing matches, so stop before it
+	std::string::size_type summary = t.expected.rfind("\nSimulated time");
+	if(functional && (summary != std::string::npos)) {
+		t.expected.erase(summary);
+	}
+
+	try {
+		t.image.reset(new ProgramImage(t.object_file.c_str()));
+	}
+	catch(ArchLibError &ale) {
+		t.reason = std::string("can't load program: ") + ale.what();
+	}
+}
+
+/**
+ * Run one test on a z88 of its own, comparing its output against the
+ * expected output as it goes.
+ *
+ * @param t The test to run.
+ * @param budget The most cycles the test may run for.
+ * @param functional Whether to run the test without the pipeline.
+ */
+void run_test(test_case &t, unsigned long budget, bool functional) {
+	if(!t.image || t.skipped) {
+		return;
+	}
+
+	golden_output comparator(t.expected);
+	std::ostream trace(&comparator);
+	bool runaway = false;
+	//how the output compared, once all of the expected output was written
+	bool matching = false;
+	bool matched = false;
+
+	auto start = std::chrono::steady_clock::now();
+
+	try {
+		//the z88 is gone, and its summary written, by the end of this
+		z88_cpu machine(trace);
+
+		machine.set_cycle_limit(budget);
+		machine.connect_components();
+		configure_machine(machine, t.options);
+
+		trace << std::hex;
+
+		machine.instruction_mem.load(*t.image);
+		machine.data_mem.load(*t.image);
+
+		if(functional) {
+			machine.run_functional();
+		}
+		else {
+			machine.run_program();
+		}
+
+		/* a program stopped by the budget has matched so far; the
+			summary the z88 writes as it goes won't match either
+			way, so tell the two apart now */
+		runaway = !machine.has_halted() && comparator.matching();
+		t.cycles = functional ? machine.instructions_executed() :
+			machine.cycles_executed();
+
+		//the reports the test's options ask for come before the summary
+		if(!functional) {
+			print_machine_reports(machine, t.options,
+				t.object_file.c_str(), trace);
+		}
+
+		//without the summary, all of the output is in by now
+		if(functional) {
+			matching = comparator.matching();
+			matched = comparator.matched();
+		}
+	}
+	catch(ArchLibError &ale) {
+		t.reason = std::string("ArchLib error: ") + ale.what();
+	}
+
+	t.millis = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+
+	if(!t.reason.empty()) {
+		return;
+	}
+
+	if(!functional) {
+		matching = comparator.matching();
+		matched = comparator.matched();
+	}
+
+	std::ostringstream why;
+	if(runaway) {
+		why << "still running after " << std::dec << budget <<
+			(functional ? " instructions" : " cycles");
+	}
+	else if(!matching) {
+		why << "output differs at line " << std::dec <<
+			comparator.line();
+	}
+	else if(!matched) {
+		why << "output ends early at line " << std::dec <<
+			comparator.line();
+	}
+	t.reason = why.str();
+	t.passed = t.reason.empty();
+}
+
+/**
+ * Get the next test for a worker thread to run: the next one from its own
+ * queue, or, once that is empty, the last one from another worker's queue.
+ *
+ * @param queues Every worker's queue.
+ * @param self The index of the asking worker's queue.
+ * @param test Set to the index of the test to run.
+ * @returns False if there are no tests left anywhere, true otherwise.
+ */
+bool next_test(std::vector<test_queue> &queues, unsigned int self,
+	unsigned int &test) {
+	for(unsigned int i = 0; i < queues.size(); ++i) {
+		test_queue &q = queues[(self + i) % queues.size()];
+		std::lock_guard<std::mutex> hold(q.lock);
+
+		if(q.tests.empty()) {
+			continue;
+		}
+
+		if(i == 0) {
+			test = q.tests.front();
+			q.tests.pop_front();
+		}
+		else {
+			test = q.tests.back();
+			q.tests.pop_back();
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned int threads = std::thread::hardware_concurrency();
+	unsigned long budget = DEFAULT_CYCLE_BUDGET;
+	bool functional = false;
+	std::vector<std::string> files;
+	int arg = 1;
+
+	//options come before the directory or object files
+	while((arg < argc) && (argv[arg][0] == '-')) {
+		if(!strcmp(argv[arg], "-f")) {
+			functional = true;
+			arg++;
+		}
+		else if(!strcmp(argv[arg], "-j") && (arg + 1 < argc)) {
+			threads = strtoul(argv[arg + 1], nullptr, 0);
+			arg += 2;
+		}
+		else if(!strcmp(argv[arg], "-c") && (arg + 1 < argc)) {
+			budget = strtoul(argv[arg + 1], nullptr, 0);
+			arg += 2;
+		}
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if(arg == argc) {
+		find_object_files(".", files);
+	}
+	else if((arg == argc - 1) && find_object_files(argv[arg], files)) {
+		//a directory of tests
+	}
+	else {
+		files.assign(argv + arg, argv + argc);
+	}
+
+	if(files.empty()) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if(threads == 0) {
+		threads = 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	//read every program and expected output up front
+	std::vector<test_case> tests(files.size());
+	for(unsigned int i = 0; i < files.size(); ++i) {
+		tests[i].object_file = files[i];
+		load_test(tests[i], functional);
+	}
+
+	/* deal the tests out to the workers, biggest expected output first,
+		so that the long ones don't all end up last */
+	std::vector<unsigned int> order(tests.size());
+	for(unsigned int i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[&tests](unsigned int a, unsigned int b) {
+			return tests[a].expected.size() >
+				tests[b].expected.size();
+		});
+
+	threads = std::min<unsigned int>(threads, tests.size());
+	std::vector<test_queue> queues(threads);
+	for(unsigned int i = 0; i < order.size(); ++i) {
+		queues[i % threads].tests.push_back(order[i]);
+	}
+
+	//each worker runs its own tests, then helps with everyone else's
+	std::vector<std::thread> workers;
+	for(unsigned int w = 0; w < threads; ++w) {
+		workers.emplace_back([&queues, &tests, w, budget,
+			functional]() {
+			unsigned int test;
+
+			while(next_test(queues, w, test)) {
+				run_test(tests[test], budget, functional);
+			}
+		});
+	}
+	for(std::thread &worker : workers) {
+		worker.join();
+	}
+
+	double elapsed = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+
+	//report in the order the tests were given
+	unsigned int failed = 0;
+	unsigned int skipped = 0;
+	double simulated = 0;
+	std::cout << std::fixed << std::setprecision(3);
+	for(const test_case &t : tests) {
+		if(t.skipped) {
+			std::cout << "SKIP  " << t.object_file << "  " <<
+				t.reason << std::endl;
+			skipped++;
+			continue;
+		}
+
+		std::cout << (t.passed ? "PASS  " : "FAIL  ") << std::left <<
+			std::setw(24) << t.object_file << std::right <<
+			std::setw(9) << t.cycles <<
+			(functional ? " instrs" : " cycles") <<
+			std::setw(11) << t.millis << " ms";
+
+		if(!t.passed) {
+			std::cout << "  " << t.reason;
+			failed++;
+		}
+		std::cout << std::endl;
+
+		simulated += t.millis;
+	}
+
+	std::cout << std::endl << (tests.size() - failed - skipped) <<
+		" passed, " << failed << " failed";
+	if(skipped) {
+		std::cout << ", " << skipped << " skipped";
+	}
+	std::cout << "; " << tests.size() << " tests in " <<
+		elapsed << " ms on " << threads << " threads (" << simulated <<
+		" ms of simulation)" << std::endl;
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+/**
+ * Source file for "report" module that has the formatting shared by the
+ * reports the z88 prints at the end of a program.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+//C++ includes
+#include <iostream>
+#include <iomanip>
+
+//local project includes
+#include "report.h"
+
+void print_percentage(std::ostream &out, unsigned long part,
+	unsigned long whole) {
+	out << part << " (" << std::fixed << std::setprecision(1) <<
+		(whole ? (100.0 * part / whole) : 0.0) << "%)";
+}
@@ -0,0 +1,26 @@
+/**
+ * Header file for "report" module that has the formatting shared by the
+ * reports the z88 prints at the end of a program.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+#ifndef _REPORT_H_
+#define _REPORT_H_
+
+//C++ includes
+#include <iostream>
+
+/**
+ * Print a count and the percentage of another count it is, to one decimal
+ * place. Leaves the stream fixed-point with a precision of 1; the report
+ * printing it restores them.
+ *
+ * @param out Where to print them.
+ * @param part The count.
+ * @param whole The count it is a part of.
+ */
+void print_percentage(std::ostream &out, unsigned long part,
+	unsigned long whole);
+
+#endif // _REPORT_H_
@@ -8,9 +8,14 @@
 //C++ includes
 #include <iostream>
 #include <iomanip>
+#include <vector>
+#include <algorithm>
 
 //arch library includes
 #include <Clock.h>
+#include <Checkpoint.h>
+#include <Schedule.h>
+#include <Trace.h>
 
 //local project includes
 #include "run_program.h"
@@ -18,366 +23,285 @@
 #include "instruction_decode.h"
 
 
-
-//global flag determining whether the CPU has been halted or not
-bool halted = false;
-
-
 /***********************************
- * Misc. functions
+ * Function implementations        *
  ***********************************/
 
-	/**
-	 * Perform the initial read of a program's entry point into the
-	 * program counter.
-	 */
-	void bootstrap_program(void);
-
+z88_cpu::z88_cpu(std::ostream &out) :
+	z88_components(out),
+	out(out),
+	halted(false),
+	cycle_limit(0),
+	instructions(0),
+	stall_bubbles(0),
+	tracing(true),
+	draining(false),
+	functional(false),
+	functional_gprs(),
+	functional_pc(0),
+	functional_next_pc(0),
+	checkpoints(),
+	next_checkpoint(0),
+	last_checkpoint(nullptr),
+	tick_schedules(),
+	tick_key(),
+	predictor(),
+	id_speculating(false),
+	id_branch_taken(false),
+	id_target_predicted(false),
+	id_target(0),
+	ex_speculating(false),
+	ex_branch_taken(false),
+	ex_target(0),
+	ex_mispredicted(false),
+	cycle_causes(),
+	profile(),
+	id_stall_cause(z11::NO_STALL),
+	squashed_for(),
+	mshrs(),
+	register_ready(),
+	mshr_loads(0),
+	merged_loads(0),
+	mshr_busy_cycles(0),
+	mshr_any_cycles(0),
+	mshr_busy_until(0),
+	mshr_peak(0),
+	mshr_full_cycles(0),
+	blocking_load_cycles(0),
+	prefetcher(),
+	prefetches()
+{}
+
+void z88_cpu::bootstrap_program(void) {
+	if_r.pc.latchFrom(instruction_mem.READ());
+	Clock::tick();
+}
 
-/***********************************
- * Instruction fetch functions
- ***********************************/
+unsigned long z88_cpu::cycles_executed(void) const {
+	return (context.getTime() - 1) / 2;
+}
 
-	/**
-	 * Determine if the instruction currently in the IF/ID register is a
-	 * jump instruction.
-	 *
-	 * @returns True if the IF/ID register currently contains a jump
-	 *	instruction, false otherwise.
-	 */
-	bool id_instruction_is_jump(void);
-
-	/**
-	 * Determine if the instruction currently in the IF/ID register is a
-	 * branch instruction whose branch will be taken.
-	 *
-	 * @returns True if the IF/ID register contains a branch instruction,
-	 *	false otherwise.
-	 */
-	bool id_instruction_is_taken_branch(void);
-
-	/**
-	 * Set up the CPU operations for the first tick (of two) in the
-	 * fetch stage for the current cycle. Just loads the value in PC into
-	 * the instruction memory's MAR.
-	 */
-	void fetch_part1(void);
-
-	/**
-	 * Set up the CPU operations for the second tick (of two) in the
-	 * fetch stage for the current cycle.
-	 * Reads next instruction from instruction memory, determines if we
-	 * are going to branch/jump or just move to the next instruction and
-	 * updates the PC accordingly. Forwards PC contents to IF/ID pipeline
-	 * register.
-	 */
-	void fetch_part2(void);
+unsigned long z88_cpu::instructions_executed(void) const {
+	return instructions;
+}
 
+unsigned long z88_cpu::program_instructions_executed(void) const {
+	return instructions - stall_bubbles;
+}
 
-/***********************************
- * Instruction decode functions
- ***********************************/
+void z88_cpu::set_cycle_limit(unsigned long cycles) {
+	cycle_limit = cycles;
+}
 
-	/**
-	 * Set up operations for sign extending the immediate value used for
-	 * a branch offset.
-	 */
-	void decode_sign_extend_branch_offset(void);
-
-	/**
-	 * Within the decode stage, move the contents of the instructions 'rs'
-	 * register (or a forwarded value that will be written to that
-	 * register) into the decode stage temp register.
-	 */
-	void decode_load_rs_into_temp(void);
-
-	/**
-	 * Within the decode stage, get the value that should be used for the
-	 * value in the 'rs' register specified by the branch instruction.
-	 * This function may simply pull the value out of the register, or may
-	 * retrieve (forward) it from a later stage in the pipeline that is
-	 * going to update the register specified as 'rs' in the branch
-	 * instruction.
-	 *
-	 * @returns The value contained in the 'rs' register for the
-	 *	instruction in the IF/ID pipeline register.
-	 */
-	long decode_get_branch_rs_value(void);
-
-	/**
-	 * Within the decode stage, get the value that should be used for the
-	 * value in the 'rt' register specified by the branch instruction.
-	 * This function may simply pull the value out of the register, or may
-	 * retrieve (forward) it from a later stage in the pipeline that is
-	 * going to update the register specified as 'rt' in the branch
-	 * instruction.
-	 *
-	 * @returns The value contained in the 'rt' register for the
-	 *	instruction in the IF/ID pipeline register.
-	 */
-	long decode_get_branch_rt_value(void);
-
-	/**
-	 * Set up the CPU operations for the first tick (of two) in the
-	 * decode stage for the current cycle.
-	 * Performs necessary first-tick operations for instructions that need
-	 * both ticks. This includes branches, jumps, and shifts, that must
-	 * calculate targets, offsets, and extract the contents of the 'sh'
-	 * field, respectively on the first tick.
-	 */
-	void decode_part1(void);
-
-	/**
-	 * Set up the CPU operations for the second tick (of two) in the
-	 * decode stage for the current cycle.
-	 * Loads the contents of 'rs' and 'rt' registers into A and B
-	 * registers, perform sign or zero extension of immediate fields,
-	 * and finish calculating branch and jump destinations, among other
-	 * things.
-	 */
-	void decode_part2(void);
+bool z88_cpu::has_halted(void) const {
+	return halted;
+}
 
+bool z88_cpu::use_branch_predictor(const char *kind) {
+	std::unique_ptr<direction_predictor> directions =
+		make_direction_predictor(kind);
 
-/***********************************
- * Instruction execute functions
- ***********************************/
+	if(!directions) {
+		return false;
+	}
 
-	/**
-	 * Determine what general purpose register (if any) is going to be
-	 * written to by the instruction currently in the EX/MEM pipeline
-	 * register.
-	 *
-	 * @return The index number of the GPR that will be written, or 0
-	 *	if no GPR will be written by the instruction (note that GPR 0
-	 *	cannot have its value overwritten, so returning 0 for
-	 *	"no write" does not interfere with the results).
-	 */
-	long gpr_written_by_mem_stage_instruction(void);
-
-	/**
-	 * Determine what general purpose register (if any) is going to be
-	 * written to by the instruction currently in the MEM/WB pipeline
-	 * register.
-	 *
-	 * @return The index number of the GPR that will be written, or 0
-	 *	if no GPR will be written by the instruction (note that GPR 0
-	 *	cannot have its value overwritten, so returning 0 for
-	 *	"no write" does not interfere with the results).
-	 */
-	long gpr_written_by_wb_stage_instruction(void);
-
-	/**
-	 * Set up the CPU operations for the first tick (of two) in the
-	 * execute stage for the current cycle.
-	 * The first tick of the execute stage is dedicated entirely to
-	 * forwarding, and pulls in result values from the EX/MEM and MEM/WB
-	 * pipeline registers into the ID/EX pipeline register for use in
-	 * execution, as needed.
-	 */
-	void execute_part1(void);
-
-	/**
-	 * Perform the setup common to the execution of all ALU immediate
-	 * instructions. Sets ALU inputs and outputs (leaving the caller to
-	 * only specify an operation to perform).
-	 */
-	void execute_alu_immediate_common(void);
-
-	/**
-	 * Perform the setup common to the execution of all register-register
-	 * ALU instructions. Sets ALU inputs and outputs (leaving the caller
-	 * to only specify an operation to perform).
-	 */
-	void execute_alu_register_common(void);
-
-	/**
-	 * Perform the setup common to the execution of all shift
-	 * instructions. Sets SLU inputs and outputs (leaving the caller to
-	 * only specify an operation to perform).
-	 */
-	void execute_shift_common(void);
-
-	/**
-	 * Set up the CPU operations for the second tick (of two) in the
-	 * execute stage for the current cycle.
-	 * Forwards data from ID/EX pipeline register to EX/MEM pipeline
-	 * register, performs ALU operations and other calculations.
-	 */
-	void execute_part2(void);
+	predictor.reset(new branch_predictor(std::move(directions)));
+	return true;
+}
 
+void z88_cpu::use_non_blocking_loads(unsigned int count) {
+	mshrs.assign(count, mshr{0, 0});
 
-/***********************************
- * Instruction memory functions
- ***********************************/
+	//the memory stage keeps track of when its loads complete itself
+	data_mem.setNonBlocking(count != 0);
+}
 
-	/**
-	 * Set up the CPU operations for the first tick (of two) in the
-	 * memory stage for the current cycle.
-	 * The first tick of the memory stage just loads the data memory
-	 * address into the data memory MAR for load and store instructions.
-	 * No operations are performed for any other instruction types.
-	 */
-	void memory_part1(void);
-
-	/**
-	 * Set up the CPU operations for the second tick (of two) in the
-	 * memory stage for the current cycle.
-	 * The second tick of the memory stage forwards the contents of the
-	 * EX/MEM pipeline register to the MEM/WB pipeline register (if
-	 * necessary) and performs memory reads/writes for load/store
-	 * instructions.
-	 */
-	void memory_part2(void);
+void z88_cpu::use_prefetcher(const prefetcher_config &config) {
+	prefetcher.reset(new stride_prefetcher(config));
+}
 
+void z88_cpu::print_branch_predictor_report(std::ostream &report) const {
+	if(predictor) {
+		predictor->print_report(report);
+	}
+}
 
-/***********************************
- * Instruction writeback functions
- ***********************************/
+void z88_cpu::count_cycles_by_address(void) {
+	cycle_causes.count_by_address(true);
+}
 
-	/**
-	 * Set up the CPU operations for the first tick (of two) in the
-	 * writeback stage for the current cycle.
-	 * Tick 1 of the writeback stage forwards results to the
-	 * post-writeback pipeline register (for instructions tracing), writes
-	 * retuls values into GPRs, and marks the CPU as halted on invalid,
-	 * unimplemented, or halt instructions.
-	 */
-	void writeback_part1(void);
-
-	/**
-	 * Set up the operations needed to write a result value to the
-	 * specified general purpose register.
-	 *
-	 * @param gpr_num The index in the register file of the GPR to write
-	 *	to.
-	 * @param src The source register for the data to be written to the
-	 *	GPR. Must be connected to 'wb_register_write_bus' input.
-	 */
-	void writeback_to_GPR(int gpr_num, StorageObject &src);
-
-	/**
-	 * Set up the CPU operations for the second tick (of two) in the
-	 * writeback stage for the current cycle.
-	 * No operations are performed on the second tick for the writeback
-	 * stage. This function is left as a placeholder.
-	 */
-	void writeback_part2(void);
+void z88_cpu::print_cpi_stack(std::ostream &report,
+	const symbol_table &symbols) const {
+	cycle_causes.print_report(report, symbols);
+}
 
-/***********************************
- * Instruction tracing functions
- ***********************************/
+void z88_cpu::print_memory_report(std::ostream &report) const {
+	unsigned long fetch_cycles = cycle_causes.cycles(CYCLE_IMEM_STALL);
+	unsigned long load_store_cycles = cycle_causes.cycles(CYCLE_DMEM_STALL);
 
-	/**
-	 * Print any non-zero general purpose registers, up to 4 per line.
-	 * Used for executing break instructions.
-	 */
-	void print_break_information(void);
+	if(instruction_cache || data_cache || instruction_mem.hasLatency() ||
+		data_mem.hasLatency() || fetch_cycles || load_store_cycles) {
+		report << "Memory stall cycles: " << std::dec <<
+			(fetch_cycles + load_store_cycles) << " (fetch " <<
+			fetch_cycles << ", load/store " << load_store_cycles <<
+			")" << std::endl;
+	}
+	if(instruction_mem.hasLatency()) {
+		instruction_mem.printLatencyStats(report);
+	}
+	if(data_mem.hasLatency()) {
+		data_mem.printLatencyStats(report);
+	}
+	if(instruction_cache) {
+		instruction_cache->printStats(report);
+	}
+	if(data_cache) {
+		data_cache->printStats(report);
+		if(prefetcher) {
+			prefetcher->print_report(report, *data_cache);
+		}
+	}
 
-	/**
-	 * Print out the details of the instruction that most recently
-	 * completed the writeback stage. Also print halt messages if
-	 * necessary.
-	 */
-	void print_execution_record(void);
+	//only continue if loads are non-blocking
+	if(mshrs.empty()) {
+		return;
+	}
 
+	std::ios_base::fmtflags old = report.flags();
+	std::streamsize old_precision = report.precision();
+	unsigned long stall_cycles =
+		cycle_causes.cycles(CYCLE_PENDING_LOAD_STALL) +
+		mshr_full_cycles;
+
+	/* memory-level parallelism is the MSHRs taken on average over the
+		cycles any were */
+	report << "Non-blocking loads: " << mshrs.size() << " MSHRs, " <<
+		(mshr_loads + merged_loads) << " loads waited on memory (" <<
+		merged_loads << " sharing an MSHR)" << std::endl;
+	report << "  memory-level parallelism " << std::fixed <<
+		std::setprecision(2) << (mshr_any_cycles ?
+		double(mshr_busy_cycles) / mshr_any_cycles : 0.0) <<
+		" (peak " << mshr_peak << "), MSHRs all taken for " <<
+		mshr_full_cycles << " cycles" << std::endl;
+	report << "  load stall cycles " << stall_cycles << ", against " <<
+		blocking_load_cycles << " if loads blocked (" <<
+		((blocking_load_cycles > stall_cycles) ?
+		(blocking_load_cycles - stall_cycles) : 0) << " saved)" <<
+		std::endl;
+
+	(void)report.flags(old);
+	(void)report.precision(old_precision);
+}
 
-/***********************************
- * Stalling functions              *
- ***********************************/
+void z88_cpu::print_profile(std::ostream &report,
+	const symbol_table &symbols) const {
+	profile.print_report(report, symbols);
+}
 
-	/**
-	 * Determine if the instruction currently in the IF/ID pipeline
-	 * register will need to be stalled because it uses the value stored
-	 * in a register that will be written by a load instruction currently
-	 * in the ID/EX pipeline register.
-	 *
-	 * @return True if we must stall for this reason, false otherwise.
-	 */
-	bool must_stall_id_phase_due_to_load_in_idex_register(void);
-
-	/**
-	 * Determine if the instruction currently in the IF/ID pipeline
-	 * register will need to be stalled because it uses the value stored
-	 * in a register that will be written by a load instruction currently
-	 * in the EX/MEM pipeline register. In particular, instructions that
-	 * use the value of a register within the decode stage (branches,
-	 * jumps, etc.) will need to wait if they pull from a register that
-	 * will be written to by a load instruction in the memory stage.
-	 *
-	 * @return True if we must stall for this reason, false otherwise.
-	 */
-	bool must_stall_id_phase_due_to_load_in_exmem_register(void);
-
-	/**
-	 * Determine what general purpose register (if any) is going to be
-	 * written to by the instruction currently in the ID/EX pipeline
-	 * register.
-	 *
-	 * @return The index number of the GPR that will be written, or 0
-	 *	if no GPR will be written by the instruction (note that GPR 0
-	 *	cannot have its value overwritten, so returning 0 for
-	 *	"no write" does not interfere with the resutls).
-	 */
-	long gpr_written_by_ex_stage_instruction(void);
-
-	/**
-	 * Determine if the instruction currently in the IF/ID pipeline
-	 * register will need to be stalled because it uses the value stored
-	 * in a register that will be written by an instruction (of any type)
-	 * currently in the ID/EX pipeline register. In particular,
-	 * instructions like branches and jumps, that use value they retrieve
-	 * in the decode stage, will need to wait if the value they need to
-	 * retrieve is currently being calculated by an instruction in the
-	 * execute stage.
-	 *
-	 * @return True if we must stall for this reason, false otherwise.
-	 */
-	bool must_stall_id_phase_to_use_result_in_id_phase(void);
-
-	/**
-	 * Determine if the instruction in the IF/ID pipeline register must be
-	 * stalled (delayed from entering the decode stage).
-	 *
-	 * @returns True if the instruction must be stalled, false otherwise.
-	 */
-	bool must_stall_id_phase(void);
-
-	/**
-	 * Perform the setup necessary to insert a NOP instruction with the
-	 * correct source address into the ID/EX pipeline register. Doing this
-	 * fills the gap created by stalling an instruction from entering the
-	 * decode stage.
-	 */
-	void insert_nop_into_idex_reg(void);
+void z88_cpu::take_due_checkpoints(void) {
+	while((next_checkpoint < checkpoints.size()) &&
+		(checkpoints[next_checkpoint].cycle <= cycles_executed())) {
+		const pending_checkpoint &c = checkpoints[next_checkpoint];
 
+		/* an incremental checkpoint builds on the one saved just
+			before it */
+		if(c.incremental && last_checkpoint) {
+			Checkpoint::save(c.file_name, last_checkpoint);
+		}
+		else {
+			Checkpoint::save(c.file_name);
+		}
 
+		last_checkpoint = c.file_name;
+		next_checkpoint++;
+	}
+}
 
+void z88_cpu::make_tick_key(ScheduleCache::Key &key, int tick,
+	bool stall_id_phase) {
+	//an invalid pipeline register's instruction doesn't matter
+	const unsigned long empty = ~0UL;
+
+	key.clear();
+	key.push_back(tick);
+	key.push_back(stall_id_phase);
+	key.push_back(draining);
+	key.push_back(ifid_r.valid.value() ? ifid_r.ir.uvalue() : empty);
+	key.push_back(idex_r.valid.value() ? idex_r.ir.uvalue() : empty);
+	key.push_back(exmem_r.valid.value() ? exmem_r.ir.uvalue() : empty);
+	key.push_back(memwb_r.valid.value() ? memwb_r.ir.uvalue() : empty);
+
+	if(tick == 1) {
+		//decode stage sets or clears 'cond' for branches
+		key.push_back(id_branch_taken);
+	}
+	else {
+		//fetch and decode stages follow 'cond' for taken branches
+		key.push_back(idex_r.cond.value() != 0);
+		/* decode stage keeps the other path of a branch it predicts,
+			and fetch and execute stages recover from a
+			misprediction */
+		key.push_back(id_speculating);
+		key.push_back(ex_mispredicted);
+		//execute stage picks a constant for set-if-less-than
+		key.push_back(idex_r.valid.value() &&
+			(idex_r.uop.classes & z11::SET_IF_LESS_THAN) &&
+			execute_less_than());
+	}
+}
 
+void z88_cpu::decode_pipeline_micro_ops(void) {
+	ifid_r.uop = decode_micro_op(ifid_r.ir);
+	idex_r.uop = decode_micro_op(idex_r.ir);
+	exmem_r.uop = decode_micro_op(exmem_r.ir);
+	memwb_r.uop = decode_micro_op(memwb_r.ir);
+	post_wb_r.uop = decode_micro_op(post_wb_r.ir);
+}
 
+void z88_cpu::advance_micro_ops(int tick, bool stall_id_phase) {
+	/* each stage only forwards its IR if it holds a valid instruction,
+		so the same goes for its micro-op */
+	if(tick == 1) {
+		//writeback stage forwards to the post-WB register
+		if(memwb_r.valid.value()) {
+			post_wb_r.uop = memwb_r.uop;
+		}
+		return;
+	}
 
-/***********************************
- * Function implementations        *
- ***********************************/
+	//working from the back of the pipeline to the front
+	if(exmem_r.valid.value()) {
+		memwb_r.uop = exmem_r.uop;
+	}
+	if(idex_r.valid.value()) {
+		exmem_r.uop = idex_r.uop;
+	}
+	if(stall_id_phase) {
+		idex_r.uop = decode_micro_op(stalling_nop_constant);
+		idex_r.uop.stalled_for = id_stall_cause;
+		idex_r.uop.stalled_pc = ifid_r.pc.value();
+	}
+	else if(ifid_r.valid.value()) {
+		idex_r.uop = ifid_r.uop;
+	}
 
-void bootstrap_program(void) {
-	if_r.pc.latchFrom(instruction_mem.READ());
-	Clock::tick();
+	//a prediction moves along with its branch or jump
+	ex_speculating = !stall_id_phase && id_speculating;
+	ex_branch_taken = id_branch_taken;
+	ex_target = id_target;
 }
 
-bool id_instruction_is_jump(void) {
-	switch(decode_instruction(ifid_r.ir)) {
-		case z11::J:
-		case z11::JAL:
-		case z11::JR:
-		case z11::JALR:
-			return true;
-	}
+void z88_cpu::schedule_checkpoint(unsigned long cycle, const char *file_name,
+	bool incremental) {
+	checkpoints.push_back({cycle, file_name, incremental});
+}
 
-	return false;
+bool z88_cpu::id_instruction_is_jump(void) {
+	return (ifid_r.uop.classes & z11::JUMP);
 }
 
-bool id_instruction_is_taken_branch(void) {
-	switch(decode_instruction(ifid_r.ir)) {
+bool z88_cpu::id_instruction_is_taken_branch(void) {
+	switch(ifid_r.uop.operation) {
 		case z11::BEQ:
 		case z11::BNE:
 			/* 'cond' bit in ID/EX register will be set after
@@ -389,13 +313,34 @@ bool id_instruction_is_taken_branch(void) {
 	return false;
 }
 
-void fetch_part1(void) {
+void z88_cpu::fetch_part1(void) {
+	//nothing more is fetched while the pipeline drains
+	if(draining) {
+		return;
+	}
+
 	//load address of next instruction into MAR
 	if_instruction_mem_addr_bus.IN().pullFrom(if_r.pc);
-	instruction_mem.MAR().latchFrom(if_instruction_mem_addr_bus.OUT());
+	if(instruction_cache) {
+		instruction_cache->MAR().latchFrom(
+			if_instruction_mem_addr_bus.OUT());
+	}
+	else {
+		instruction_mem.MAR().latchFrom(
+			if_instruction_mem_addr_bus.OUT());
+	}
 }
 
-void fetch_part2(void) {
+void z88_cpu::fetch_part2(void) {
+	/* nothing more is fetched while the pipeline drains, so the PC is
+		left holding the address of the next instruction to execute.
+		Nor is anything fetched from the wrong path after a
+		misprediction; the execute stage restarts the PC instead */
+	if(draining || ex_mispredicted) {
+		ifid_r.valid.clear();
+		return;
+	}
+
 	/* read the next instruction from memory into the IR. This may result
 		in an issue in edge cases where a HALT instruction has already
 		been read from the highest allowed address in memory, at which
@@ -404,8 +349,14 @@ void fetch_part2(void) {
 		ArchLibError for reading out of bounds from instruction
 		memory. We choose to acknowledge this case without handling
 		it, as it is unlikely to ever occur. */
-	instruction_mem.read();
-	ifid_r.ir.latchFrom(instruction_mem.READ());
+	if(instruction_cache) {
+		instruction_cache->read();
+		ifid_r.ir.latchFrom(instruction_cache->READ());
+	}
+	else {
+		instruction_mem.read();
+		ifid_r.ir.latchFrom(instruction_mem.READ());
+	}
 
 	/* instruction in decode phase is jump, new PC value is its
 		specified destination */
@@ -429,14 +380,14 @@ void fetch_part2(void) {
 	ifid_r.valid.set();
 }
 
-void decode_sign_extend_branch_offset(void) {
+void z88_cpu::decode_sign_extend_branch_offset(void) {
 	id_imm_alu.OP1().pullFrom(ifid_r.ir);
 	id_imm_alu.OP2().pullFrom(id_imm_sign_extend_mask);
 	id_imm_alu.perform(BusALU::op_extendSign);
 	id_temp_reg.latchFrom(id_imm_alu.OUT());
 }
 
-void decode_load_rs_into_temp(void) {
+void z88_cpu::decode_load_rs_into_temp(void) {
 	/* For instructions that use the values they fetch from GPRs before
 		they reach the execute stage, we will need to do either
 		forwarding or stalling. The implemented instructions that do
@@ -491,11 +442,11 @@ void decode_load_rs_into_temp(void) {
 		gpr_written_by_wb_stage_instruction() : 0);
 
 	//if 'rs' written by instrucion in mem stage
-	if((mem_stage_gpr) && (mem_stage_gpr == RS(ifid_r.ir))) {
+	if((mem_stage_gpr) && (mem_stage_gpr == ifid_r.uop.rs)) {
 		id_temp_reg_load_bus.IN().pullFrom(exmem_r.c);
 	}
 	//otherwise, if 'rs' written by instruction in wb stage
-	if((wb_stage_gpr) && (wb_stage_gpr == RS(ifid_r.ir))) {
+	else if((wb_stage_gpr) && (wb_stage_gpr == ifid_r.uop.rs)) {
 		id_temp_reg_load_bus.IN().pullFrom(memwb_r.c);
 	}
 	/* no conflict occurs with mem or wb stage instruction
@@ -504,13 +455,13 @@ void decode_load_rs_into_temp(void) {
 	else {
 		//load 'rs' into temp register
 		id_temp_reg_load_bus.IN().pullFrom(
-			GPR(RS(ifid_r.ir)));
+			GPR(ifid_r.uop.rs));
 	}
 
 	id_temp_reg.latchFrom(id_temp_reg_load_bus.OUT());
 }
 
-long decode_get_branch_rs_value(void) {
+long z88_cpu::decode_get_branch_rs_value(void) {
 	/* In a situation that is very similar to the above
 		'decode_load_rs_into_temp' function, branch instructions use
 		the value in the 'rs' register in the decode stage to
@@ -537,13 +488,13 @@ long decode_get_branch_rs_value(void) {
 		gpr_written_by_wb_stage_instruction() : 0);
 
 	//if 'rs' written by instrucion in mem stage
-	if((mem_stage_gpr) && (mem_stage_gpr == RS(ifid_r.ir))) {
+	if((mem_stage_gpr) && (mem_stage_gpr == ifid_r.uop.rs)) {
 		/* return value to be written to 'rs' by instruction in EX/MEM
 			pipeline register */
 		return exmem_r.c.value();
 	}
 	//otherwise, if 'rs' written by instruction in wb stage
-	if((wb_stage_gpr) && (wb_stage_gpr == RS(ifid_r.ir))) {
+	if((wb_stage_gpr) && (wb_stage_gpr == ifid_r.uop.rs)) {
 		/* return value to be written to 'rs' by instruction in MEM/WB
 			pipeline register */
 		return memwb_r.c.value();
@@ -551,10 +502,10 @@ long decode_get_branch_rs_value(void) {
 
 	/* otherwise, there are no conflicts, and we can just use the existing
 		value in 'rs' */
-	GPR(RS(ifid_r.ir)).value();
+	return GPR(ifid_r.uop.rs).value();
 }
 
-long decode_get_branch_rt_value(void) {
+long z88_cpu::decode_get_branch_rt_value(void) {
 	/* This is the same as the above 'decode_get_branch_rs_value'
 		function, except for the 'rt' value used by a branch. See the
 		comments in that function for details. */
@@ -567,13 +518,13 @@ long decode_get_branch_rt_value(void) {
 		gpr_written_by_wb_stage_instruction() : 0);
 
 	//if 'rt' written by instrucion in mem stage
-	if((mem_stage_gpr) && (mem_stage_gpr == RT(ifid_r.ir))) {
+	if((mem_stage_gpr) && (mem_stage_gpr == ifid_r.uop.rt)) {
 		/* return value to be written to 'rt' by instruction in EX/MEM
 			pipeline register */
 		return exmem_r.c.value();
 	}
 	//otherwise, if 'rt' written by instruction in wb stage
-	if((wb_stage_gpr) && (wb_stage_gpr == RT(ifid_r.ir))) {
+	if((wb_stage_gpr) && (wb_stage_gpr == ifid_r.uop.rt)) {
 		/* return value to be written to 'rt' by instruction in MEM/WB
 			pipeline register */
 		return memwb_r.c.value();
@@ -581,18 +532,29 @@ long decode_get_branch_rt_value(void) {
 
 	/* otherwise, there are no conflicts, and we can just use the existing
 		value in 'rt' */
-	return GPR(RT(ifid_r.ir)).value();
+	return GPR(ifid_r.uop.rt).value();
+}
+
+bool z88_cpu::decode_branch_condition(void) {
+	switch(ifid_r.uop.operation) {
+		case z11::BEQ:
+			return (decode_get_branch_rs_value() ==
+				decode_get_branch_rt_value());
+		case z11::BNE:
+			return (decode_get_branch_rs_value() !=
+				decode_get_branch_rt_value());
+	}
+
+	return false;
 }
 
-void decode_part1(void) {
+void z88_cpu::decode_part1(void) {
 	//only continue if a valid instruction is waiting to be decoded
 	if(!ifid_r.valid.value()) {
 		return;
 	}
 
-	long t1, t2;
-
-	switch(decode_instruction(ifid_r.ir)) {
+	switch(ifid_r.uop.operation) {
 		//non-variable shift operations
 		case z11::SLL:
 		case z11::SRL:
@@ -626,24 +588,10 @@ void decode_part1(void) {
 			break;
 
 		case z11::BEQ:
-			//sign extend the branch offset and set 'cond' bit
-			decode_sign_extend_branch_offset();
-			t1 = decode_get_branch_rs_value();
-			t2 = decode_get_branch_rt_value();
-//			std::cout << "comparing " << t1 << " and " << t2 << std::endl;
-			if(t1 == t2) {
-				idex_r.cond.set();
-			}
-			else {idex_r.cond.clear();}
-			ifid_r.new_pc.perform(Counter::incr4);
-			break;
-
 		case z11::BNE:
 			//sign extend the branch offset and set 'cond' bit
 			decode_sign_extend_branch_offset();
-			if(decode_get_branch_rs_value() !=
-				decode_get_branch_rt_value()) {
-
+			if(id_branch_taken) {
 				idex_r.cond.set();
 			}
 			else {idex_r.cond.clear();}
@@ -652,7 +600,7 @@ void decode_part1(void) {
 	}
 }
 
-void decode_part2(void) {
+void z88_cpu::decode_part2(void) {
 	//forward valid bit
 	id_valid_forward.IN().pullFrom(ifid_r.valid);
 	idex_r.valid.latchFrom(id_valid_forward.OUT());
@@ -669,11 +617,11 @@ void decode_part2(void) {
 		loaded later */
 
 	//load A with contents of register 'rs'
-	id_a_load_bus.IN().pullFrom(GPR(RS(ifid_r.ir)));
+	id_a_load_bus.IN().pullFrom(GPR(ifid_r.uop.rs));
 	idex_r.a.latchFrom(id_a_load_bus.OUT());
 
 	//load B with contents of register 'rt'
-	id_b_load_bus.IN().pullFrom(GPR(RT(ifid_r.ir)));
+	id_b_load_bus.IN().pullFrom(GPR(ifid_r.uop.rt));
 	idex_r.b.latchFrom(id_b_load_bus.OUT());
 
 	//forward IR contents
@@ -681,7 +629,7 @@ void decode_part2(void) {
 	idex_r.ir.latchFrom(id_ir_forward.OUT());
 
 
-	switch(decode_instruction(ifid_r.ir)) {
+	switch(ifid_r.uop.operation) {
 		//sign extension
 		case z11::ADDI:
 		case z11::SLTI:
@@ -722,7 +670,14 @@ void decode_part2(void) {
 		case z11::JAL:
 		case z11::JR:
 		case z11::JALR:
-			if_branch_bus.IN().pullFrom(id_temp_reg);
+			//the predicted target, if 'rs' isn't ready yet
+			if(id_speculating) {
+				if_branch_bus.IN().pullFrom(
+					id_predicted_target);
+			}
+			else {
+				if_branch_bus.IN().pullFrom(id_temp_reg);
+			}
 			break;
 
 		//add branch offset to PC and send result to PC
@@ -733,6 +688,14 @@ void decode_part2(void) {
 				id_imm_alu.OP2().pullFrom(ifid_r.new_pc);
 				id_imm_alu.perform(BusALU::op_add);
 			}
+			/* a branch predicted not taken keeps its target in
+				IMM, in case it is taken after all */
+			else if(id_speculating) {
+				id_imm_alu.OP1().pullFrom(id_temp_reg);
+				id_imm_alu.OP2().pullFrom(ifid_r.new_pc);
+				id_imm_alu.perform(BusALU::op_add);
+				idex_r.imm.latchFrom(id_imm_alu.OUT());
+			}
 			break;
 
 		//non-immediate instructions, do nothing
@@ -756,60 +719,27 @@ void decode_part2(void) {
 	idex_r.pc.latchFrom(id_pc_forward.OUT());
 }
 
-long gpr_written_by_mem_stage_instruction(void) {
-	z11::op instruction = decode_instruction(exmem_r.ir);
-
+long z88_cpu::gpr_written_by_mem_stage_instruction(void) {
 	/* don't need to worry about load instructions here, as the
 		instructions that come after them and use the register they
 		load into will be stalled */
-
-	if(is_register_alu_instruction(instruction)) {
-		return RD(exmem_r.ir);
-	}
-	else if(is_immediate_alu_instruction(instruction)) {
-		return RT(exmem_r.ir);
-	}
-	else if(instruction == z11::JALR) {
-		return RD(exmem_r.ir);
+	if(exmem_r.uop.classes & z11::LOAD) {
+		return 0;
 	}
-	else if(instruction == z11::JAL) {
-		return 31;
-	}
-
 
-	return 0;
+	return exmem_r.uop.destination;
 }
 
-long gpr_written_by_wb_stage_instruction(void) {
-	z11::op instruction = decode_instruction(memwb_r.ir);
-	if(is_register_alu_instruction(instruction)) {
-		return RD(memwb_r.ir);
-	}
-	else if(is_immediate_alu_instruction(instruction)) {
-		return RT(memwb_r.ir);
-	}
-	else if(is_load_instruction(instruction)) {
-		return RT(memwb_r.ir);
-	}
-	else if(instruction == z11::JALR) {
-		return RD(exmem_r.ir);
-	}
-	else if(instruction == z11::JAL) {
-		return 31;
-	}
-
-	return 0;
+long z88_cpu::gpr_written_by_wb_stage_instruction(void) {
+	return memwb_r.uop.destination;
 }
 
-void execute_part1(void) {
+void z88_cpu::execute_part1(void) {
 	//only continue if a valid instruction is waiting to be executed
 	if(!idex_r.valid.value()) {
 		return;
 	}
 
-	//get instruction we are about to execute
-	z11::op instruction = decode_instruction(idex_r.ir);
-
 	//get GPR written to by mem stage instruction (if any)
 	long mem_stage_gpr = ((exmem_r.valid()) ?
 		gpr_written_by_mem_stage_instruction() : 0);
@@ -824,32 +754,29 @@ void execute_part1(void) {
 		(meaning it doesn't change anything to forward anyway) */
 
 	//if 'rs' written by instrucion in mem stage
-	if((mem_stage_gpr) && (mem_stage_gpr == RS(idex_r.ir))) {
+	if((mem_stage_gpr) && (mem_stage_gpr == idex_r.uop.rs)) {
 		//forward from mem stage
 		idex_a_fill.IN().pullFrom(exmem_r.c);
 		idex_r.a.latchFrom(idex_a_fill.OUT());
 	}
 	//if 'rs' written by instrucion in wb stage
-	else if((wb_stage_gpr) && (wb_stage_gpr == RS(idex_r.ir))) {
+	else if((wb_stage_gpr) && (wb_stage_gpr == idex_r.uop.rs)) {
 		//forward from wb stage
 		idex_a_fill.IN().pullFrom(memwb_r.c);
 		idex_r.a.latchFrom(idex_a_fill.OUT());
 	}
 
 	//if we use 'rt' (ie: we are R-R ALU, store, SLT, or SLTU)
-	if(is_register_alu_instruction(instruction) ||
-		is_store_instruction(instruction) ||
-		//this also captures 'SLTI', but that doesn't change anything
-		is_set_if_less_than_instruction(instruction)) {
+	if(idex_r.uop.classes & z11::USES_RT_IN_EX) {
 
 		//if 'rt' written by instrucion in mem stage
-		if((mem_stage_gpr) && (mem_stage_gpr == RT(idex_r.ir))) {
+		if((mem_stage_gpr) && (mem_stage_gpr == idex_r.uop.rt)) {
 			//forward from mem stage
 			idex_b_fill.IN().pullFrom(exmem_r.c);
 			idex_r.b.latchFrom(idex_b_fill.OUT());
 		}
 		//if 'rt' written by instrucion in wb stage
-		else if((wb_stage_gpr) && (wb_stage_gpr == RT(idex_r.ir))) {
+		else if((wb_stage_gpr) && (wb_stage_gpr == idex_r.uop.rt)) {
 			//forward from wb stage
 			idex_b_fill.IN().pullFrom(memwb_r.c);
 			idex_r.b.latchFrom(idex_b_fill.OUT());
@@ -857,25 +784,38 @@ void execute_part1(void) {
 	}
 }
 
-void execute_alu_immediate_common(void) {
+void z88_cpu::execute_alu_immediate_common(void) {
 	ex_alu.OP1().pullFrom(idex_r.a);
 	ex_alu.OP2().pullFrom(idex_r.imm);
 	exmem_r.c.latchFrom(ex_alu.OUT());
 }
 
-void execute_alu_register_common(void) {
+void z88_cpu::execute_alu_register_common(void) {
 	ex_alu.OP1().pullFrom(idex_r.a);
 	ex_alu.OP2().pullFrom(idex_r.b);
 	exmem_r.c.latchFrom(ex_alu.OUT());
 }
 
-void execute_shift_common(void) {
+void z88_cpu::execute_shift_common(void) {
 	ex_alu.OP1().pullFrom(idex_r.b);
 	ex_alu.OP2().pullFrom(idex_r.imm);
 	exmem_r.c.latchFrom(ex_alu.OUT());
 }
 
-void execute_part2(void) {
+bool z88_cpu::execute_less_than(void) {
+	if(idex_r.uop.operation == z11::SLTI) {
+		return (((int32_t)idex_r.a.value()) <
+			((int32_t)idex_r.imm.value()));
+	}
+	if(idex_r.uop.operation == z11::SLTU) {
+		return (((uint32_t)idex_r.a.value()) <
+			((uint32_t)idex_r.b.value()));
+	}
+
+	return (((int32_t)idex_r.a.value()) < ((int32_t)idex_r.b.value()));
+}
+
+void z88_cpu::execute_part2(void) {
 	//forward valid bit
 	ex_valid_forward.IN().pullFrom(idex_r.valid);
 	exmem_r.valid.latchFrom(ex_valid_forward.OUT());
@@ -893,7 +833,12 @@ void execute_part2(void) {
 	ex_ir_forward.IN().pullFrom(idex_r.ir);
 	exmem_r.ir.latchFrom(ex_ir_forward.OUT());
 
-	switch(decode_instruction(idex_r.ir)) {
+	//put the fetch stage back on the right path after a misprediction
+	if(ex_mispredicted) {
+		execute_redirect();
+	}
+
+	switch(idex_r.uop.operation) {
 		//load/store operations
 		case z11::LW:
 		case z11::SW:
@@ -950,9 +895,7 @@ void execute_part2(void) {
 			ex_alu.perform(BusALU::op_lshift);
 			break;
 		case z11::SLTI:
-			if(((int32_t)idex_r.a.value()) <
-				((int32_t)idex_r.imm.value())) {
-
+			if(execute_less_than()) {
 				ex_alu.perform(BusALU::op_one);
 			}
 			else {
@@ -961,9 +904,7 @@ void execute_part2(void) {
 			exmem_r.c.latchFrom(ex_alu.OUT());
 			break;
 		case z11::SLT:
-			if(((int32_t)idex_r.a.value()) <
-				((int32_t)idex_r.b.value())) {
-
+			if(execute_less_than()) {
 				ex_alu.perform(BusALU::op_one);
 			}
 			else {
@@ -972,9 +913,7 @@ void execute_part2(void) {
 			exmem_r.c.latchFrom(ex_alu.OUT());
 			break;
 		case z11::SLTU:
-			if(((uint32_t)idex_r.a.value()) <
-				((uint32_t)idex_r.b.value())) {
-
+			if(execute_less_than()) {
 				ex_alu.perform(BusALU::op_one);
 			}
 			else {
@@ -1022,23 +961,30 @@ void execute_part2(void) {
 	}
 }
 
-void memory_part1(void) {
+void z88_cpu::memory_part1(void) {
 	//only continue if a valid instruction is waiting to enter mem stage
 	if(!exmem_r.valid.value()) {
 		return;
 	}
 
-	switch(decode_instruction(exmem_r.ir)) {
+	switch(exmem_r.uop.operation) {
 		//load/store instructions - put addr into MAR
 		case z11::LW:
 		case z11::SW:
 			mem_data_mem_addr_bus.IN().pullFrom(exmem_r.c);
-			data_mem.MAR().latchFrom(mem_data_mem_addr_bus.OUT());
+			if(data_cache) {
+				data_cache->MAR().latchFrom(
+					mem_data_mem_addr_bus.OUT());
+			}
+			else {
+				data_mem.MAR().latchFrom(
+					mem_data_mem_addr_bus.OUT());
+			}
 			break;
 	}
 }
 
-void memory_part2(void) {
+void z88_cpu::memory_part2(void) {
 	//forward valid bit
 	mem_valid_forward.IN().pullFrom(exmem_r.valid);
 	memwb_r.valid.latchFrom(mem_valid_forward.OUT());
@@ -1057,7 +1003,7 @@ void memory_part2(void) {
 	memwb_r.ir.latchFrom(mem_ir_forward.OUT());
 
 
-	switch(decode_instruction(exmem_r.ir)) {
+	switch(exmem_r.uop.operation) {
 		//ALU instructions
 		case z11::ADDI:
 		case z11::SLTI:
@@ -1087,16 +1033,28 @@ void memory_part2(void) {
 
 		//load instruction
 		case z11::LW:
-			//read from memory
-			data_mem.read();
-			memwb_r.c.latchFrom(data_mem.READ());
+			//read from memory (through the cache, if there is one)
+			if(data_cache) {
+				data_cache->read();
+				memwb_r.c.latchFrom(data_cache->READ());
+			}
+			else {
+				data_mem.read();
+				memwb_r.c.latchFrom(data_mem.READ());
+			}
 			break;
 
 		//store instruction
 		case z11::SW:
-			//write to memory
-			data_mem.write();
-			data_mem.WRITE().pullFrom(exmem_r.b);
+			//write to memory (through the cache, if there is one)
+			if(data_cache) {
+				data_cache->write();
+				data_cache->WRITE().pullFrom(exmem_r.b);
+			}
+			else {
+				data_mem.write();
+				data_mem.WRITE().pullFrom(exmem_r.b);
+			}
 			break;
 
 		//do nothing cases
@@ -1113,7 +1071,7 @@ void memory_part2(void) {
 	}
 }
 
-void writeback_part1(void) {
+void z88_cpu::writeback_part1(void) {
 	//forward valid bit
 	wb_valid_forward.IN().pullFrom(memwb_r.valid);
 	post_wb_r.valid.latchFrom(wb_valid_forward.OUT());
@@ -1131,7 +1089,7 @@ void writeback_part1(void) {
 	wb_ir_forward.IN().pullFrom(memwb_r.ir);
 	post_wb_r.ir.latchFrom(wb_ir_forward.OUT());
 
-	switch(decode_instruction(memwb_r.ir)) {
+	switch(memwb_r.uop.operation) {
 		//immediate ALU instructions
 		case z11::ADDI:
 		case z11::SLTI:
@@ -1140,7 +1098,7 @@ void writeback_part1(void) {
 		case z11::XORI:
 		case z11::LUI:
 			//write result to 'rt'
-			writeback_to_GPR(RT(memwb_r.ir), memwb_r.c);
+			writeback_to_GPR(memwb_r.uop.rt, memwb_r.c);
 			break;
 
 		//register-register ALU instructions
@@ -1159,20 +1117,19 @@ void writeback_part1(void) {
 		case z11::SRAV:
 		case z11::JALR:
 			//write result to 'rd'
-			writeback_to_GPR(RD(memwb_r.ir), memwb_r.c);
+			writeback_to_GPR(memwb_r.uop.rd, memwb_r.c);
 			break;
 
 		//load instructions
 		case z11::LW:
 			//write result to 'rt'
-			writeback_to_GPR(RT(memwb_r.ir), memwb_r.c);
+			writeback_to_GPR(memwb_r.uop.rt, memwb_r.c);
 			break;
 
-		//instructions that lead to halting
+		//instructions that lead to halting (see 'wb_instruction_halts')
 		case z11::HALT:
 		case z11::UNKNOWN: //invalid instructions
 		default: //valid but unimplemented instructions
-			halted = true;
 			break;
 
 		//JAL writes return addr to r31
@@ -1192,7 +1149,7 @@ void writeback_part1(void) {
 	}
 }
 
-void writeback_to_GPR(int gpr_num, StorageObject &src) {
+void z88_cpu::writeback_to_GPR(int gpr_num, StorageObject &src) {
 	//r0 can't be overwritten
 	if(gpr_num == 0) {return;}
 
@@ -1200,56 +1157,183 @@ void writeback_to_GPR(int gpr_num, StorageObject &src) {
 	GPR(gpr_num).latchFrom(wb_register_write_bus.OUT());
 }
 
-void writeback_part2(void) {}
+void z88_cpu::writeback_part2(void) {}
+
+bool z88_cpu::wb_instruction_halts(void) {
+	if(!memwb_r.valid.value()) {
+		return false;
+	}
+
+	return instruction_halts(memwb_r.uop.operation);
+}
+
+bool z88_cpu::instruction_halts(z11::op instruction) {
+	switch(instruction) {
+		//implemented instructions
+		case z11::ADDI:
+		case z11::SLTI:
+		case z11::ANDI:
+		case z11::ORI:
+		case z11::XORI:
+		case z11::LUI:
+		case z11::ADD:
+		case z11::SUB:
+		case z11::SLT:
+		case z11::SLTU:
+		case z11::AND:
+		case z11::OR:
+		case z11::XOR:
+		case z11::SLL:
+		case z11::SRL:
+		case z11::SRA:
+		case z11::SLLV:
+		case z11::SRLV:
+		case z11::SRAV:
+		case z11::JALR:
+		case z11::LW:
+		case z11::JAL:
+		case z11::NOP:
+		case z11::SW:
+		case z11::J:
+		case z11::JR:
+		case z11::BEQ:
+		case z11::BNE:
+		case z11::BREAK:
+			return false;
+
+		//halt, invalid, and unimplemented instructions
+		case z11::HALT:
+		case z11::UNKNOWN:
+		default:
+			return true;
+	}
+}
+
+long z88_cpu::gpr_value(unsigned int gpr) {
+	if(functional) {
+		return functional_gprs[gpr];
+	}
 
-void print_break_information(void) {
-	std::cout << std::endl << "   ";
+	return GPR(gpr).value();
+}
+
+void z88_cpu::print_gpr(unsigned int gpr) {
+	//the same as printing the register itself
+	TraceFormat::reg(out, GPR(gpr).name(), WORD_WIDTH, gpr_value(gpr));
+}
+
+void z88_cpu::print_break_information(void) {
+	out << std::endl << "   ";
 
 	int num_printed = 0;
 	for(unsigned int i = 0; i < NUM_GPRS; ++i) {
-		if(GPR(i).value() != 0) {
+		if(gpr_value(i) != 0) {
 			if((num_printed) && ((num_printed % 4) == 0)) {
-				std::cout << std::endl << "   ";
+				out << std::endl << "   ";
 			}
 
-			std::cout << std::setw(4) << std::right <<
-				std::setfill(' ') << GPR(i);
+			//the name is padded to 4 characters
+			out << std::setw(4) << std::right << std::setfill(' ');
+			print_gpr(i);
 
 			num_printed++;
 		}
 	}
 }
 
-void print_execution_record(void) {
+void z88_cpu::print_execution_record(void) {
 	/* only continue if the instruction that just finished the writeback
 		stage was a valid one */
 	if(!post_wb_r.valid.value()) {
 		return;
 	}
 
+	if(post_wb_r.uop.stalled_for != z11::NO_STALL) {
+		stall_bubbles++;
+	}
+
+	print_instruction_record(post_wb_r.pc.value(), post_wb_r.ir.uvalue(),
+		post_wb_r.uop);
+}
+
+/**
+ * Write a value into a buffer as hex digits, zero-filled to the given width.
+ *
+ * @param p Where to write the digits.
+ * @param value The value to write.
+ * @param digits How many digits to write.
+ * @returns The position after the digits.
+ */
+static char *put_hex(char *p, unsigned long value, int digits) {
+	static const char hex_digits[] = "0123456789abcdef";
+
+	for(int i = digits - 1; i >= 0; --i) {
+		p[i] = hex_digits[value & 0xF];
+		value >>= 4;
+	}
+
+	return p + digits;
+}
+
+char *z88_cpu::put_gpr(char *p, unsigned int gpr) {
+	//as print_gpr() would, in hex
+	*p++ = ' ';
+	for(const char *name = GPR(gpr).name(); *name; ++name) {
+		*p++ = *name;
+	}
+	*p++ = '[';
+	p = put_hex(p, gpr_value(gpr), (WORD_WIDTH + 3) / 4);
+	*p++ = ']';
+
+	return p;
+}
+
+void z88_cpu::print_instruction_record(unsigned long pc, unsigned long word,
+	const micro_op &uop) {
+	z11::op operation = uop.operation;
+
+	/* the line is put together by hand and written in one go, as going
+		through the stream's formatting for every field is most of
+		the cost of a functional run */
+	char line[64];
+	char *p = line;
+	//the fill character the stream's formatting would have left behind
+	char fill = ' ';
+
+	instructions++;
+	if(!tracing) {
+		return;
+	}
+
 	//print address of instruction
-	std::cout << std::hex << std::setw(8) << std::setfill('0') <<
-		post_wb_r.pc.value() << ":  ";
+	p = put_hex(p, pc, 8);
+	*p++ = ':';
+	*p++ = ' ';
+	*p++ = ' ';
 
 	//print hex opcode value
-	std::cout << std::hex << std::setw(2) << std::setfill('0') <<
-		post_wb_r.ir(31, 26);
-
-	z11::op operation = decode_instruction(post_wb_r.ir);
+	p = put_hex(p, (word >> 26) & 0x3F, 2);
 
 	//print 'funct' value if it was a special instruction
-	if(is_special_instruction(post_wb_r.ir)) {
-		std::cout << " " << std::hex << std::setw(2) <<
-			std::setfill('0') << post_wb_r.ir(5, 0);
+	*p++ = ' ';
+	if(((word >> 26) & 0x3F) == 0) {
+		p = put_hex(p, word & 0x3F, 2);
 	}
 	else {
-		std::cout << "   ";
+		*p++ = ' ';
+		*p++ = ' ';
 	}
 
-	//print mnemonic
-	std::cout << " " << std::left << std::setw(7) << std::setfill(' ') <<
-		z11::mnemonics[operation] << std::right;
-
+	//print mnemonic, padded to 7 characters
+	*p++ = ' ';
+	const char *mnemonic = z11::mnemonics[operation];
+	char *mnemonic_end = p + 7;
+	while(*mnemonic) {
+		*p++ = *mnemonic++;
+	}
+	while(p < mnemonic_end) {
+		*p++ = ' ';
+	}
 
 	//print any overwritten registers and print info for breaks
 	switch(operation) {
@@ -1261,8 +1345,8 @@ void print_execution_record(void) {
 		case z11::XORI:
 		case z11::LUI:
 		case z11::LW:
-			std::cout << " " << std::hex <<
-				GPR(RT(post_wb_r.ir));
+			p = put_gpr(p, uop.rt);
+			fill = '0';
 			break;
 
 		//register-register ALU instructions write 'rd'
@@ -1280,17 +1364,22 @@ void print_execution_record(void) {
 		case z11::SRLV:
 		case z11::SRAV:
 		case z11::JALR:
-			std::cout << " " << std::hex <<
-				GPR(RD(post_wb_r.ir));
+			p = put_gpr(p, uop.rd);
+			fill = '0';
 			break;
 
 		case z11::BREAK:
+			out.write(line, p - line);
+			p = line;
+			out << std::hex << std::right << std::setfill(' ');
 			print_break_information();
+			fill = out.fill();
 			break;
 
 		//JAL instructions write r31
 		case z11::JAL:
-			std::cout << " " << std::hex << GPR(31);
+			p = put_gpr(p, 31);
+			fill = '0';
 			break;
 
 		//do nothing cases
@@ -1306,47 +1395,47 @@ void print_execution_record(void) {
 			break;
 	}
 
-	std::cout << std::endl;
+	*p++ = '\n';
+	out.write(line, p - line);
+
+	/* leave the stream formatted as printing the fields one by one used
+		to; the arch library's transfer trace relies on it */
+	out << std::hex << std::right << std::setfill(fill);
 
 	//print halt message (if necessary)
 	if(halted) {
-		std::cout << "Machine Halted - ";
+		out << "Machine Halted - ";
 		switch(operation) {
 			case z11::HALT:
-				std::cout << "HALT instruction executed";
+				out << "HALT instruction executed";
 				break;
 			case z11::UNKNOWN:
-				std::cout << "undefined instruction";
+				out << "undefined instruction";
 				break;
 			default:
-				std::cout << "unimplemented instruction";
+				out << "unimplemented instruction";
 				break;
 		}
 
-		std::cout << std::endl;
+		out << std::endl;
 	}
 }
 
 
-bool must_stall_id_phase_due_to_load_in_idex_register(void) {
-	z11::op ifid_ins = decode_instruction(ifid_r.ir);
+bool z88_cpu::must_stall_id_phase_due_to_load_in_idex_register(void) {
+	const micro_op &ifid_ins = ifid_r.uop;
 
 	//if load instruction in ID/EX (immediately/"one place" ahead)
 	if(idex_r.valid.value() &&
-		is_load_instruction(decode_instruction(idex_r.ir))) {
+		(idex_r.uop.classes & z11::LOAD)) {
 
 		/* if IF/ID instruction uses contents of 'rs' (ie: is an
 			R-R ALU, ALU imm, load, store, branch, JR, JALR) */
-		if(is_register_alu_instruction(ifid_ins) ||
-			is_immediate_alu_instruction(ifid_ins) ||
-			is_load_instruction(ifid_ins) ||
-			is_store_instruction(ifid_ins) ||
-			is_branch_instruction(ifid_ins) ||
-			is_jump_register_instruction(ifid_ins)) {
+		if(ifid_ins.classes & z11::USES_RS) {
 
 			/* check the load's 'rt' against the other
 				instruction's 'rs' */
-			if(RT(idex_r.ir) == RS(ifid_r.ir)) {
+			if(idex_r.uop.rt == ifid_r.uop.rs) {
 				//if the same, stall
 				return true;
 			}
@@ -1354,12 +1443,10 @@ bool must_stall_id_phase_due_to_load_in_idex_register(void) {
 
 		/* if IF/ID instruction uses 'rt' (ie: is R-R ALU, branch, or
 			store): */
-		if(is_register_alu_instruction(ifid_ins) ||
-			is_branch_instruction(ifid_ins) ||
-			is_store_instruction(ifid_ins)) {
+		if(ifid_ins.classes & z11::USES_RT) {
 			/* check the load's 'rt' against the other
 				instruction's 'rt' */
-			if(RT(idex_r.ir) == RT(ifid_r.ir)) {
+			if(idex_r.uop.rt == ifid_r.uop.rt) {
 				//if the same, stall
 				return true;
 			}
@@ -1369,23 +1456,21 @@ bool must_stall_id_phase_due_to_load_in_idex_register(void) {
 	return false;
 }
 
-bool must_stall_id_phase_due_to_load_in_exmem_register(void) {
-	z11::op ifid_ins = decode_instruction(ifid_r.ir);
+bool z88_cpu::must_stall_id_phase_due_to_load_in_exmem_register(void) {
+	const micro_op &ifid_ins = ifid_r.uop;
 
 	//if load instruction in EX/MEM ("two places" ahead)
 	if(exmem_r.valid.value() &&
-		is_load_instruction(decode_instruction(exmem_r.ir))) {
+		(exmem_r.uop.classes & z11::LOAD)) {
 
 		/* if IF/ID instruction uses contents of 'rs' register in
 			decode stage (ie: is a branch, jump register, or
 			shift variable) */
-		if(is_branch_instruction(ifid_ins) ||
-			is_jump_register_instruction(ifid_ins) ||
-			is_variable_shift_instruction(ifid_ins)) {
+		if(ifid_ins.classes & z11::USES_RS_IN_ID) {
 
 			/* check the load's 'rt' against the other
 				instructions 'rs' */
-			if(RT(exmem_r.ir) == RS(ifid_r.ir)) {
+			if(exmem_r.uop.rt == ifid_r.uop.rs) {
 				//if the same, stall
 				return true;
 			}
@@ -1393,10 +1478,10 @@ bool must_stall_id_phase_due_to_load_in_exmem_register(void) {
 
 		/* if IF/ID uses contents of 'rt' register in decode stage
 			(ie: is a branch) */
-		if(is_branch_instruction(decode_instruction(ifid_r.ir))) {
+		if(ifid_ins.classes & z11::USES_RT_IN_ID) {
 			/* check the load's 'rt' against the other
 				instructions 'rt' */
-			if(RT(exmem_r.ir) == RT(ifid_r.ir)) {
+			if(exmem_r.uop.rt == ifid_r.uop.rt) {
 				//if the same, stall
 				return true;
 			}
@@ -1406,30 +1491,12 @@ bool must_stall_id_phase_due_to_load_in_exmem_register(void) {
 	return false;
 }
 
-long gpr_written_by_ex_stage_instruction(void) {
-	z11::op instruction = decode_instruction(idex_r.ir);
-
-	if(is_load_instruction(instruction)) {
-		return RT(idex_r.ir);
-	}
-	if(is_register_alu_instruction(instruction)) {
-		return RD(idex_r.ir);
-	}
-	else if(is_immediate_alu_instruction(instruction)) {
-		return RT(idex_r.ir);
-	}
-	else if(instruction == z11::JALR) {
-		return RD(idex_r.ir);
-	}
-	else if(instruction == z11::JAL) {
-		return 31;
-	}
-
-	return 0;
+long z88_cpu::gpr_written_by_ex_stage_instruction(void) {
+	return idex_r.uop.destination;
 }
 
-bool must_stall_id_phase_to_use_result_in_id_phase(void) {
-	z11::op ifid_ins = decode_instruction(ifid_r.ir);
+bool z88_cpu::must_stall_id_phase_to_use_result_in_id_phase(void) {
+	const micro_op &ifid_ins = ifid_r.uop;
 
 	//get GPR written to by ex stage instruction (if any)
         long ex_stage_gpr = ((idex_r.valid()) ?
@@ -1437,13 +1504,11 @@ bool must_stall_id_phase_to_use_result_in_id_phase(void) {
 
 	/* if instruction in IF/ID pipeline register uses contents of 'rs' in
 		branch stage */
-	if(is_branch_instruction(ifid_ins) ||
-		is_jump_register_instruction(ifid_ins) ||
-		is_variable_shift_instruction(ifid_ins)) {
+	if(ifid_ins.classes & z11::USES_RS_IN_ID) {
 
 		/* and IF/ID instruction's 'rs' matched ID/EX instruction's
 			written GPR */
-		if((ex_stage_gpr) && (ex_stage_gpr == RS(ifid_r.ir))) {
+		if((ex_stage_gpr) && (ex_stage_gpr == ifid_r.uop.rs)) {
 			/* we will have to wait until execution stage is done
 				in order to use its results */
 				return true;
@@ -1452,10 +1517,10 @@ bool must_stall_id_phase_to_use_result_in_id_phase(void) {
 
 	/* if instruction in IF/ID pipeline register uses contents of 'rt' in
 		branch stage (ie: is a branch instruction) */
-	if(is_branch_instruction(ifid_ins)) {
+	if(ifid_ins.classes & z11::USES_RT_IN_ID) {
 		/* and IF/ID instruction's 'rt' matched ID/EX instruction's
 			written GPR */
-		if((ex_stage_gpr) && (ex_stage_gpr == RT(ifid_r.ir))) {
+		if((ex_stage_gpr) && (ex_stage_gpr == ifid_r.uop.rt)) {
 			/* we will have to wait until execution stage is done
 				in order to use its results */
 				return true;
@@ -1465,19 +1530,241 @@ bool must_stall_id_phase_to_use_result_in_id_phase(void) {
 	return false;
 }
 
-bool must_stall_id_phase(void) {
+bool z88_cpu::must_stall_id_phase_for_pending_load(void) {
+	const micro_op &ifid_ins = ifid_r.uop;
+	unsigned long cycle = cycles_executed();
+
+	//only continue if loads are non-blocking
+	if(mshrs.empty()) {
+		return false;
+	}
+
+	/* BREAK and halts print the registers, so wait for them all (r0
+		is never loaded) */
+	if((ifid_ins.operation == z11::BREAK) ||
+		instruction_halts(ifid_ins.operation)) {
+		for(unsigned long ready : register_ready) {
+			if(ready > cycle + 1) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* a register used or written reaches the execute stage next cycle
+		(a result written can't overtake the load's) */
+	if(((ifid_ins.classes & z11::USES_RS) &&
+		(register_ready[ifid_ins.rs] > cycle + 1)) ||
+		((ifid_ins.classes & z11::USES_RT) &&
+		(register_ready[ifid_ins.rt] > cycle + 1)) ||
+		(register_ready[ifid_ins.destination] > cycle + 1)) {
+		return true;
+	}
+
+	/* one used in the decode stage is wanted this cycle, unless the
+		instruction can be fetched past on a prediction */
+	if(((ifid_ins.classes & z11::USES_RS_IN_ID) &&
+		(register_ready[ifid_ins.rs] > cycle)) ||
+		((ifid_ins.classes & z11::USES_RT_IN_ID) &&
+		(register_ready[ifid_ins.rt] > cycle))) {
+		return !can_speculate();
+	}
+
+	return false;
+}
+
+bool z88_cpu::must_stall_id_phase(void) {
 	//only continue if a valid instruction is waiting to be decoded
 	if(!ifid_r.valid.value()) {
+		id_stall_cause = z11::NO_STALL;
+		return false;
+	}
+
+	//if a load's result is needed in the execute stage, we must stall
+	if(must_stall_id_phase_due_to_load_in_idex_register()) {
+		id_stall_cause = z11::LOAD_USE_STALL;
+	}
+	/* if either of these cases happen, we need to stall, unless we can
+		fetch past the instruction on a prediction instead */
+	else if(must_stall_id_phase_due_to_load_in_exmem_register() &&
+		!can_speculate()) {
+		id_stall_cause = z11::LOAD_TO_BRANCH_STALL;
+	}
+	else if(must_stall_id_phase_to_use_result_in_id_phase() &&
+		!can_speculate()) {
+		id_stall_cause = z11::ID_RESULT_STALL;
+	}
+	//a non-blocking load's register must wait for its data
+	else if(must_stall_id_phase_for_pending_load()) {
+		id_stall_cause = z11::PENDING_LOAD_STALL;
+	}
+	else {
+		id_stall_cause = z11::NO_STALL;
+	}
+
+	return (id_stall_cause != z11::NO_STALL);
+}
+
+bool z88_cpu::can_speculate(void) {
+	if(!predictor) {
 		return false;
 	}
 
-	//if any of these cases happen, we need to stall
-	return (must_stall_id_phase_due_to_load_in_idex_register() ||
-		must_stall_id_phase_due_to_load_in_exmem_register() ||
+	//branches can always be predicted
+	if(ifid_r.uop.classes & z11::BRANCH) {
+		return true;
+	}
+
+	/* jumps through registers can be if the BTB or RAS has a target for
+		them */
+	if(ifid_r.uop.classes & z11::JUMP_REGISTER) {
+		uint32_t target;
+		return predictor->predict_target(ifid_r.pc.value(),
+			(ifid_r.uop.operation == z11::JR) &&
+			(ifid_r.uop.rs == 31), target);
+	}
+
+	return false;
+}
+
+void z88_cpu::predict_id_branch(bool stall_id_phase) {
+	id_speculating = false;
+	id_branch_taken = false;
+	id_target_predicted = false;
+
+	//only continue if a valid instruction is being decoded this cycle
+	if(stall_id_phase || !ifid_r.valid.value()) {
+		return;
+	}
+
+	const micro_op &uop = ifid_r.uop;
+	uint32_t pc = ifid_r.pc.value();
+
+	/* without a predictor, branches are resolved here, their operands
+		having been waited for by stalling */
+	if(!predictor) {
+		if(uop.classes & z11::BRANCH) {
+			id_branch_taken = decode_branch_condition();
+		}
+		return;
+	}
+
+	/* the same cases 'must_stall_id_phase' would stall for, had the
+		instruction not been predicted */
+	bool operands_ready =
+		!(must_stall_id_phase_due_to_load_in_exmem_register() ||
 		must_stall_id_phase_to_use_result_in_id_phase());
+
+	if(uop.classes & z11::BRANCH) {
+		bool predicted = predictor->predict_taken(pc);
+
+		//resolve the branch now if we can, otherwise go with the guess
+		if(operands_ready) {
+			id_branch_taken = decode_branch_condition();
+			predictor->update_taken(pc, predicted, id_branch_taken);
+		}
+		else {
+			id_branch_taken = predicted;
+			id_speculating = true;
+		}
+	}
+	else if(uop.classes & z11::JUMP_REGISTER) {
+		bool is_return = (uop.operation == z11::JR) && (uop.rs == 31);
+
+		id_target_predicted = predictor->predict_target(pc, is_return,
+			id_target);
+		if(is_return) {
+			predictor->pop_return();
+		}
+
+		//likewise for the target of a jump
+		if(operands_ready) {
+			predictor->update_target(pc, is_return,
+				id_target_predicted, id_target,
+				decode_get_branch_rs_value());
+		}
+		else {
+			id_speculating = true;
+			id_predicted_target.poke(id_target);
+		}
+	}
+
+	//subroutine calls return to the instruction after their delay slot
+	if((uop.operation == z11::JAL) || (uop.operation == z11::JALR)) {
+		predictor->push_return(pc + 8);
+	}
+}
+
+long z88_cpu::execute_forwarded_value(unsigned int gpr) {
+	/* forwarded the same way 'execute_part1' does for the data hardware
+		(a load can't be in the EX/MEM pipeline register here, as the
+		instruction would have been stalled for it) */
+	if(gpr && exmem_r.valid.value() &&
+		(gpr_written_by_mem_stage_instruction() == gpr)) {
+		return exmem_r.c.value();
+	}
+	if(gpr && memwb_r.valid.value() &&
+		(gpr_written_by_wb_stage_instruction() == gpr)) {
+		return memwb_r.c.value();
+	}
+
+	return GPR(gpr).value();
+}
+
+void z88_cpu::resolve_ex_branch(void) {
+	ex_mispredicted = false;
+
+	//only continue if the instruction being executed was predicted
+	if(!ex_speculating) {
+		return;
+	}
+
+	const micro_op &uop = idex_r.uop;
+	uint32_t pc = idex_r.pc.value();
+
+	if(uop.classes & z11::BRANCH) {
+		bool taken = (execute_forwarded_value(uop.rs) ==
+			execute_forwarded_value(uop.rt));
+		if(uop.operation == z11::BNE) {
+			taken = !taken;
+		}
+
+		ex_mispredicted = (taken != ex_branch_taken);
+		predictor->update_taken(pc, ex_branch_taken, taken);
+	}
+	else {
+		uint32_t target = execute_forwarded_value(uop.rs);
+
+		ex_mispredicted = (target != ex_target);
+		predictor->update_target(pc,
+			(uop.operation == z11::JR) && (uop.rs == 31), true,
+			ex_target, target);
+	}
 }
 
-void insert_nop_into_idex_reg(void) {
+void z88_cpu::execute_redirect(void) {
+	//a jump through a register goes to the address in 'rs'
+	if(idex_r.uop.classes & z11::JUMP_REGISTER) {
+		ex_redirect_bus.IN().pullFrom(idex_r.a);
+		if_r.pc.latchFrom(ex_redirect_bus.OUT());
+	}
+	/* a branch wrongly predicted taken continues after its delay slot,
+		at the same address a JAL would return to */
+	else if(idex_r.cond.value()) {
+		ex_alu.OP1().pullFrom(idex_r.pc);
+		ex_alu.OP2().pullFrom(ex_jump_link_return_offset);
+		ex_alu.perform(BusALU::op_add);
+		if_r.pc.latchFrom(ex_alu.OUT());
+	}
+	/* and a branch wrongly predicted not taken goes to the target that
+		was kept in IMM */
+	else {
+		ex_redirect_bus.IN().pullFrom(idex_r.imm);
+		if_r.pc.latchFrom(ex_redirect_bus.OUT());
+	}
+}
+
+void z88_cpu::insert_nop_into_idex_reg(void) {
 	/* insert a NOP into the ID/EX register and give it the correct
 		address */
 	idex_r.pc.perform(Counter::incr4);
@@ -1486,15 +1773,80 @@ void insert_nop_into_idex_reg(void) {
 	idex_r.ir.latchFrom(idex_nop_insert_bus.OUT());
 }
 
-void run_program(void) {
+void z88_cpu::run_program(const char *restored_from) {
+	//the clock and static interfaces below act on this z88
+	context.makeCurrent();
+
 	//initial load of entry point into PC
-	bootstrap_program();
+	if(!restored_from) {
+		bootstrap_program();
+	}
+	last_checkpoint = restored_from;
+
+	/* skip checkpoints for cycles that were already executed before
+		the one we were restored from was taken */
+	while((next_checkpoint < checkpoints.size()) &&
+		(checkpoints[next_checkpoint].cycle < cycles_executed())) {
+		next_checkpoint++;
+	}
+
+	//pipeline registers hold their instructions decoded
+	decode_pipeline_micro_ops();
 
 	while(!halted) {
-		//determine if we need to stall this cycle
-		bool stall_id_phase = must_stall_id_phase();
+		//stop a runaway program, or one whose trace can't be written
+		if((cycle_limit && (cycles_executed() >= cycle_limit)) ||
+			!out) {
+			break;
+		}
+
+		/* checkpoints are taken between cycles. They hold the
+			pipeline registers, caches and memories, with any
+			access in progress, but not the MSHRs and register
+			scoreboard, nor the tables of the branch predictor or
+			the prefetcher, so the z88 takes none with those */
+		take_due_checkpoints();
+
+		execute_cycle();
+	}
+}
+
+void z88_cpu::execute_cycle(void) {
+	//find out whether the branch or jump being executed was mispredicted
+	resolve_ex_branch();
+
+	//let a load that has to wait for memory go on without its data
+	issue_non_blocking_load();
+
+	//determine if we need to stall this cycle
+	bool stall_id_phase = must_stall_id_phase();
+
+	/* a misprediction throws away what is fetched this cycle, if anything
+		is (the cycle a stall would have cost) */
+	if(ex_speculating) {
+		predictor->count_speculation(ex_mispredicted,
+			ex_mispredicted && !stall_id_phase);
+	}
+	if(ex_mispredicted && !stall_id_phase) {
+		squashed_for.push_back(idex_r.pc.value());
+	}
 
-		/* first clock tick of cycle */
+	//wait for the memories the fetch and memory stages are about to use
+	wait_for_memory(stall_id_phase);
+
+	//decide which way the branch being decoded goes
+	predict_id_branch(stall_id_phase);
+
+	//show the prefetcher the access the memory stage is about to make
+	train_prefetcher();
+
+	/* first clock tick of cycle */
+
+		/* replay the transfers recorded the last time the
+			pipeline held the same instructions, if any */
+		make_tick_key(tick_key, 1, stall_id_phase);
+		if(!tick_schedules.replay(tick_key)) {
+			tick_schedules.record(tick_key);
 
 			//stall fetch and decode phases if necessary
 			if(!stall_id_phase) {
@@ -1505,9 +1857,18 @@ void run_program(void) {
 			execute_part1();
 			memory_part1();
 			writeback_part1();
-			Clock::tick();
 
-		/* second clock tick of cycle */
+			tick_schedules.end();
+		}
+		halted = wb_instruction_halts();
+		advance_micro_ops(1, stall_id_phase);
+		Clock::tick();
+
+	/* second clock tick of cycle */
+
+		make_tick_key(tick_key, 2, stall_id_phase);
+		if(!tick_schedules.replay(tick_key)) {
+			tick_schedules.record(tick_key);
 
 			//stall fetch and decode phases if necessary
 			if(!stall_id_phase) {
@@ -1515,17 +1876,288 @@ void run_program(void) {
 				decode_part2();
 			}
 			else {
-				//example solution does stall by inserting NOP
+				/* example solution does stall by inserting
+					NOP */
 				insert_nop_into_idex_reg();
 			}
 
 			execute_part2();
 			memory_part2();
 			writeback_part2();
-			Clock::tick();
 
+			tick_schedules.end();
+		}
+		advance_micro_ops(2, stall_id_phase);
+		Clock::tick();
+
+		//a newly fetched instruction is decoded just once
+		if(!stall_id_phase) {
+			ifid_r.uop = decode_micro_op(ifid_r.ir);
+		}
+
+
+	//prefetch what that access says will be wanted next
+	issue_prefetches();
+
+	//print instruction trace
+	print_execution_record();
+	count_cycle();
+}
+
+void z88_cpu::wait_for_memory(bool stall_id_phase) {
+	int fetch_ticks = 0;
+	int memory_ticks = 0;
+	bool fetching;
+	bool loading_or_storing;
+	bool storing;
+
+	/* the fetch stage reads an instruction unless it is stalled, the
+		pipeline is draining, or what it would fetch is squashed */
+	fetching = !stall_id_phase && !draining && !ex_mispredicted;
+	if(fetching) {
+		fetch_ticks = instruction_cache ?
+			instruction_cache->missCost(if_r.pc.value(), false) :
+			instruction_mem.latency(if_r.pc.value());
+	}
+
+	/* the memory stage reads for loads and writes for stores (but
+		non-blocking loads don't wait here) */
+	loading_or_storing = exmem_r.valid.value() &&
+		(exmem_r.uop.classes &
+		(mshrs.empty() ? (z11::LOAD | z11::STORE) : z11::STORE));
+	storing = loading_or_storing &&
+		(exmem_r.uop.classes & z11::STORE);
+	if(loading_or_storing) {
+		memory_ticks = data_cache ?
+			data_cache_wait(exmem_r.c.value(), storing) :
+			data_mem.latency(exmem_r.c.value());
+	}
+
+	if(!fetch_ticks && !memory_ticks) {
+		return;
+	}
+
+	/* the whole pipeline waits, with nothing moving, while both accesses
+		are made at once. An uncached access is started in the first
+		cycle, just as its stage would make it, and the pipeline waits
+		until the memory says it will be done in the stage's own
+		access; a cache's misses (and a store to a memory whose
+		latency is left to the MSHRs) are waited out by the cycle */
+	bool fetch_started = fetching && !instruction_cache && fetch_ticks;
+	bool memory_started = loading_or_storing && !data_cache &&
+		memory_ticks && mshrs.empty();
+	int fetch_cycles = fetch_started ? 1 : (fetch_ticks + 1) / 2;
+	int memory_cycles = memory_started ? 1 : (memory_ticks + 1) / 2;
+
+	if(fetch_started) {
+		if_instruction_mem_addr_bus.IN().pullFrom(if_r.pc);
+		instruction_mem.MAR().latchFrom(
+			if_instruction_mem_addr_bus.OUT());
+	}
+	if(memory_started) {
+		mem_data_mem_addr_bus.IN().pullFrom(exmem_r.c);
+		data_mem.MAR().latchFrom(mem_data_mem_addr_bus.OUT());
+	}
+	Clock::tick();
+
+	/* the value read isn't wanted yet (it is read again when the access
+		completes), nor is the value written (it is written then) */
+	if(fetch_started) {
+		instruction_mem.read();
+	}
+	if(memory_started) {
+		if(storing) {
+			data_mem.write();
+		}
+		else {
+			data_mem.read();
+		}
+	}
+	Clock::tick();
+
+	/* the cycles are charged to the load or store first, as the older
+		instruction, and any left over to the fetch */
+	for(int cycle = 1; ; ++cycle) {
+		if(memory_started && data_mem.ticksToWait() > 1) {
+			memory_cycles = cycle + 1;
+		}
+		if(fetch_started && instruction_mem.ticksToWait() > 1) {
+			fetch_cycles = cycle + 1;
+		}
+
+		if(cycle <= memory_cycles) {
+			cycle_causes.count(CYCLE_DMEM_STALL,
+				exmem_r.pc.value());
+			profile.charge(exmem_r.pc.value());
+		}
+		else {
+			cycle_causes.count(CYCLE_IMEM_STALL, if_r.pc.value());
+			profile.charge(if_r.pc.value());
+		}
+
+		if(cycle >= std::max(fetch_cycles, memory_cycles)) {
+			break;
+		}
+		Clock::tick();
+		Clock::tick();
+	}
+}
+
+void z88_cpu::issue_non_blocking_load(void) {
+	//only continue if loads are non-blocking and one is being made
+	if(mshrs.empty() || !exmem_r.valid.value() ||
+		!(exmem_r.uop.classes & z11::LOAD)) {
+		return;
+	}
+
+	uint32_t address = exmem_r.c.value();
+	uint32_t block = address / (data_cache ?
+		data_cache->unitsPerLine() : data_mem.unitsInDataPath());
+	unsigned int rt = exmem_r.uop.rt;
+	unsigned long cycle = cycles_executed();
+	int ticks = data_cache ? data_cache_wait(address, false) :
+		data_mem.latency(address);
+
+	//what the load would have held the pipeline for
+	blocking_load_cycles += (ticks + 1) / 2;
+
+	//a load of a block already on its way waits for the same data
+	for(const mshr &entry : mshrs) {
+		if((entry.ready > cycle) && (entry.block == block)) {
+			if(rt) {
+				register_ready[rt] = entry.ready;
+			}
+			merged_loads++;
+			return;
+		}
+	}
+
+	//only continue if the load has to wait at all
+	if(!ticks) {
+		return;
+	}
+
+	/* find a free MSHR, holding the whole pipeline as
+		'wait_for_memory' does until one is (before any wait for the
+		fetch stage's access, which could have overlapped it) */
+	std::vector<mshr>::iterator free_entry;
+	for(;;) {
+		free_entry = std::min_element(mshrs.begin(), mshrs.end(),
+			[](const mshr &a, const mshr &b) {
+				return a.ready < b.ready;
+			});
+		if(free_entry->ready <= cycle) {
+			break;
+		}
+
+		Clock::tick();
+		Clock::tick();
+		cycle_causes.count(CYCLE_DMEM_STALL, exmem_r.pc.value());
+		profile.charge(exmem_r.pc.value());
+		mshr_full_cycles++;
+		cycle = cycles_executed();
+	}
+
+	/* the data arrives at the end of the last cycle of the latency,
+		for the execute stage to use the cycle after */
+	free_entry->block = block;
+	free_entry->ready = cycle + 1 + (ticks + 1) / 2;
+	if(rt) {
+		register_ready[rt] = free_entry->ready;
+	}
+
+	//count the MSHRs taken, and the cycles they are taken for
+	unsigned int taken = 0;
+	for(const mshr &entry : mshrs) {
+		taken += (entry.ready > cycle);
+	}
+	mshr_peak = std::max(mshr_peak, taken);
+	mshr_loads++;
+	mshr_busy_cycles += free_entry->ready - cycle;
+
+	unsigned long from = std::max(cycle, mshr_busy_until);
+	if(free_entry->ready > from) {
+		mshr_any_cycles += free_entry->ready - from;
+		mshr_busy_until = free_entry->ready;
+	}
+}
+
+int z88_cpu::data_cache_wait(uint32_t address, bool storing) {
+	int ticks = data_cache->missCost(address, storing);
+
+	/* a line still on its way from a prefetch is waited for as if it
+		had missed, for as long as it has still to come */
+	if(!ticks && prefetcher) {
+		unsigned long cycle = cycles_executed();
+		unsigned long ready = prefetcher->arrival(
+			address / data_cache->unitsPerLine(), cycle);
+
+		if(ready) {
+			ticks = 2 * (ready - cycle);
+		}
+	}
+
+	return ticks;
+}
+
+void z88_cpu::train_prefetcher(void) {
+	//only continue if there is a load or store to prefetch for
+	if(!prefetcher || !data_cache || !exmem_r.valid.value() ||
+		!(exmem_r.uop.classes & (z11::LOAD | z11::STORE))) {
+		return;
+	}
+
+	prefetcher->observe(exmem_r.pc.value(), exmem_r.c.value(),
+		prefetches);
+}
+
+void z88_cpu::issue_prefetches(void) {
+	unsigned long cycle = cycles_executed();
 
-		//print instruction trace
-		print_execution_record();
+	/* a line takes as long to arrive as a miss in it would, counted from
+		the cycle after the access it was predicted from (lines
+		already held, or on their way, aren't prefetched again) */
+	for(uint32_t address : prefetches) {
+		int ticks = data_cache->missCost(address, false);
+
+		if(data_cache->prefetch(address)) {
+			prefetcher->issued(
+				address / data_cache->unitsPerLine(), cycle,
+				cycle + (ticks + 1) / 2);
+		}
 	}
+	prefetches.clear();
 }
+
+void z88_cpu::count_cycle(void) {
+	//an instruction left the writeback stage: a stall NOP or a real one
+	if(post_wb_r.valid.value()) {
+		const micro_op &uop = post_wb_r.uop;
+
+		if(uop.stalled_for != z11::NO_STALL) {
+			cycle_causes.count(
+				cpi_stack::stall_cycle_cause(uop.stalled_for),
+				uop.stalled_pc);
+			profile.charge(uop.stalled_pc);
+		}
+		else {
+			uint32_t pc = post_wb_r.pc.value();
+
+			cycle_causes.count(instruction_halts(uop.operation) ?
+				CYCLE_HALT : CYCLE_RETIRED, pc, uop.operation);
+			profile.retire(pc, uop);
+			profile.charge(pc);
+		}
+	}
+	/* otherwise the slot was left empty by a squashed fetch, a drain, or
+		the pipeline not having filled yet */
+	else if(!squashed_for.empty()) {
+		cycle_causes.count(CYCLE_MISPREDICTION, squashed_for.front());
+		profile.charge(squashed_for.front());
+		squashed_for.pop_front();
+	}
+	else {
+		cycle_causes.count(draining ? CYCLE_DRAIN : CYCLE_FILL);
+	}
+}
+
@@ -8,9 +8,1026 @@
 #ifndef _RUN_PROGRAM_H_
 #define _RUN_PROGRAM_H_
 
+//C++ includes
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <array>
+#include <cstdint>
+
+//arch library includes
+#include <Schedule.h>
+
+//local project includes
+#include "components.h"
+#include "sampling.h"
+#include "branch_predictor.h"
+#include "prefetcher.h"
+#include "cpi_stack.h"
+#include "profiler.h"
+
 /**
- * Execute the program loaded into the z88's instruction memory.
+ * A z88 CPU that can execute a program: its components, plus the state of
+ * the program running on it. Each z88_cpu is an independent machine, so
+ * several can be run one after another (or, one per thread, at the same
+ * time) in a single process.
  */
-void run_program(void);
+class z88_cpu : public z88_components {
+	public:
+		/**
+		 * Build a z88.
+		 *
+		 * @param out Where the z88's instruction trace and the
+		 *	arch library's messages about it go.
+		 */
+		z88_cpu(std::ostream &out = std::cout);
+
+		/**
+		 * Arrange for the state of the whole z88 to be saved once the
+		 * given number of cycles have been executed. Checkpoints must
+		 * be scheduled in cycle order.
+		 *
+		 * @param cycle The number of cycles after which to save.
+		 * @param file_name The checkpoint file to write.
+		 * @param incremental If true, only save the memory pages
+		 *	changed since the previous checkpoint (saved or
+		 *	restored), which the new one then depends on.
+		 */
+		void schedule_checkpoint(unsigned long cycle,
+			const char *file_name, bool incremental);
+
+		/**
+		 * Execute the program loaded into the z88's instruction
+		 * memory. The z88's simulation context is made current on the
+		 * calling thread first.
+		 *
+		 * @param restored_from The checkpoint the z88's state has
+		 *	just been restored from, if any, in which case
+		 *	execution continues from there rather than from the
+		 *	program's entry point.
+		 */
+		void run_program(const char *restored_from = nullptr);
+
+		/**
+		 * Execute the program loaded into the z88's memories one
+		 * instruction at a time, on a flat copy of the GPRs and
+		 * straight out of the memories, without the pipeline or the
+		 * clock. The instruction trace (including BREAK and halt
+		 * output) is the same as run_program()'s, but there is no
+		 * cycle timing: the simulated time the arch library reports
+		 * at the end is just the bootstrap tick, and the GPR
+		 * components are left as they were.
+		 */
+		void run_functional(void);
+
+		/**
+		 * Execute the program loaded into the z88's memories mostly
+		 * as run_functional() does, but switching to the pipeline for
+		 * a window of detailed simulation wherever the plan says to
+		 * measure. Each window starts with the GPRs and PC handed
+		 * over from the functional run (the memories are shared), is
+		 * warmed up, measured, and then drained back into the
+		 * functional run. No instruction trace is printed, since most
+		 * of the program isn't traced in detail.
+		 *
+		 * @param plan Where to measure, and for how long.
+		 * @returns What each window measured, in program order.
+		 */
+		std::vector<window_measurement> run_sampled(
+			const sampling_plan &plan);
+
+		/**
+		 * Execute the program loaded into the z88's memories as
+		 * run_functional() does, without a trace, and record which
+		 * code each interval of the program spends its time in.
+		 *
+		 * @param length The instructions in each interval.
+		 * @returns The basic block vector of each interval.
+		 */
+		std::vector<block_vector> profile_intervals(
+			unsigned long length);
+
+		/**
+		 * Limit the number of cycles run_program() will execute (or
+		 * instructions run_functional() will), for programs that might
+		 * never halt. Execution also stops early if writing the
+		 * instruction trace fails.
+		 *
+		 * @param cycles The most cycles to execute, or 0 for no
+		 *	limit (the default).
+		 */
+		void set_cycle_limit(unsigned long cycles);
+
+		/**
+		 * Have the pipeline fetch past branches and jumps through
+		 * registers whose operands aren't ready yet, on a prediction,
+		 * instead of stalling them. Branches are predicted by the
+		 * named kind of direction predictor (see
+		 * make_direction_predictor()), and jumps through registers by
+		 * a BTB and RAS.
+		 *
+		 * @param kind The kind of direction predictor.
+		 * @returns False if the kind is not known, true otherwise.
+		 */
+		bool use_branch_predictor(const char *kind);
+
+		/**
+		 * Let the memory stage go on past loads that have to wait for
+		 * the data memory (or a miss in its cache), rather than hold
+		 * the pipeline until their data comes back. Each such load
+		 * takes one of a number of miss-status holding registers
+		 * (MSHRs) until its data arrives, or shares one with an
+		 * outstanding load of the same block (cache line, or word if
+		 * there is no cache); when they are all taken, the memory
+		 * stage waits for one to be freed. Instructions that use or
+		 * write the register an outstanding load writes are stalled
+		 * in the decode stage until it can be used. Stores still
+		 * wait. Loads are still made as they go through the memory
+		 * stage, so their data is right; only its timing is
+		 * deferred. Outstanding loads are not part of a checkpoint.
+		 *
+		 * @param mshrs The number of MSHRs.
+		 */
+		void use_non_blocking_loads(unsigned int mshrs);
+
+		/**
+		 * Put a stride prefetcher in front of the data cache (see
+		 * stride_prefetcher). It learns the stride of each load and
+		 * store from the addresses the memory stage makes them at,
+		 * and once one is steady, prefetches the lines it is about
+		 * to use at the end of the cycle it is made in. A prefetch
+		 * takes as long to arrive as a miss would; an access to its
+		 * line before then waits out the rest of that time, as for
+		 * a miss. Prefetches don't hold anything up or take MSHRs,
+		 * and neither the table nor the prefetches on their way are
+		 * part of a checkpoint. Prefetches are only made if there
+		 * is a data cache: without one, a load waits inside the
+		 * data memory for the latency set for its address, and
+		 * the memory can't be told that a prefetch has already
+		 * covered it.
+		 *
+		 * @param config The prefetcher's degree, distance and table
+		 *	size.
+		 */
+		void use_prefetcher(const prefetcher_config &config);
+
+		/**
+		 * Print the accuracy of the branch predictor, if there is one,
+		 * and the cycles it saved.
+		 *
+		 * @param report Where to print the report.
+		 */
+		void print_branch_predictor_report(std::ostream &report) const;
+
+		/**
+		 * Print the cycles the pipeline was held waiting for the
+		 * memories, the memories' average latency and DRAM row hits,
+		 * the hits, misses and evictions of the caches in front of
+		 * them, the memory-level parallelism of non-blocking loads
+		 * and the stall cycles they saved, and the accuracy,
+		 * coverage and timeliness of the prefetcher, if there are
+		 * any.
+		 *
+		 * @param report Where to print the report.
+		 */
+		void print_memory_report(std::ostream &report) const;
+
+		/**
+		 * Also count the cycles of the pipeline by the address of the
+		 * instruction they are charged to, for the CPI stack.
+		 */
+		void count_cycles_by_address(void);
+
+		/**
+		 * Print the CPI stack of the cycles executed through the
+		 * pipeline: what each was spent on, and, if they were counted
+		 * by address, which instructions stalled most.
+		 *
+		 * @param report Where to print the report.
+		 * @param symbols The program's labels, to name the
+		 *	instructions with.
+		 */
+		void print_cpi_stack(std::ostream &report,
+			const symbol_table &symbols) const;
+
+		/**
+		 * Print the execution profile of the instructions retired
+		 * through the pipeline: the hottest basic blocks and
+		 * instructions, the branches' taken counts, and the call
+		 * graph.
+		 *
+		 * @param report Where to print the report.
+		 * @param symbols The program's labels, to name addresses
+		 *	with.
+		 */
+		void print_profile(std::ostream &report,
+			const symbol_table &symbols) const;
+
+		/**
+		 * Determine whether the program has halted, as opposed to
+		 * having been stopped by the cycle limit or a failed write of
+		 * the instruction trace.
+		 *
+		 * @returns True if the program has halted, false otherwise.
+		 */
+		bool has_halted(void) const;
+
+		/**
+		 * Get the number of cycles the z88 has executed, not counting
+		 * the bootstrap tick.
+		 *
+		 * @returns The number of complete cycles executed.
+		 */
+		unsigned long cycles_executed(void) const;
+
+		/**
+		 * Get the number of instructions the z88 has executed (that
+		 * is, that have appeared in the instruction trace).
+		 *
+		 * @returns The number of instructions executed.
+		 */
+		unsigned long instructions_executed(void) const;
+
+		/**
+		 * Get the number of the program's instructions the z88 has
+		 * executed: those in the instruction trace, less the NOPs
+		 * put in by stalls.
+		 *
+		 * @returns The number of program instructions executed.
+		 */
+		unsigned long program_instructions_executed(void) const;
+
+	private:
+		/* a checkpoint to be taken once some number of cycles have
+			executed */
+		struct pending_checkpoint {
+			unsigned long cycle;
+			const char *file_name;
+			bool incremental;
+		};
+
+		/* a miss-status holding register: the block an outstanding
+			load is waiting for, and the cycle from which its data
+			can be used in the execute stage (it is free from then
+			on) */
+		struct mshr {
+			uint32_t block;
+			unsigned long ready;
+		};
+
+		//where the instruction trace goes
+		std::ostream &out;
+
+		//flag determining whether the CPU has been halted or not
+		bool halted;
+
+		//the most cycles to execute, or 0 for no limit
+		unsigned long cycle_limit;
+
+		//instructions executed so far
+		unsigned long instructions;
+
+		//NOPs put in by stalls among them
+		unsigned long stall_bubbles;
+
+		//whether to print the instruction trace
+		bool tracing;
+
+		/* whether the pipeline is being drained, with the fetch stage
+			fetching nothing */
+		bool draining;
+
+		/* whether the program is run by run_functional(), which keeps
+			the GPRs in 'functional_gprs' */
+		bool functional;
+
+		//the GPRs, when running functionally
+		uint32_t functional_gprs[NUM_GPRS];
+
+		/* the address of the next instruction to execute functionally,
+			and of the one after it (which differs from the next
+			address in a branch or jump's delay slot) */
+		uint32_t functional_pc;
+		uint32_t functional_next_pc;
+
+		//checkpoints still to be taken, in cycle order
+		std::vector<pending_checkpoint> checkpoints;
+
+		//index of the next checkpoint in 'checkpoints' to take
+		unsigned int next_checkpoint;
+
+		//the checkpoint most recently saved or restored, if any
+		const char *last_checkpoint;
+
+		/* the transfers set up for each combination of pipeline
+			contents seen so far, replayed when the same combination
+			comes around again */
+		ScheduleCache tick_schedules;
+
+		//the key the transfers for the current tick are cached under
+		ScheduleCache::Key tick_key;
+
+		/* the branch predictor, if the pipeline fetches past branches
+			and jumps on predictions */
+		std::unique_ptr<branch_predictor> predictor;
+
+		/* for the branch or jump being decoded: whether it is being
+			fetched past on a prediction rather than stalled, which
+			way the branch goes (as predicted, if it is), and, for a
+			jump through a register, whether a target was predicted
+			and what */
+		bool id_speculating;
+		bool id_branch_taken;
+		bool id_target_predicted;
+		uint32_t id_target;
+
+		/* the same for the branch or jump being executed, and whether
+			its prediction turned out wrong */
+		bool ex_speculating;
+		bool ex_branch_taken;
+		uint32_t ex_target;
+		bool ex_mispredicted;
+
+		//every cycle executed, by what it was spent on
+		cpi_stack cycle_causes;
+
+		//executions and cycles of every instruction retired
+		execution_profile profile;
+
+		//why the decode stage is stalled this cycle, if it is
+		z11::stall_cause id_stall_cause;
+
+		/* the addresses of the mispredicted branches and jumps whose
+			squashed fetches are yet to leave the pipeline, oldest
+			first */
+		std::deque<uint32_t> squashed_for;
+
+		//the MSHRs, if loads are non-blocking
+		std::vector<mshr> mshrs;
+
+		/* for each GPR, the cycle from which its value can be used in
+			the execute stage, if an outstanding load writes it
+			(earlier cycles don't hold anything up) */
+		std::array<unsigned long, NUM_GPRS> register_ready;
+
+		/* loads that took an MSHR, and that shared one; the cycles
+			MSHRs were taken in all, those in which any were, and
+			the cycle up to which one has been; the most taken at
+			once; the cycles the memory stage waited for a free
+			one; and the cycles the loads would have held the
+			pipeline for if they blocked */
+		unsigned long mshr_loads;
+		unsigned long merged_loads;
+		unsigned long mshr_busy_cycles;
+		unsigned long mshr_any_cycles;
+		unsigned long mshr_busy_until;
+		unsigned int mshr_peak;
+		unsigned long mshr_full_cycles;
+		unsigned long blocking_load_cycles;
+
+		//the data cache's prefetcher, if it has one
+		std::unique_ptr<stride_prefetcher> prefetcher;
+
+		/* the addresses the prefetcher predicted from the access the
+			memory stage makes this cycle, to prefetch once it is
+			made */
+		std::vector<uint32_t> prefetches;
+
+
+	/***********************************
+	 * Misc. functions
+	 ***********************************/
+
+		/**
+		 * Perform the initial read of a program's entry point into the
+		 * program counter.
+		 */
+		void bootstrap_program(void);
+
+		/**
+		 * Save any checkpoints that are due at the current cycle.
+		 */
+		void take_due_checkpoints(void);
+
+		/**
+		 * Build the key under which the transfers for a tick are
+		 * cached. The key holds everything the setup functions for that
+		 * tick base their decisions on: the instructions in the
+		 * pipeline registers, whether the decode stage is stalled, and
+		 * the outcomes of the data-dependent tests (branch conditions
+		 * and set-if-less-than comparisons).
+		 *
+		 * @param key Filled in with the key.
+		 * @param tick Which tick (1 or 2) of the cycle is being set up.
+		 * @param stall_id_phase Whether the decode stage is stalled
+		 *	this cycle.
+		 */
+		void make_tick_key(ScheduleCache::Key &key, int tick,
+			bool stall_id_phase);
+
+		/**
+		 * Decode the instruction in every pipeline register into that
+		 * register's micro-op. Done as a program starts, as a restored
+		 * checkpoint brings its own pipeline contents.
+		 */
+		void decode_pipeline_micro_ops(void);
+
+		/**
+		 * Move the micro-ops down the pipeline along with the IRs that
+		 * the coming tick moves. Called just before the tick, after
+		 * its transfers have been set up.
+		 *
+		 * @param tick Which tick (1 or 2) of the cycle is coming.
+		 * @param stall_id_phase Whether the decode stage is stalled
+		 *	this cycle.
+		 */
+		void advance_micro_ops(int tick, bool stall_id_phase);
+
+		/**
+		 * Execute one cycle of the pipeline: set up (or replay) the
+		 * transfers for both of its ticks, tick the clock twice, and
+		 * print the trace for the instruction that completed.
+		 */
+		void execute_cycle(void);
+
+
+	/***********************************
+	 * Branch prediction functions
+	 ***********************************/
+
+		/**
+		 * Determine whether the instruction in the IF/ID pipeline
+		 * register can be fetched past on a prediction instead of
+		 * being stalled until its operands are ready: a branch, or a
+		 * jump through a register that a target can be predicted for.
+		 *
+		 * @returns True if it can, false otherwise.
+		 */
+		bool can_speculate(void);
+
+		/**
+		 * Decide which way the branch being decoded goes, and whether
+		 * it or the jump through a register being decoded is to be
+		 * fetched past on a prediction. Also trains the predictor on
+		 * the branches and jumps that are resolved in the decode
+		 * stage.
+		 *
+		 * @param stall_id_phase Whether the decode stage is stalled
+		 *	this cycle.
+		 */
+		void predict_id_branch(bool stall_id_phase);
+
+		/**
+		 * Resolve the branch or jump being executed, if it was
+		 * fetched past on a prediction: find out whether the
+		 * prediction was wrong, and train the predictor.
+		 */
+		void resolve_ex_branch(void);
+
+		/**
+		 * Get the value of a general purpose register as seen by the
+		 * instruction in the execute stage, forwarded from the later
+		 * stages as necessary.
+		 *
+		 * @param gpr The number of the register.
+		 * @returns Its value.
+		 */
+		long execute_forwarded_value(unsigned int gpr);
+
+		/**
+		 * Set up the CPU operations for restarting the fetch stage on
+		 * the right path, after the branch or jump in the execute
+		 * stage was mispredicted.
+		 */
+		void execute_redirect(void);
+
+
+	/***********************************
+	 * Instruction fetch functions
+	 ***********************************/
+
+		/**
+		 * Determine if the instruction currently in the IF/ID register
+		 * is a jump instruction.
+		 *
+		 * @returns True if the IF/ID register currently contains a jump
+		 *	instruction, false otherwise.
+		 */
+		bool id_instruction_is_jump(void);
+
+		/**
+		 * Determine if the instruction currently in the IF/ID register
+		 * is a branch instruction whose branch will be taken.
+		 *
+		 * @returns True if the IF/ID register contains a branch
+		 *	instruction, false otherwise.
+		 */
+		bool id_instruction_is_taken_branch(void);
+
+		/**
+		 * Set up the CPU operations for the first tick (of two) in the
+		 * fetch stage for the current cycle. Just loads the value in PC
+		 * into the instruction memory's MAR.
+		 */
+		void fetch_part1(void);
+
+		/**
+		 * Set up the CPU operations for the second tick (of two) in the
+		 * fetch stage for the current cycle. Reads next instruction
+		 * from instruction memory, determines if we are going to
+		 * branch/jump or just move to the next instruction and updates
+		 * the PC accordingly. Forwards PC contents to IF/ID pipeline
+		 * register.
+		 */
+		void fetch_part2(void);
+
+
+	/***********************************
+	 * Instruction decode functions
+	 ***********************************/
+
+		/**
+		 * Set up operations for sign extending the immediate value used
+		 * for a branch offset.
+		 */
+		void decode_sign_extend_branch_offset(void);
+
+		/**
+		 * Within the decode stage, move the contents of the
+		 * instructions 'rs' register (or a forwarded value that will be
+		 * written to that register) into the decode stage temp
+		 * register.
+		 */
+		void decode_load_rs_into_temp(void);
+
+		/**
+		 * Within the decode stage, get the value that should be used
+		 * for the value in the 'rs' register specified by the branch
+		 * instruction. This function may simply pull the value out of
+		 * the register, or may retrieve (forward) it from a later stage
+		 * in the pipeline that is going to update the register
+		 * specified as 'rs' in the branch instruction.
+		 *
+		 * @returns The value contained in the 'rs' register for the
+		 *	instruction in the IF/ID pipeline register.
+		 */
+		long decode_get_branch_rs_value(void);
+
+		/**
+		 * Within the decode stage, get the value that should be used
+		 * for the value in the 'rt' register specified by the branch
+		 * instruction. This function may simply pull the value out of
+		 * the register, or may retrieve (forward) it from a later stage
+		 * in the pipeline that is going to update the register
+		 * specified as 'rt' in the branch instruction.
+		 *
+		 * @returns The value contained in the 'rt' register for the
+		 *	instruction in the IF/ID pipeline register.
+		 */
+		long decode_get_branch_rt_value(void);
+
+		/**
+		 * Determine whether the branch instruction in the IF/ID
+		 * pipeline register will be taken, using forwarded register
+		 * values as necessary.
+		 *
+		 * @returns True if the instruction is a BEQ or BNE whose branch
+		 *	will be taken, false otherwise.
+		 */
+		bool decode_branch_condition(void);
+
+		/**
+		 * Set up the CPU operations for the first tick (of two) in the
+		 * decode stage for the current cycle. Performs necessary
+		 * first-tick operations for instructions that need both ticks.
+		 * This includes branches, jumps, and shifts, that must
+		 * calculate targets, offsets, and extract the contents of the
+		 * 'sh' field, respectively on the first tick.
+		 */
+		void decode_part1(void);
+
+		/**
+		 * Set up the CPU operations for the second tick (of two) in the
+		 * decode stage for the current cycle. Loads the contents of
+		 * 'rs' and 'rt' registers into A and B registers, perform sign
+		 * or zero extension of immediate fields, and finish calculating
+		 * branch and jump destinations, among other things.
+		 */
+		void decode_part2(void);
+
+
+	/***********************************
+	 * Instruction execute functions
+	 ***********************************/
+
+		/**
+		 * Determine what general purpose register (if any) is going to
+		 * be written to by the instruction currently in the EX/MEM
+		 * pipeline register.
+		 *
+		 * @return The index number of the GPR that will be written, or
+		 *	0 if no GPR will be written by the instruction (note
+		 *	that GPR 0 cannot have its value overwritten, so
+		 *	returning 0 for "no write" does not interfere with the
+		 *	results).
+		 */
+		long gpr_written_by_mem_stage_instruction(void);
+
+		/**
+		 * Determine what general purpose register (if any) is going to
+		 * be written to by the instruction currently in the MEM/WB
+		 * pipeline register.
+		 *
+		 * @return The index number of the GPR that will be written, or
+		 *	0 if no GPR will be written by the instruction (note
+		 *	that GPR 0 cannot have its value overwritten, so
+		 *	returning 0 for "no write" does not interfere with the
+		 *	results).
+		 */
+		long gpr_written_by_wb_stage_instruction(void);
+
+		/**
+		 * Set up the CPU operations for the first tick (of two) in the
+		 * execute stage for the current cycle. The first tick of the
+		 * execute stage is dedicated entirely to forwarding, and pulls
+		 * in result values from the EX/MEM and MEM/WB pipeline
+		 * registers into the ID/EX pipeline register for use in
+		 * execution, as needed.
+		 */
+		void execute_part1(void);
+
+		/**
+		 * Perform the setup common to the execution of all ALU
+		 * immediate instructions. Sets ALU inputs and outputs (leaving
+		 * the caller to only specify an operation to perform).
+		 */
+		void execute_alu_immediate_common(void);
+
+		/**
+		 * Perform the setup common to the execution of all
+		 * register-register ALU instructions. Sets ALU inputs and
+		 * outputs (leaving the caller to only specify an operation to
+		 * perform).
+		 */
+		void execute_alu_register_common(void);
+
+		/**
+		 * Perform the setup common to the execution of all shift
+		 * instructions. Sets SLU inputs and outputs (leaving the caller
+		 * to only specify an operation to perform).
+		 */
+		void execute_shift_common(void);
+
+		/**
+		 * Compare the operands of the set-if-less-than instruction in
+		 * the ID/EX pipeline register (signed for SLT and SLTI,
+		 * unsigned for SLTU).
+		 *
+		 * @returns True if the first operand is less than the second.
+		 */
+		bool execute_less_than(void);
+
+		/**
+		 * Set up the CPU operations for the second tick (of two) in the
+		 * execute stage for the current cycle.
+		 * Forwards data from ID/EX pipeline register to EX/MEM pipeline
+		 * register, performs ALU operations and other calculations.
+		 */
+		void execute_part2(void);
+
+
+	/***********************************
+	 * Instruction memory functions
+	 ***********************************/
+
+		/**
+		 * Set up the CPU operations for the first tick (of two) in the
+		 * memory stage for the current cycle. The first tick of the
+		 * memory stage just loads the data memory address into the data
+		 * memory MAR for load and store instructions. No operations are
+		 * performed for any other instruction types.
+		 */
+		void memory_part1(void);
+
+		/**
+		 * Set up the CPU operations for the second tick (of two) in the
+		 * memory stage for the current cycle. The second tick of the
+		 * memory stage forwards the contents of the EX/MEM pipeline
+		 * register to the MEM/WB pipeline register (if necessary) and
+		 * performs memory reads/writes for load/store instructions.
+		 */
+		void memory_part2(void);
+
+
+	/***********************************
+	 * Instruction writeback functions
+	 ***********************************/
+
+		/**
+		 * Set up the CPU operations for the first tick (of two) in the
+		 * writeback stage for the current cycle. Tick 1 of the
+		 * writeback stage forwards results to the post-writeback
+		 * pipeline register (for instructions tracing), writes retuls
+		 * values into GPRs. Halting on invalid, unimplemented, or halt
+		 * instructions is decided by 'wb_instruction_halts', since it
+		 * is not a transfer and so cannot be replayed.
+		 */
+		void writeback_part1(void);
+
+		/**
+		 * Set up the operations needed to write a result value to the
+		 * specified general purpose register.
+		 *
+		 * @param gpr_num The index in the register file of the GPR to
+		 *	write to.
+		 * @param src The source register for the data to be written to
+		 *	the GPR. Must be connected to 'wb_register_write_bus'
+		 *	input.
+		 */
+		void writeback_to_GPR(int gpr_num, StorageObject &src);
+
+		/**
+		 * Set up the CPU operations for the second tick (of two) in the
+		 * writeback stage for the current cycle. No operations are
+		 * performed on the second tick for the writeback stage. This
+		 * function is left as a placeholder.
+		 */
+		void writeback_part2(void);
+
+		/**
+		 * Determine whether the instruction in the MEM/WB pipeline
+		 * register halts the CPU when it reaches the writeback stage
+		 * (halt, invalid, and unimplemented instructions).
+		 *
+		 * @returns True if the CPU halts this cycle, false otherwise.
+		 */
+		bool wb_instruction_halts(void);
+
+		/**
+		 * Determine whether an instruction halts the CPU (halt,
+		 * invalid, and unimplemented instructions).
+		 *
+		 * @param instruction The instruction to test.
+		 * @returns True if the instruction halts the CPU, false
+		 *	otherwise.
+		 */
+		bool instruction_halts(z11::op instruction);
+
+	/***********************************
+	 * Instruction tracing functions
+	 ***********************************/
+
+		/**
+		 * Get the current contents of a general purpose register, from
+		 * wherever the program is keeping them.
+		 *
+		 * @param gpr The number of the register.
+		 * @returns The register's contents.
+		 */
+		long gpr_value(unsigned int gpr);
+
+		/**
+		 * Print a general purpose register's name and contents, the
+		 * way the arch library prints a register.
+		 *
+		 * @param gpr The number of the register.
+		 */
+		void print_gpr(unsigned int gpr);
+
+		/**
+		 * Put a space and a general purpose register's name and
+		 * contents (in hex) into a line being built, as print_gpr()
+		 * would print them.
+		 *
+		 * @param p Where in the line to put them.
+		 * @param gpr The number of the register.
+		 * @returns The position after them.
+		 */
+		char *put_gpr(char *p, unsigned int gpr);
+
+		/**
+		 * Print any non-zero general purpose registers, up to 4 per
+		 * line. Used for executing break instructions.
+		 */
+		void print_break_information(void);
+
+		/**
+		 * Print out the details of the instruction that most recently
+		 * completed the writeback stage. Also print halt messages if
+		 * necessary.
+		 */
+		void print_execution_record(void);
+
+		/**
+		 * Hold the whole pipeline, ticking the clock with nothing
+		 * moving, for as many cycles as the accesses the fetch and
+		 * memory stages are about to make need: until a memory with
+		 * latency is ready to complete one, or until the lines missed
+		 * in a cache are loaded. The cycles are counted in the CPI
+		 * stack as they go.
+		 *
+		 * @param stall_id_phase Whether the decode stage (and so the
+		 *	fetch stage) is stalled this cycle.
+		 */
+		void wait_for_memory(bool stall_id_phase);
+
+		/**
+		 * If loads are non-blocking and the memory stage is about to
+		 * make one that has to wait for memory, put it in an MSHR
+		 * (holding the pipeline, as wait_for_memory() does, until
+		 * one is free) and note when the register it writes can be
+		 * used.
+		 */
+		void issue_non_blocking_load(void);
+
+		/**
+		 * Find out how long an access the memory stage is about to
+		 * make through the data cache has to wait: for the lines it
+		 * misses in, or for a prefetch of its line still on its way.
+		 *
+		 * @param address The address of the access.
+		 * @param storing Whether it is a store.
+		 * @returns The ticks to wait.
+		 */
+		int data_cache_wait(uint32_t address, bool storing);
+
+		/**
+		 * If there is a prefetcher, show it the load or store the
+		 * memory stage is about to make, and keep the addresses it
+		 * predicts.
+		 */
+		void train_prefetcher(void);
+
+		/**
+		 * Prefetch the addresses the prefetcher predicted this cycle
+		 * into the data cache, once the memory stage's own access is
+		 * made, and note when each line arrives.
+		 */
+		void issue_prefetches(void);
+
+		/**
+		 * Count the cycle just executed in the CPI stack and the
+		 * execution profile, by what left the writeback stage in it.
+		 */
+		void count_cycle(void);
+
+		/**
+		 * Print the trace line for an instruction that has just
+		 * finished executing, and the halt message if it halted the
+		 * CPU.
+		 *
+		 * @param pc The address the instruction was fetched from.
+		 * @param word The instruction.
+		 * @param uop The instruction, decoded.
+		 */
+		void print_instruction_record(unsigned long pc,
+			unsigned long word, const micro_op &uop);
+
+
+	/***********************************
+	 * Stalling functions              *
+	 ***********************************/
+
+		/**
+		 * Determine if the instruction currently in the IF/ID pipeline
+		 * register will need to be stalled because it uses the value
+		 * stored in a register that will be written by a load
+		 * instruction currently in the ID/EX pipeline register.
+		 *
+		 * @return True if we must stall for this reason, false
+		 *	otherwise.
+		 */
+		bool must_stall_id_phase_due_to_load_in_idex_register(void);
+
+		/**
+		 * Determine if the instruction currently in the IF/ID pipeline
+		 * register will need to be stalled because it uses the value
+		 * stored in a register that will be written by a load
+		 * instruction currently in the EX/MEM pipeline register. In
+		 * particular, instructions that use the value of a register
+		 * within the decode stage (branches, jumps, etc.) will need to
+		 * wait if they pull from a register that will be written to by
+		 * a load instruction in the memory stage.
+		 *
+		 * @return True if we must stall for this reason, false
+		 *	otherwise.
+		 */
+		bool must_stall_id_phase_due_to_load_in_exmem_register(void);
+
+		/**
+		 * Determine what general purpose register (if any) is going to
+		 * be written to by the instruction currently in the ID/EX
+		 * pipeline register.
+		 *
+		 * @return The index number of the GPR that will be written, or
+		 *	0 if no GPR will be written by the instruction (note
+		 *	that GPR 0 cannot have its value overwritten, so
+		 *	returning 0 for "no write" does not interfere with the
+		 *	resutls).
+		 */
+		long gpr_written_by_ex_stage_instruction(void);
+
+		/**
+		 * Determine if the instruction currently in the IF/ID pipeline
+		 * register will need to be stalled because it uses the value
+		 * stored in a register that will be written by an instruction
+		 * (of any type) currently in the ID/EX pipeline register. In
+		 * particular, instructions like branches and jumps, that use
+		 * value they retrieve in the decode stage, will need to wait if
+		 * the value they need to retrieve is currently being calculated
+		 * by an instruction in the execute stage.
+		 *
+		 * @return True if we must stall for this reason, false
+		 *	otherwise.
+		 */
+		bool must_stall_id_phase_to_use_result_in_id_phase(void);
+
+		/**
+		 * Determine if the instruction currently in the IF/ID pipeline
+		 * register will need to be stalled because it uses or writes
+		 * a register that an outstanding non-blocking load writes, or
+		 * because it is a BREAK or halt and any loads are outstanding
+		 * (so that the registers it prints are the ones loaded).
+		 *
+		 * @return True if we must stall for this reason, false
+		 *	otherwise.
+		 */
+		bool must_stall_id_phase_for_pending_load(void);
+
+		/**
+		 * Determine if the instruction in the IF/ID pipeline register
+		 * must be stalled (delayed from entering the decode stage).
+		 * Also records why in 'id_stall_cause'.
+		 *
+		 * @returns True if the instruction must be stalled, false
+		 *	otherwise.
+		 */
+		bool must_stall_id_phase(void);
+
+		/**
+		 * Perform the setup necessary to insert a NOP instruction with
+		 * the correct source address into the ID/EX pipeline register.
+		 * Doing this fills the gap created by stalling an instruction
+		 * from entering the decode stage.
+		 */
+		void insert_nop_into_idex_reg(void);
+
+
+	/***********************************
+	 * Functional execution functions
+	 ***********************************/
+
+		/**
+		 * Execute one instruction on the flat GPRs and the memories.
+		 *
+		 * @param pc The address the instruction was fetched from.
+		 * @param word The instruction.
+		 * @param uop The instruction, decoded.
+		 * @param target Set to the address of the instruction to
+		 *	execute after the one in this instruction's delay
+		 *	slot, if this instruction is a taken branch or a jump;
+		 *	left alone otherwise.
+		 */
+		void execute_functional(uint32_t pc, uint32_t word,
+			const micro_op &uop, uint32_t &target);
+
+		/**
+		 * Execute the next instruction functionally, and print its
+		 * trace.
+		 */
+		void step_functional(void);
+
+		/**
+		 * Start executing functionally from the state the pipeline
+		 * components hold: copy the GPRs, and continue from the PC.
+		 * The pipeline must hold no instructions.
+		 */
+		void enter_functional(void);
+
+		/**
+		 * Hand the state of the functional run over to the pipeline
+		 * components: the GPRs, and the PC. The pipeline must hold no
+		 * instructions, and the next instruction must not be in a
+		 * delay slot.
+		 */
+		void enter_pipeline(void);
+
+		/**
+		 * Determine whether any pipeline register before the post-WB
+		 * one holds a valid instruction.
+		 *
+		 * @returns True if the pipeline holds instructions, false if
+		 *	it is empty.
+		 */
+		bool pipeline_holds_instructions(void);
+
+		/**
+		 * Run the pipeline until it holds no instructions, fetching
+		 * nothing more, so that the program can continue
+		 * functionally.
+		 */
+		void drain_pipeline(void);
+};
 
 #endif // _RUN_PROGRAM_H_
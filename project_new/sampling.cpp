@@ -0,0 +1,513 @@
+/**
+ * Source file for "sampling" module that plans sampled simulations, where
+ * most of a program is executed functionally and only some windows of it
+ * through the pipeline, and estimates the whole program's CPI and cycle
+ * count from what those windows measured.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+//C++ includes
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+//local project includes
+#include "sampling.h"
+#include "run_program.h"
+#include "components.h"
+#include "instruction_decode.h"
+
+//the most k-means iterations to group intervals with
+const int MAX_KMEANS_ITERATIONS = 100;
+
+
+/***********************************
+ * Function implementations        *
+ ***********************************/
+
+/**
+ * Get the squared distance between two basic block vectors.
+ *
+ * @param a One vector.
+ * @param b The other vector.
+ * @returns The sum of the squares of the differences of their elements.
+ */
+static double distance(const block_vector &a, const block_vector &b) {
+	double sum = 0;
+
+	for(unsigned int i = 0; i < BLOCK_VECTOR_SIZE; ++i) {
+		sum += (a[i] - b[i]) * (a[i] - b[i]);
+	}
+
+	return sum;
+}
+
+/**
+ * Get the value of Student's t distribution that a two-sided 95% confidence
+ * interval extends to.
+ *
+ * @param freedom The degrees of freedom (at least 1).
+ * @returns The value.
+ */
+static double student_t_95(unsigned long freedom) {
+	static const double t[] = {
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+		2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+		2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+		2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+	};
+	const unsigned long size = sizeof(t) / sizeof(t[0]);
+
+	//beyond the table, the normal distribution is close enough
+	return (freedom <= size) ? t[freedom - 1] : 1.960;
+}
+
+sampling_plan periodic_plan(unsigned long period, unsigned long warmup,
+	unsigned long length) {
+	sampling_plan plan;
+
+	plan.warmup = warmup;
+	plan.length = length;
+	plan.period = period;
+
+	return plan;
+}
+
+sampling_plan simpoint_plan(const std::vector<block_vector> &intervals,
+	unsigned int clusters, unsigned long warmup, unsigned long length) {
+	sampling_plan plan;
+	const unsigned long n = intervals.size();
+
+	plan.warmup = warmup;
+	plan.length = length;
+	plan.period = 0;
+
+	if(n == 0) {
+		return plan;
+	}
+
+	/* start from centers spread as far apart as possible, the first
+		being the first interval */
+	std::vector<block_vector> centers(1, intervals[0]);
+	std::vector<double> nearest(n);
+	for(unsigned long i = 0; i < n; ++i) {
+		nearest[i] = distance(intervals[i], centers[0]);
+	}
+
+	while(centers.size() < clusters) {
+		unsigned long farthest = 0;
+		for(unsigned long i = 1; i < n; ++i) {
+			if(nearest[i] > nearest[farthest]) {
+				farthest = i;
+			}
+		}
+
+		//every interval is already a center's double
+		if(nearest[farthest] == 0) {
+			break;
+		}
+
+		centers.push_back(intervals[farthest]);
+		for(unsigned long i = 0; i < n; ++i) {
+			nearest[i] = std::min(nearest[i],
+				distance(intervals[i], centers.back()));
+		}
+	}
+
+	//k-means: move each center to the mean of the intervals nearest it
+	const unsigned int k = centers.size();
+	std::vector<unsigned int> cluster(n, k);
+	for(int iteration = 0; iteration < MAX_KMEANS_ITERATIONS;
+		++iteration) {
+		bool changed = false;
+
+		for(unsigned long i = 0; i < n; ++i) {
+			unsigned int best = 0;
+			for(unsigned int c = 1; c < k; ++c) {
+				if(distance(intervals[i], centers[c]) <
+					distance(intervals[i], centers[best])) {
+					best = c;
+				}
+			}
+
+			if(cluster[i] != best) {
+				cluster[i] = best;
+				changed = true;
+			}
+		}
+
+		if(!changed) {
+			break;
+		}
+
+		//a center nothing is nearest stays where it is
+		std::vector<block_vector> sums(k);
+		std::vector<unsigned long> sizes(k, 0);
+		for(unsigned int c = 0; c < k; ++c) {
+			sums[c].fill(0);
+		}
+		for(unsigned long i = 0; i < n; ++i) {
+			for(unsigned int d = 0; d < BLOCK_VECTOR_SIZE; ++d) {
+				sums[cluster[i]][d] += intervals[i][d];
+			}
+			sizes[cluster[i]]++;
+		}
+		for(unsigned int c = 0; c < k; ++c) {
+			if(sizes[c]) {
+				for(unsigned int d = 0; d < BLOCK_VECTOR_SIZE;
+					++d) {
+					centers[c][d] = sums[c][d] / sizes[c];
+				}
+			}
+		}
+	}
+
+	/* each cluster that has intervals is a stratum, measured by the two
+		intervals nearest its center (two, so that the spread within
+		it can be estimated) */
+	for(unsigned int c = 0; c < k; ++c) {
+		std::vector<std::pair<double, unsigned long>> members;
+		for(unsigned long i = 0; i < n; ++i) {
+			if(cluster[i] == c) {
+				members.push_back(std::make_pair(
+					distance(intervals[i], centers[c]), i));
+			}
+		}
+
+		if(members.empty()) {
+			continue;
+		}
+
+		std::sort(members.begin(), members.end());
+		const unsigned int stratum = plan.stratum_sizes.size();
+		for(unsigned int m = 0; (m < 2) && (m < members.size()); ++m) {
+			plan.windows.push_back({members[m].second * length,
+				stratum});
+		}
+		plan.stratum_sizes.push_back(members.size());
+	}
+
+	std::sort(plan.windows.begin(), plan.windows.end(),
+		[](const sample_window &a, const sample_window &b) {
+			return a.start < b.start;
+		});
+
+	return plan;
+}
+
+sampling_estimate estimate_cpi(const sampling_plan &plan,
+	const std::vector<window_measurement> &windows,
+	unsigned long instructions) {
+	sampling_estimate estimate = {instructions, 0, 0, true};
+
+	//periodic sampling draws from the one stratum, the whole program
+	unsigned int strata = plan.period ? 1 : plan.stratum_sizes.size();
+	std::vector<unsigned long> measured(strata, 0);
+	std::vector<double> sums(strata, 0);
+	std::vector<double> squares(strata, 0);
+
+	for(const window_measurement &w : windows) {
+		double cpi = (double)w.cycles / w.instructions;
+
+		measured[w.stratum]++;
+		sums[w.stratum] += cpi;
+		squares[w.stratum] += cpi * cpi;
+	}
+
+	/* the number of intervals in each stratum, and in the strata that
+		were measured (a window the program halted before reaching
+		isn't) */
+	std::vector<double> sizes(strata);
+	double total = 0;
+	for(unsigned int h = 0; h < strata; ++h) {
+		if(plan.period) {
+			sizes[h] = std::max((double)measured[h],
+				std::ceil((double)instructions / plan.length));
+		}
+		else {
+			sizes[h] = plan.stratum_sizes[h];
+		}
+
+		if(measured[h]) {
+			total += sizes[h];
+		}
+	}
+
+	if(total == 0) {
+		estimate.has_error = false;
+		return estimate;
+	}
+
+	double variance = 0;
+	unsigned long freedom = 0;
+	for(unsigned int h = 0; h < strata; ++h) {
+		const double n = measured[h];
+		if(n == 0) {
+			continue;
+		}
+
+		const double weight = sizes[h] / total;
+		const double mean = sums[h] / n;
+		estimate.cpi += weight * mean;
+
+		//a stratum measured in full has no sampling error
+		if(n >= sizes[h]) {
+			continue;
+		}
+
+		//nor can the error of one measured by a single window be found
+		if(n < 2) {
+			estimate.has_error = false;
+			continue;
+		}
+
+		double spread = std::max(0.0,
+			(squares[h] - (n * mean * mean)) / (n - 1));
+		variance += weight * weight * (1 - (n / sizes[h])) * spread / n;
+		freedom += n - 1;
+	}
+
+	if(estimate.has_error && freedom) {
+		estimate.cpi_error = student_t_95(freedom) * std::sqrt(variance);
+	}
+
+	return estimate;
+}
+
+void print_sampling_report(std::ostream &out, const sampling_plan &plan,
+	const std::vector<window_measurement> &windows,
+	const sampling_estimate &estimate) {
+	std::ios_base::fmtflags old = out.flags();
+	unsigned long instructions = 0;
+	unsigned long cycles = 0;
+
+	for(const window_measurement &w : windows) {
+		instructions += w.instructions;
+		cycles += w.cycles;
+	}
+
+	out << std::dec << std::endl << "Sampled simulation: ";
+	if(plan.period) {
+		out << "a window every " << plan.period << " instructions";
+	}
+	else {
+		out << plan.stratum_sizes.size() << " clusters of " <<
+			plan.length << "-instruction intervals";
+	}
+	out << ", " << plan.warmup << " instructions of warm-up and " <<
+		plan.length << " measured in each" << std::endl;
+
+	//how each cluster of intervals measured
+	if(!plan.period) {
+		for(unsigned int h = 0; h < plan.stratum_sizes.size(); ++h) {
+			out << "  cluster " << h << ": " <<
+				plan.stratum_sizes[h] << " interval" <<
+				((plan.stratum_sizes[h] == 1) ? "" : "s") <<
+				", CPI";
+			for(const window_measurement &w : windows) {
+				if(w.stratum == h) {
+					out << " " << std::fixed <<
+						std::setprecision(4) <<
+						(double)w.cycles /
+						w.instructions;
+				}
+			}
+			out << std::endl;
+		}
+	}
+
+	out << "Program instructions: " << estimate.instructions << std::endl <<
+		"Measured in detail:   " << instructions << " instructions, " <<
+		cycles << " cycles, in " << windows.size() << " windows" <<
+		std::endl;
+
+	out << std::fixed << std::setprecision(4) << "Estimated CPI:        " <<
+		estimate.cpi;
+	if(estimate.has_error) {
+		out << " +/- " << estimate.cpi_error << " (95% confidence)";
+	}
+	else {
+		out << " (too few windows for a confidence interval)";
+	}
+	out << std::endl;
+
+	out << std::setprecision(0) << "Estimated cycles:     " <<
+		estimate.cpi * estimate.instructions;
+	if(estimate.has_error) {
+		out << " +/- " << estimate.cpi_error * estimate.instructions;
+	}
+	out << std::endl;
+
+	(void)out.flags(old);
+}
+
+std::vector<window_measurement> z88_cpu::run_sampled(
+	const sampling_plan &plan) {
+	std::vector<window_measurement> measured;
+
+	//the clock and static interfaces below act on this z88
+	context.makeCurrent();
+	tracing = false;
+
+	//the entry point comes through the PC, as for the pipeline
+	bootstrap_program();
+	enter_functional();
+
+	for(unsigned int i = 0; !halted; ++i) {
+		sample_window window;
+
+		if(plan.period) {
+			window.start = plan.warmup + (i * plan.period);
+			window.stratum = 0;
+		}
+		else if(i < plan.windows.size()) {
+			window = plan.windows[i];
+		}
+		else {
+			break;
+		}
+
+		/* fast-forward to the warm-up (or as near as it can be got,
+			if the last window ran past it), stopping outside any
+			delay slot, which the pipeline can't start in */
+		unsigned long detailed_from = (window.start > plan.warmup) ?
+			(window.start - plan.warmup) : 0;
+		while(!halted &&
+			((program_instructions_executed() < detailed_from) ||
+			(functional_next_pc != functional_pc + 4))) {
+			step_functional();
+		}
+
+		if(halted) {
+			break;
+		}
+
+		//warm up the pipeline, then measure
+		enter_pipeline();
+		while(!halted && (program_instructions_executed() <
+			window.start)) {
+			execute_cycle();
+		}
+
+		window_measurement m;
+		m.start = program_instructions_executed();
+		m.stratum = window.stratum;
+		unsigned long first_cycle = cycles_executed();
+
+		while(!halted && (program_instructions_executed() <
+			m.start + plan.length)) {
+			execute_cycle();
+		}
+
+		m.instructions = program_instructions_executed() - m.start;
+		m.cycles = cycles_executed() - first_cycle;
+		if(m.instructions) {
+			measured.push_back(m);
+		}
+
+		//finish what is in the pipeline, and carry on functionally
+		drain_pipeline();
+		enter_functional();
+	}
+
+	//the rest of the program
+	while(!halted) {
+		step_functional();
+	}
+
+	tracing = true;
+	return measured;
+}
+
+std::vector<block_vector> z88_cpu::profile_intervals(unsigned long length) {
+	std::vector<block_vector> intervals;
+	block_vector counts;
+	unsigned long executed = 0;
+
+	//the clock and static interfaces below act on this z88
+	context.makeCurrent();
+	tracing = false;
+
+	//the entry point comes through the PC, as for the pipeline
+	bootstrap_program();
+	enter_functional();
+
+	//the address the current basic block started at
+	uint32_t block = functional_pc;
+	uint32_t last_pc = functional_pc - 4;
+
+	counts.fill(0);
+	while(!halted) {
+		//a basic block starts wherever control was transferred to
+		if(functional_pc != last_pc + 4) {
+			block = functional_pc;
+		}
+		last_pc = functional_pc;
+
+		//spread the blocks across the buckets by their addresses
+		counts[(((block >> 2) * 2654435761u) >> 16) %
+			BLOCK_VECTOR_SIZE] += 1;
+		step_functional();
+
+		//an interval is over, or the program is
+		if((++executed == length) || halted) {
+			for(double &count : counts) {
+				count /= executed;
+			}
+
+			intervals.push_back(counts);
+			counts.fill(0);
+			executed = 0;
+		}
+	}
+
+	tracing = true;
+	return intervals;
+}
+
+void z88_cpu::enter_pipeline(void) {
+	functional = false;
+	squashed_for.clear();
+	profile.break_flow();
+
+	/* loads and prefetches outstanding in the last window have long
+		since completed */
+	for(mshr &entry : mshrs) {
+		entry.ready = 0;
+	}
+	register_ready.fill(0);
+	mshr_busy_until = 0;
+	if(prefetcher) {
+		prefetcher->forget_in_flight();
+	}
+	for(unsigned int i = 0; i < NUM_GPRS; ++i) {
+		GPR(i).poke(functional_gprs[i]);
+	}
+
+	if_r.pc.poke(functional_pc);
+}
+
+bool z88_cpu::pipeline_holds_instructions(void) {
+	return (ifid_r.valid.value() || idex_r.valid.value() ||
+		exmem_r.valid.value() || memwb_r.valid.value());
+}
+
+void z88_cpu::drain_pipeline(void) {
+	/* a branch or jump about to be decoded redirects the fetch stage
+		once its delay slot has been fetched, so let it */
+	while(!halted && ifid_r.valid.value() &&
+		(ifid_r.uop.classes & (z11::BRANCH | z11::JUMP))) {
+		execute_cycle();
+	}
+
+	//then fetch nothing more, leaving the PC at the next instruction
+	draining = true;
+	while(!halted && pipeline_holds_instructions()) {
+		execute_cycle();
+	}
+	draining = false;
+}
@@ -0,0 +1,127 @@
+/**
+ * Header file for "sampling" module that plans sampled simulations, where
+ * most of a program is executed functionally and only some windows of it
+ * through the pipeline, and estimates the whole program's CPI and cycle
+ * count from what those windows measured.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+#ifndef _SAMPLING_H_
+#define _SAMPLING_H_
+
+//C++ includes
+#include <iostream>
+#include <vector>
+#include <array>
+
+/* the number of buckets the basic blocks of a program are hashed into when
+	profiling which code each interval of it runs */
+const unsigned int BLOCK_VECTOR_SIZE = 32;
+
+/* the fraction of an interval's instructions spent in each bucket of basic
+	blocks */
+typedef std::array<double, BLOCK_VECTOR_SIZE> block_vector;
+
+//a window of a program to measure in detail
+struct sample_window {
+	//the program instruction at which measurement starts
+	unsigned long start;
+	//which stratum (group of similar intervals) it was drawn from
+	unsigned int stratum;
+};
+
+//where a sampled simulation measures
+struct sampling_plan {
+	//instructions executed in detail before each measurement starts
+	unsigned long warmup;
+	//instructions measured in each window
+	unsigned long length;
+	/* for periodic sampling, the instructions from the start of one
+		window to the start of the next; 0 if 'windows' is used */
+	unsigned long period;
+	//otherwise, the windows, in program order
+	std::vector<sample_window> windows;
+	//for each stratum, the number of intervals of the program in it
+	std::vector<unsigned long> stratum_sizes;
+};
+
+//what one window of detailed simulation measured
+struct window_measurement {
+	//the program instruction at which measurement started
+	unsigned long start;
+	//which stratum the window was drawn from
+	unsigned int stratum;
+	//the program instructions and cycles measured
+	unsigned long instructions;
+	unsigned long cycles;
+};
+
+//a whole program's performance, estimated from a sampled simulation
+struct sampling_estimate {
+	//the program instructions executed
+	unsigned long instructions;
+	//the estimated CPI, and half the width of its 95% confidence interval
+	double cpi;
+	double cpi_error;
+	//whether there were enough windows to find a confidence interval
+	bool has_error;
+};
+
+/**
+ * Plan to measure a window every so many instructions.
+ *
+ * @param period The instructions from the start of one window to the start
+ *	of the next. Should be more than the warm-up and length together.
+ * @param warmup The instructions executed in detail before each window.
+ * @param length The instructions measured in each window.
+ * @returns The plan.
+ */
+sampling_plan periodic_plan(unsigned long period, unsigned long warmup,
+	unsigned long length);
+
+/**
+ * Plan to measure the intervals that best represent the rest, in the way
+ * of SimPoint: group the intervals whose basic block vectors are alike into
+ * the given number of clusters (k-means), and measure the (up to two)
+ * intervals nearest the center of each. Each cluster is a stratum.
+ *
+ * @param intervals The basic block vector of each interval of the program.
+ * @param clusters The number of clusters to group the intervals into.
+ * @param warmup The instructions executed in detail before each window.
+ * @param length The instructions in each interval, all of which are
+ *	measured.
+ * @returns The plan.
+ */
+sampling_plan simpoint_plan(const std::vector<block_vector> &intervals,
+	unsigned int clusters, unsigned long warmup, unsigned long length);
+
+/**
+ * Estimate a program's CPI, with a confidence interval, from the windows
+ * measured by a sampled simulation. The windows of each stratum are taken as
+ * a random sample of its intervals, and the strata are weighted by their
+ * sizes.
+ *
+ * @param plan The plan the windows were measured by.
+ * @param windows What each window measured.
+ * @param instructions The program instructions executed in all.
+ * @returns The estimate.
+ */
+sampling_estimate estimate_cpi(const sampling_plan &plan,
+	const std::vector<window_measurement> &windows,
+	unsigned long instructions);
+
+/**
+ * Print a report of a sampled simulation: how it was sampled, what the
+ * windows measured, and the extrapolated CPI and cycle count.
+ *
+ * @param out Where to print the report.
+ * @param plan The plan the windows were measured by.
+ * @param windows What each window measured.
+ * @param estimate The estimate made from them.
+ */
+void print_sampling_report(std::ostream &out, const sampling_plan &plan,
+	const std::vector<window_measurement> &windows,
+	const sampling_estimate &estimate);
+
+#endif // _SAMPLING_H_
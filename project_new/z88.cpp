@@ -8,27 +8,268 @@
 //C++ includes
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+//arch library includes
+#include <Clock.h>
+#include <Checkpoint.h>
+#include <BinaryTraceSink.h>
+#include <ProgramImage.h>
 
 //local project includes
-#include "connections.h"
 #include "components.h"
 #include "run_program.h"
+#include "sampling.h"
+#include "options.h"
+
+/**
+ * Print the command line usage of the z88.
+ *
+ * @param prog The name the z88 was run as.
+ */
+void usage(const char *prog) {
+	std::cout << "Usage: " << prog << " [-t | -T <file>]" <<
+		" [-s <cycle> <file>]... [-i <cycle> <file>]... [-r <file>]" <<
+		" [-b <predictor>]" << std::endl <<
+		"         [-I <cache>] [-D <cache> [-F <prefetcher>]]" <<
+		" [-L <latency>]... [-M <dram>]" << std::endl <<
+		"         [-N <mshrs>] [-c] [-P] [-a <file>]" <<
+		" <path_to_object_file>" << std::endl <<
+		"       " << prog << " -f <path_to_object_file>" << std::endl <<
+		"       " << prog << " -p <period> | -k <clusters>" <<
+		" [-w <warm-up>] [-l <length>] [-b <predictor>]" <<
+		std::endl << "         [-I <cache>]" <<
+		" [-D <cache> [-F <prefetcher>]] [-L <latency>]..." <<
+		" [-M <dram>]" << std::endl <<
+		"         [-N <mshrs>] <path_to_object_file>" << std::endl <<
+		"  -t  trace every transfer to the standard output" <<
+		std::endl <<
+		"  -T  trace every transfer to a binary trace file" <<
+		std::endl <<
+		"  -s  save a checkpoint after <cycle> cycles (not with -b," <<
+		" -F or -N)" << std::endl <<
+		"  -i  as -s, but only save memory changed since the" <<
+		" previous checkpoint" << std::endl <<
+		"  -r  continue from a saved checkpoint (not with -b, -F or" <<
+		" -N)" << std::endl <<
+		"  -f  run instruction by instruction, without the pipeline:" <<
+		" the same" << std::endl <<
+		"      instruction trace, much sooner, but no cycle timing" <<
+		std::endl <<
+		"  -p  run as -f, but through the pipeline for a window of" <<
+		" <length>" << std::endl <<
+		"      instructions every <period>, and estimate the cycles" <<
+		" taken" << std::endl <<
+		"  -k  as -p, but measure the <length>-instruction intervals" <<
+		" that best" << std::endl <<
+		"      represent <clusters> groups of similar ones" <<
+		" (SimPoint-style)" << std::endl <<
+		"  -w  instructions through the pipeline before each window" <<
+		" (default 1000)" << std::endl <<
+		"  -l  instructions measured in each window (default 1000)" <<
+		std::endl <<
+		"  -b  fetch past branches and jumps that would stall, on a" <<
+		" prediction by" << std::endl <<
+		"      <predictor> (not-taken, bimodal or gshare) and a" <<
+		" BTB and RAS" << std::endl <<
+		"  -c  print a CPI stack at the end: what every cycle was" <<
+		" spent on, and" << std::endl <<
+		"      the instructions that stalled most" << std::endl <<
+		"  -I  fetch instructions through a cache, given as" <<
+		" <size>:<line>:<ways>" << std::endl <<
+		"      [:lru|plru|random[:wb|wt[:<miss cycles>]]], sizes in" <<
+		" bytes (default" << std::endl <<
+		"      LRU, write-back, 10 cycles a miss)" << std::endl <<
+		"  -D  load and store through a data cache, given as for -I" <<
+		std::endl <<
+		"  -F  prefetch into the data cache for loads and stores that" <<
+		" keep to a" << std::endl <<
+		"      stride, given as <degree>:<distance>[:<entries>]: the" <<
+		" lines to" << std::endl <<
+		"      prefetch, how many strides ahead, and the entries in" <<
+		" the table of" << std::endl <<
+		"      strides (default 64)" << std::endl <<
+		"  -L  make memory accesses take <cycles> more, given as" <<
+		" <cycles> or" << std::endl <<
+		"      <first>-<last>:<cycles> for a range of addresses" <<
+		" (the last given" << std::endl <<
+		"      wins where ranges overlap)" << std::endl <<
+		"  -M  put the memories in a banked DRAM, given as" <<
+		" <banks>:<row>:<tRCD>:<tCAS>:" << std::endl <<
+		"      <tRP>[:open|closed], the row size in bytes and the" <<
+		" times in cycles" << std::endl <<
+		"      (default open page)" << std::endl <<
+		"  -N  let loads that wait on memory go on without their" <<
+		" data, in up to" << std::endl <<
+		"      <mshrs> (at most " << MAX_MSHRS << ") miss-status" <<
+		" holding registers, stalling only" << std::endl <<
+		"      their users" << std::endl <<
+		"  -P  print an execution profile at the end: the hottest" <<
+		" basic blocks and" << std::endl <<
+		"      instructions, branch outcomes, and the call graph" <<
+		std::endl <<
+		"  -a  name addresses in the CPI stack and profile with the" <<
+		" labels of" << std::endl <<
+		"      assembly source <file> (by default, the image's" <<
+		" symbols, or those of" << std::endl <<
+		"      the .asm file beside the object file)" << std::endl;
+}
 
 int main(int argc, char *argv[]) {
-	if(argc != 2) {
-		std::cout << "Usage: " << argv[0] <<
-			" <path_to_object_file>" << std::endl;
+	/* the machine is built before anything else is done, just as when
+		its components were globals */
+	z88_cpu machine;
+	const char *restore_from = nullptr;
+	const char *trace_file = nullptr;
+	bool functional = false;
+	bool checkpointing = false;
+	unsigned long period = 0;
+	unsigned long clusters = 0;
+	unsigned long warmup = 1000;
+	unsigned long length = 1000;
+	machine_options options;
+	int arg = 1;
+
+	//options come before the object file
+	while(arg < argc - 1) {
+		int taken = parse_machine_option(argc, argv, arg, options,
+			std::cout);
+
+		if(taken < 0) {
+			usage(argv[0]);
+			return 1;
+		}
+		else if(taken) {
+			arg += taken;
+		}
+		else if((!strcmp(argv[arg], "-s") || !strcmp(argv[arg], "-i")) &&
+			(arg + 3 < argc)) {
+			machine.schedule_checkpoint(
+				strtoul(argv[arg + 1], nullptr, 0),
+				argv[arg + 2], argv[arg][1] == 'i');
+			checkpointing = true;
+			arg += 3;
+		}
+		else if(!strcmp(argv[arg], "-r")) {
+			restore_from = argv[arg + 1];
+			arg += 2;
+		}
+		else if(!strcmp(argv[arg], "-t")) {
+			CPUObject::debug |= CPUObject::trace;
+			arg++;
+		}
+		else if(!strcmp(argv[arg], "-f")) {
+			functional = true;
+			arg++;
+		}
+		else if(!strcmp(argv[arg], "-p")) {
+			period = strtoul(argv[arg + 1], nullptr, 0);
+			arg += 2;
+		}
+		else if(!strcmp(argv[arg], "-k")) {
+			clusters = strtoul(argv[arg + 1], nullptr, 0);
+			arg += 2;
+		}
+		else if(!strcmp(argv[arg], "-w")) {
+			warmup = strtoul(argv[arg + 1], nullptr, 0);
+			arg += 2;
+		}
+		else if(!strcmp(argv[arg], "-l")) {
+			length = strtoul(argv[arg + 1], nullptr, 0);
+			arg += 2;
+		}
+		else if(!strcmp(argv[arg], "-T")) {
+			CPUObject::debug |= CPUObject::trace;
+			trace_file = argv[arg + 1];
+			arg += 2;
+		}
+		else {
+			break;
+		}
+	}
+
+	/* -f goes on its own: without the pipeline there are no transfers
+		to trace and no components holding the state to checkpoint */
+	/* so does sampling (with its own options), which prints no
+		instruction trace */
+	/* checkpoints leave out the state of a branch predictor, MSHRs
+		and a prefetcher, so none of them can be used with one */
+	bool sampled = (period || clusters);
+	if((arg != argc - 1) || !machine_options_consistent(options) ||
+		((checkpointing || restore_from) &&
+		!machine_options_checkpointed(options)) ||
+		(functional && (argc != 3)) ||
+		(sampled && (functional || checkpointing || restore_from ||
+		options.cpi || options.profile ||
+		(CPUObject::debug & CPUObject::trace) ||
+		(period && clusters) || !length))) {
+		usage(argv[0]);
 		return 1;
 	}
 
+	/* only a handful of the z88's components do anything in a given
+		tick, so only clock those */
+	Clock::setScheduling(Clock::activeObjects);
+
 	try {
-		connect_components();
+		machine.connect_components();
+		configure_machine(machine, options);
+
+		if(trace_file) {
+			Trace::setSink(new BinaryTraceSink(trace_file));
+		}
 
 		std::cout << std::hex;
-		instruction_mem.load(argv[1]);
-		data_mem.load(argv[1]);
 
-		run_program();
+		if(restore_from) {
+			//a checkpoint already holds the program and its data
+			Checkpoint::restore(restore_from);
+		}
+		else {
+			/* read the program once (text .obj or binary image)
+				and give both memories their own copy of it */
+			ProgramImage image(argv[arg]);
+			machine.instruction_mem.load(image);
+			machine.data_mem.load(image);
+		}
+
+		if(sampled) {
+			sampling_plan plan = periodic_plan(period, warmup,
+				length);
+
+			/* SimPoint-style sampling first profiles the whole
+				program, on a z88 of its own */
+			if(clusters) {
+				std::ostringstream discarded;
+				z88_cpu profiler(discarded);
+				ProgramImage image(argv[arg]);
+
+				profiler.connect_components();
+				profiler.instruction_mem.load(image);
+				profiler.data_mem.load(image);
+				plan = simpoint_plan(
+					profiler.profile_intervals(length),
+					clusters, warmup, length);
+			}
+
+			std::vector<window_measurement> windows =
+				machine.run_sampled(plan);
+			unsigned long instructions =
+				machine.program_instructions_executed();
+
+			print_sampling_report(std::cout, plan, windows,
+				estimate_cpi(plan, windows, instructions));
+		}
+		else if(functional) {
+			machine.run_functional();
+		}
+		else {
+			machine.run_program(restore_from);
+		}
+
+		print_machine_reports(machine, options, argv[arg], std::cout);
 	}
 	catch(ArchLibError &ale) {
 		std::cout << std::endl <<
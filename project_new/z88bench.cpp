@@ -0,0 +1,248 @@
+/**
+ * Source file for main function of the z88 benchmark. Measures how many
+ * simulated cycles per second the z88 pipeline runs at, and how many
+ * instructions per second it executes with and without the pipeline, on a
+ * test program and on long synthetic loops.
+ *
+ * Authors: Coleman Link and Ben Maitland
+ */
+
+//C++ includes
+#include <iostream>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+//C includes
+#include <unistd.h>
+
+//arch library includes
+#include <Benchmark.h>
+#include <ProgramImage.h>
+
+//local project includes
+#include "run_program.h"
+
+//runs of each program; the fastest counts
+const int RUNS = 3;
+
+/**
+ * A stream buffer that throws away everything written to it, so that the
+ * z88 still formats its instruction trace but doesn't spend time storing
+ * it.
+ */
+class discard_output : public std::streambuf {
+	protected:
+		int_type overflow(int_type c) override {
+			return traits_type::not_eof(c);
+		}
+
+		std::streamsize xsputn(const char *, std::streamsize n)
+			override {
+			return n;
+		}
+};
+
+/**
+ * Print the command line usage of the benchmark.
+ *
+ * @param prog The name the benchmark was run as.
+ */
+void usage(const char *prog) {
+	std::cout << "Usage: " << prog << " [-q] [-o <results.json>]" <<
+		" [-b <baseline.json> [-t <percent>]] [<object_file>]" <<
+		std::endl <<
+		"  -q  shorter loops, for a quick look" << std::endl <<
+		"  -o  save the results as JSON" << std::endl <<
+		"  -b  compare with saved results, failing if any is more" <<
+		" than" << std::endl <<
+		"      <percent> (default 20) slower" << std::endl <<
+		"The object file (default ../test/vecinc.obj) is timed along" <<
+		" with the loops." << std::endl <<
+		"Saved results hold each rate relative to a calibration loop" <<
+		" timed alongside" << std::endl <<
+		"it, so they can be compared on another machine." << std::endl;
+}
+
+/**
+ * Write a text object file holding a loop that counts a register down
+ * from the given number of iterations, adding to another register on each
+ * iteration, then halts.
+ *
+ * @param file_name The object file to write.
+ * @param iterations How many times to go around the loop.
+ */
+void write_loop_program(const char *file_name, unsigned long iterations) {
+	const unsigned long program[] = {
+		//0x100: lui r1, iterations >> 16
+		(39UL << 26) | (1 << 16) | ((iterations >> 16) & 0xFFFF),
+		//0x104: ori r1, r1, iterations & 0xFFFF
+		(21UL << 26) | (1 << 21) | (1 << 16) | (iterations & 0xFFFF),
+		//0x108: loop: addi r2, r2, 1
+		(16UL << 26) | (2 << 21) | (2 << 16) | 1,
+		//0x10c: addi r1, r1, -1
+		(16UL << 26) | (1 << 21) | (1 << 16) | 0xFFFF,
+		//0x110: bne r1, r0, loop
+		(61UL << 26) | (1 << 21) | ((0x108 - 0x114) & 0xFFFF),
+		//0x114: nop (in the branch's shadow)
+		0x04000000,
+		//0x118: halt
+		0x00000000
+	};
+
+	std::ofstream out(file_name);
+	out << std::hex;
+
+	const unsigned int words = sizeof(program) / sizeof(program[0]);
+	for(unsigned int i = 0; i < words; ++i) {
+		out << (0x100 + (4 * i)) << " 4";
+		for(int shift = 24; shift >= 0; shift -= 8) {
+			out << " " << ((program[i] >> shift) & 0xFF);
+		}
+		out << std::endl;
+	}
+
+	out << "100" << std::endl;
+}
+
+//what to measure a run of a program by
+enum rate_of {
+	//simulated cycles per second
+	CYCLES,
+	//instructions per second, through the pipeline
+	INSTRUCTIONS,
+	//instructions per second, without the pipeline
+	FUNCTIONAL_INSTRUCTIONS
+};
+
+/**
+ * Run a program on a fresh z88 a few times, and measure the best rate.
+ *
+ * @param image The program to run.
+ * @param what What to measure.
+ * @returns The rate of the fastest run.
+ */
+double best_rate(const ProgramImage &image, rate_of what) {
+	double best = 0;
+
+	for(int run = 0; run < RUNS; ++run) {
+		discard_output discard;
+		std::ostream trace(&discard);
+		double start = Benchmark::now();
+		unsigned long count;
+
+		{
+			z88_cpu machine(trace);
+
+			machine.connect_components();
+			trace << std::hex;
+			machine.instruction_mem.load(image);
+			machine.data_mem.load(image);
+			if(what == FUNCTIONAL_INSTRUCTIONS) {
+				machine.run_functional();
+			}
+			else {
+				machine.run_program();
+			}
+
+			count = (what == CYCLES) ? machine.cycles_executed() :
+				machine.instructions_executed();
+		}
+
+		double rate = count / (Benchmark::now() - start);
+		if(rate > best) {
+			best = rate;
+		}
+	}
+
+	return best;
+}
+
+int main(int argc, char *argv[]) {
+	const char *object_file = "../test/vecinc.obj";
+	const char *out_file = nullptr;
+	const char *baseline = nullptr;
+	double tolerance = 0.2;
+	unsigned long scale = 10;
+
+	for(int arg = 1; arg < argc; ++arg) {
+		if(!strcmp(argv[arg], "-q")) {
+			scale = 1;
+		}
+		else if(!strcmp(argv[arg], "-o") && (arg + 1 < argc)) {
+			out_file = argv[++arg];
+		}
+		else if(!strcmp(argv[arg], "-b") && (arg + 1 < argc)) {
+			baseline = argv[++arg];
+		}
+		else if(!strcmp(argv[arg], "-t") && (arg + 1 < argc)) {
+			tolerance = atof(argv[++arg]) / 100;
+		}
+		else if((argv[arg][0] != '-') && (arg == argc - 1)) {
+			object_file = argv[arg];
+		}
+		else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	//no creation messages or end-of-simulation summaries
+	CPUObject::debug = 0;
+
+	Benchmark results("z88");
+
+	try {
+		ProgramImage test(object_file);
+		results.record("z88/vecinc", best_rate(test, CYCLES),
+			"cycles/s", true);
+		results.record("z88/functional/vecinc",
+			best_rate(test, FUNCTIONAL_INSTRUCTIONS), "instrs/s",
+			true);
+
+		const unsigned long loops[] = { 1000 * scale, 10000 * scale };
+		for(unsigned long iterations : loops) {
+			char file_name[] = "/tmp/z88benchXXXXXX";
+			int fd = mkstemp(file_name);
+
+			if(fd < 0) {
+				std::cerr << "z88bench: can't make a" <<
+					" temporary file" << std::endl;
+				return 2;
+			}
+			close(fd);
+
+			write_loop_program(file_name, iterations);
+			ProgramImage loop(file_name);
+			unlink(file_name);
+
+			std::string name = "loop-" + std::to_string(iterations);
+			results.record(("z88/" + name).c_str(),
+				best_rate(loop, CYCLES), "cycles/s", true);
+			results.record(("z88/pipeline/" + name).c_str(),
+				best_rate(loop, INSTRUCTIONS), "instrs/s", true);
+			results.record(("z88/functional/" + name).c_str(),
+				best_rate(loop, FUNCTIONAL_INSTRUCTIONS),
+				"instrs/s", true);
+		}
+
+		if(out_file) {
+			results.write(out_file);
+		}
+		if(baseline) {
+			int regressions = results.compare(baseline, tolerance,
+				std::cout);
+			return regressions ? 1 : 0;
+		}
+	}
+	catch(ArchLibError &ale) {
+		std::cerr << "z88bench: " << ale.what() << std::endl;
+		return 2;
+	}
+
+	results.print(std::cout);
+	return 0;
+}
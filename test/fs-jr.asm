@@ -0,0 +1,31 @@
+; jumps through registers written by the instructions just ahead of the JR:
+; the target must be forwarded from the youngest of them, even when an
+; older one, or the register file, holds another value
+;
+	.org	0x100
+	.entry	start
+;
+start:	addi	r5,r0,wrong
+	addi	r5,r0,one	; both ahead of the JR write r5
+	jr	r5
+	nop
+;
+one:	addi	r6,r0,wrong
+	nop
+	nop
+	nop
+	addi	r6,r0,two	; only the one two ahead writes r6
+	nop
+	jr	r6
+	nop
+;
+two:	addi	r7,r0,done	; only the one three ahead writes r7
+	nop
+	nop
+	jr	r7
+	nop
+;
+wrong:	break
+	halt
+;
+done:	halt
@@ -0,0 +1,34 @@
+; a walk down a linked list in a slow region of memory
+; (-N 4 -L 0x1000-0x1fff:10 -c): each load's address is the value of the
+; one before it, so however many miss-status holding registers there are,
+; only one is ever taken (memory-level parallelism 1.00), and the branch
+; testing each node stalls for all of its load's wait, saving nothing over
+; blocking loads
+;
+	.entry	start
+;
+	.org	0x1000
+n0:	.word	0x1010
+	.org	0x1010
+n1:	.word	0x1020
+	.org	0x1020
+n2:	.word	0x1030
+	.org	0x1030
+n3:	.word	0x1040
+	.org	0x1040
+n4:	.word	0x1050
+	.org	0x1050
+n5:	.word	0
+;
+	.org	0x200
+;
+start:	ori	r1,r0,0x1000	; the first node
+	addi	r3,r0,0		; nodes visited
+;
+loop:	lw	r1,0(r1)	; the next node
+	addi	r3,r3,1
+	bne	r1,r0,loop
+	nop
+;
+	break
+	halt
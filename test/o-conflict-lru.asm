@@ -0,0 +1,31 @@
+; loads that conflict in a one-set, four-way data cache (-D 64:16:4:lru):
+; after lines a, b, c and d fill the set and a is used again, e replaces
+; b, the least recently used, so b, c and d all miss again after it
+; (o-conflict-plru.asm is the same program under pseudo-LRU)
+;
+	.entry	start
+;
+	.org	0x1000
+a:	.word	1
+	.org	0x1010
+b:	.word	2
+	.org	0x1020
+c:	.word	3
+	.org	0x1030
+d:	.word	4
+	.org	0x1040
+e:	.word	5
+;
+	.org	0x200
+;
+start:	lw	r1,0x1000(r0)	; a, b, c and d fill the set
+	lw	r2,0x1010(r0)
+	lw	r3,0x1020(r0)
+	lw	r4,0x1030(r0)
+	lw	r5,0x1000(r0)	; a again
+	lw	r6,0x1040(r0)	; e replaces one of them
+	lw	r7,0x1010(r0)
+	lw	r8,0x1020(r0)
+	lw	r9,0x1030(r0)
+	break
+	halt
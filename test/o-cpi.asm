@@ -0,0 +1,32 @@
+; a subroutine called in a loop, whose load feeds the next instruction
+; straight away, run with the CPI stack and profile (-c -P): the load-use
+; stalls are charged to the add after the load and the wait for the loop
+; count to the bne, each named by its label in both reports
+;
+	.entry	main
+;
+	.org	0x1000
+count:	.word	4
+total:	.word	0
+;
+	.org	0x200
+;
+; add r1 to total
+;
+addto:	lw	r2,0x1004(r0)
+	add	r2,r2,r1	; waits for the load
+	sw	r2,0x1004(r0)
+	jr	r31
+	nop
+;
+main:	lw	r1,0x1000(r0)
+	nop
+loop:	jal	addto
+	nop
+	addi	r1,r1,-1
+	bne	r1,r0,loop
+	nop
+;
+	lw	r3,0x1004(r0)
+	break
+	halt
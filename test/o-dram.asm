@@ -0,0 +1,23 @@
+; loads through a two-bank DRAM with 64-byte rows, left open
+; (-M 2:64:2:3:2): the first load of a row opens it, the next in the same
+; row hits it, and one in another row of the same bank closes it first
+;
+	.entry	start
+;
+	.org	0x1000
+	.word	1
+	.word	2
+	.org	0x1040
+	.word	3
+	.org	0x1080
+	.word	4
+;
+	.org	0x200
+;
+start:	lw	r1,0x1000(r0)	; opens a row of bank 0
+	lw	r2,0x1004(r0)	; hits it
+	lw	r3,0x1040(r0)	; opens a row of bank 1
+	lw	r4,0x1080(r0)	; closes bank 0's row for another
+	lw	r5,0x1000(r0)	; and back again
+	break
+	halt
@@ -0,0 +1,22 @@
+; a loop whose inner branch is taken every other pass, which a two-bit
+; counter per branch can't learn but gshare (-b gshare), with the global
+; history in its index, can
+;
+	.entry	start
+;
+	.org	0x200
+;
+start:	addi	r1,r0,32	; passes left
+	addi	r2,r0,0		; odd pass?
+	addi	r3,r0,0
+;
+loop:	xori	r2,r2,1
+	beq	r2,r0,even
+	nop
+	addi	r3,r3,1		; odd passes only
+even:	addi	r1,r1,-1
+	bne	r1,r0,loop
+	nop
+;
+	break
+	halt
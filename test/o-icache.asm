@@ -0,0 +1,30 @@
+; a loop too big for a four-line, direct-mapped instruction cache
+; (-I 64:16:1), so every pass misses on the lines its two ends share
+;
+	.entry	start
+;
+	.org	0x200
+;
+start:	addi	r1,r0,3		; passes left
+	addi	r2,r0,0
+;
+loop:	addi	r2,r2,1
+	addi	r2,r2,2
+	addi	r2,r2,3
+	addi	r2,r2,4
+	addi	r2,r2,5
+	addi	r2,r2,6
+	addi	r2,r2,7
+	addi	r2,r2,8
+	addi	r2,r2,9
+	addi	r2,r2,10
+	addi	r2,r2,11
+	addi	r2,r2,12
+	addi	r2,r2,13
+	addi	r2,r2,14
+	addi	r1,r1,-1
+	bne	r1,r0,loop
+	nop
+;
+	break
+	halt
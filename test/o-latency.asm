@@ -0,0 +1,27 @@
+; loads from a slow region of memory (-L 0x1000-0x1fff:6) and a store to a
+; fast one: only the accesses to the slow region wait
+;
+	.entry	start
+;
+	.org	0x800
+sum:	.word	0
+;
+	.org	0x1000
+vec:	.word	1
+	.word	2
+	.word	3
+	.word	4
+;
+	.org	0x200
+;
+start:	lw	r1,0x1000(r0)
+	lw	r2,0x1004(r0)
+	lw	r3,0x1008(r0)
+	lw	r4,0x100c(r0)
+	add	r5,r1,r2
+	add	r5,r5,r3
+	add	r5,r5,r4
+	sw	r5,0x800(r0)
+	lw	r6,0x800(r0)
+	break
+	halt
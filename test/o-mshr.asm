@@ -0,0 +1,19 @@
+; a load from a slow region of memory (-L 0x1000-0x1fff:10) whose value
+; isn't needed until later, with one miss-status holding register (-N 1):
+; the instructions that don't use it go on while it waits, and only the
+; add that does stalls, for what is left of the wait
+;
+	.entry	start
+;
+	.org	0x1000
+	.word	7
+;
+	.org	0x200
+;
+start:	lw	r1,0x1000(r0)
+	addi	r2,r0,1		; don't wait for the load
+	addi	r3,r2,2
+	addi	r4,r3,3
+	add	r5,r1,r4	; waits for it
+	break
+	halt
@@ -0,0 +1,39 @@
+; a loop walking an array a line at a time through a data cache with a
+; stride prefetcher (-D 256:16:2 -F 1:2 -L 0x1000-0x1fff:8): once the
+; load's stride is steady, the line two strides ahead is prefetched, and
+; its later loads hit
+;
+	.entry	start
+;
+	.org	0x1000
+vec:	.word	1
+	.org	0x1010
+	.word	2
+	.org	0x1020
+	.word	3
+	.org	0x1030
+	.word	4
+	.org	0x1040
+	.word	5
+	.org	0x1050
+	.word	6
+	.org	0x1060
+	.word	7
+	.org	0x1070
+	.word	8
+;
+	.org	0x200
+;
+start:	addi	r1,r0,8		; lines left
+	ori	r2,r0,0x1000
+	addi	r3,r0,0
+;
+loop:	lw	r4,0(r2)
+	add	r3,r3,r4
+	addi	r2,r2,16
+	addi	r1,r1,-1
+	bne	r1,r0,loop
+	nop
+;
+	break
+	halt
@@ -0,0 +1,33 @@
+; loads of an array in a slow region of memory, none of which uses another
+; (-D 256:16:1 -N 2 -L 0x1000-0x1fff:10 -c): the second load of each line
+; shares the MSHR of the first, the third line's load finds both MSHRs
+; taken and holds the pipeline until one is free, and the adds that use
+; the loaded values wait only for the ones they use
+;
+	.entry	start
+;
+	.org	0x1000
+vec:	.word	1
+	.word	2
+	.org	0x1010
+	.word	3
+	.word	4
+	.org	0x1020
+	.word	5
+	.word	6
+;
+	.org	0x200
+;
+start:	lw	r1,0x1000(r0)	; the first line misses
+	lw	r2,0x1004(r0)	; and this waits for the same line
+	lw	r3,0x1010(r0)	; the second line misses too
+	lw	r4,0x1014(r0)
+	lw	r5,0x1020(r0)	; no MSHR free for the third
+	lw	r6,0x1024(r0)
+	add	r7,r1,r2
+	add	r7,r7,r3
+	add	r7,r7,r4
+	add	r7,r7,r5
+	add	r7,r7,r6
+	break
+	halt